@@ -1,5 +1,6 @@
 #include "BTree.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 BTree::BTree(PageSet &pageSet, Page::Index rootIndex, std::unique_ptr<KeyDefinition> keyDefinition, std::unique_ptr<DataDefinition> dataDefinition)
@@ -8,12 +9,19 @@ BTree::BTree(PageSet &pageSet, Page::Index rootIndex, std::unique_ptr<KeyDefinit
 , mDataDefinition(std::move(dataDefinition))
 {
     mRootIndex = rootIndex;
+    mLastLeafIndex = Page::kInvalidIndex;
 }
 
 void BTree::initialize()
 {
     BTreePage leafPage = getPage(mRootIndex);
     leafPage.initialize(BTreePage::Type::Leaf);
+    mLastLeafIndex = Page::kInvalidIndex;
+}
+
+bool BTree::empty()
+{
+    return getPage(mRootIndex).numCells() == 0;
 }
 
 PageSet &BTree::pageSet()
@@ -21,10 +29,44 @@ PageSet &BTree::pageSet()
     return mPageSet;
 }
 
-BTree::Pointer BTree::lookup(Key key, KeyComparator &comparator, SearchComparison comparison, SearchPosition position)
+Page::Index BTree::rootIndex()
+{
+    return mRootIndex;
+}
+
+template<typename Comparator>
+BTree::Pointer BTree::lookup(Key key, Comparator &comparator, SearchComparison comparison, SearchPosition position)
 {
     BTreePage leafPage = findLeaf(key, comparator, comparison, position);
     BTreePage::Index index = leafPage.leafLookup(key, comparator, comparison, position);
+
+    // The leaf selected by the separator keys may end just before the first match, or
+    // start just after the last one, so check the neighboring leaf before giving up
+    if(index == BTreePage::kInvalidIndex) {
+        Page::Index neighborIndex = Page::kInvalidIndex;
+        switch(comparison) {
+            case SearchComparison::LessThan:
+            case SearchComparison::LessThanEqual:
+                if(position == SearchPosition::Last) neighborIndex = leafPage.prevSibling();
+                break;
+            case SearchComparison::Equal:
+                neighborIndex = (position == SearchPosition::First) ? leafPage.nextSibling() : leafPage.prevSibling();
+                break;
+            case SearchComparison::GreaterThanEqual:
+            case SearchComparison::GreaterThan:
+                if(position == SearchPosition::First) neighborIndex = leafPage.nextSibling();
+                break;
+        }
+
+        if(neighborIndex != Page::kInvalidIndex) {
+            BTreePage neighborPage = getPage(neighborIndex);
+            index = neighborPage.leafLookup(key, comparator, comparison, position);
+            if(index != BTreePage::kInvalidIndex) {
+                return {neighborIndex, index};
+            }
+        }
+    }
+
     if(index == BTreePage::kInvalidIndex) {
         return {Page::kInvalidIndex, 0};
     } else {
@@ -34,10 +76,9 @@ BTree::Pointer BTree::lookup(Key key, KeyComparator &comparator, SearchCompariso
 
 BTree::Pointer BTree::lookup(Key key, SearchComparison comparison, SearchPosition position)
 {
-    KeyComparator defaultComparator = [&](Key a, Key b) {
-        return mKeyDefinition->compare(a, b);
-    };
-    return lookup(key, defaultComparator, comparison, position);
+    return BTreePage::withComparator(*mKeyDefinition, [&](auto &comparator) {
+        return lookup(key, comparator, comparison, position);
+    });
 }
 
 struct KeyValue {
@@ -64,8 +105,9 @@ BTree::Pointer BTree::add(Key key, BTreePage::Size dataSize)
         return {leafPage.pageIndex(), leafPage.leafAdd(key, dataSize)};
     }
     
-    BTreePage::Index splitIndex = leafPage.numCells() / 2;
-    KeyValue splitKey = leafPage.cellKey(splitIndex);
+    BTreePage::Index splitIndex = leafPage.splitIndex(key, dataSize);
+    Key rightKey = leafPage.cellKey(splitIndex);
+    KeyValue splitKey = Key(rightKey.data, leafPage.separatorSize(leafPage.cellKey(splitIndex - 1), rightKey));
     BTreePage newLeafPage = leafPage.split(splitIndex);
 
     Pointer ret;
@@ -75,30 +117,92 @@ BTree::Pointer BTree::add(Key key, BTreePage::Size dataSize)
         ret = {leafPage.pageIndex(), leafPage.leafAdd(key, dataSize)};
     }
 
-    Page::Index parentPageIndex = leafPage.parent();
-    Page::Index leftSplitIndex = leafPage.page().index();
-    Page::Index rightSplitIndex = newLeafPage.page().index();
+    addSplit(leafPage.pageIndex(), newLeafPage.pageIndex(), splitKey, false, ret);
+    mLastLeafIndex = Page::kInvalidIndex;
+
+    return ret;
+}
+
+BTree::Pointer BTree::append(Key key, BTreePage::Size dataSize)
+{
+    // The key sorts after every key in the tree, so it always goes at the end
+    // of the rightmost leaf, which is remembered between calls
+    if(mLastLeafIndex == Page::kInvalidIndex) {
+        Page::Index index = mRootIndex;
+        while(true) {
+            BTreePage page = getPage(index);
+            if(page.type() == BTreePage::Type::Leaf) {
+                break;
+            }
+            index = page.indirectPageIndex(page.numCells() - 1);
+        }
+        mLastLeafIndex = index;
+    }
+
+    BTreePage leafPage = getPage(mLastLeafIndex);
+    if(leafPage.leafCanAdd(key.size, dataSize)) {
+        BTreePage::Index index = leafPage.numCells();
+        leafPage.insertCell(key, dataSize, index);
+        return {leafPage.pageIndex(), index};
+    }
+
+    // Split at the right edge instead of the middle, so that the pages left
+    // behind stay full
+    KeyValue splitKey = Key(key.data, leafPage.separatorSize(leafPage.cellKey(leafPage.numCells() - 1), key));
+    BTreePage newLeafPage = leafPage.split(leafPage.numCells());
+    newLeafPage.insertCell(key, dataSize, 0);
+
+    Pointer ret = {newLeafPage.pageIndex(), 0};
+    addSplit(leafPage.pageIndex(), newLeafPage.pageIndex(), splitKey, true, ret);
+    mLastLeafIndex = newLeafPage.pageIndex();
+
+    return ret;
+}
+
+void BTree::addSplit(Page::Index leftSplitIndex, Page::Index rightSplitIndex, Key key, bool append, Pointer &pointer)
+{
+    KeyValue splitKey = key;
+    Page::Index parentPageIndex = getPage(leftSplitIndex).parent();
 
     while(true) {
         BTreePage leftSplitPage = getPage(leftSplitIndex);
         BTreePage rightSplitPage = getPage(rightSplitIndex);
 
         if(parentPageIndex == Page::kInvalidIndex) {
-            BTreePage indirectPage(mPageSet.addPage(), *mKeyDefinition, *mDataDefinition);
-            indirectPage.initialize(BTreePage::Type::Indirect);
-
-            indirectPage.indirectPushTail(Key(), leftSplitPage);
-            indirectPage.indirectPushTail(splitKey, rightSplitPage);
-
-            mRootIndex = indirectPage.page().index();
+            // The root stays at a fixed page index, so that it can be recorded
+            // persistently.  Move its contents down into a new page and turn
+            // the root into an indirect page over the two halves.
+            BTreePage newLeftSplitPage = leftSplitPage.split(0);
+            newLeftSplitPage.setPrevSibling(Page::kInvalidIndex);
+
+            leftSplitPage.initialize(BTreePage::Type::Indirect);
+            leftSplitPage.indirectPushTail(Key(), newLeftSplitPage);
+            leftSplitPage.indirectPushTail(splitKey, rightSplitPage);
+
+            if(pointer.pageIndex == leftSplitIndex) {
+                pointer.pageIndex = newLeftSplitPage.pageIndex();
+            }
             break;
         } else {
             BTreePage indirectPage = getPage(parentPageIndex);
             if(indirectPage.indirectCanAdd(splitKey.data.size())) {
                 indirectPage.indirectAdd(splitKey, rightSplitPage);
                 break;
+            } else if(append) {
+                // The new child starts a new rightmost indirect page.  The
+                // last existing child moves over with it, since an indirect
+                // page with one child has no neighbor to rebalance with.
+                BTreePage::Index splitIndex = indirectPage.numCells() - 1;
+                KeyValue indirectSplitKey = indirectPage.cellKey(splitIndex);
+                BTreePage newIndirectPage = indirectPage.split(splitIndex);
+                newIndirectPage.indirectPushTail(splitKey, rightSplitPage);
+
+                parentPageIndex = indirectPage.parent();
+                leftSplitIndex = indirectPage.page().index();
+                rightSplitIndex = newIndirectPage.page().index();
+                splitKey = std::move(indirectSplitKey);
             } else {
-                splitIndex = indirectPage.numCells() / 2;
+                BTreePage::Index splitIndex = indirectPage.splitIndex(splitKey, sizeof(Page::Index));
                 KeyValue indirectSplitKey = indirectPage.cellKey(splitIndex);
                 BTreePage newIndirectPage = indirectPage.split(splitIndex);
 
@@ -115,20 +219,33 @@ BTree::Pointer BTree::add(Key key, BTreePage::Size dataSize)
             }
         }
     }
-
-    return ret;
 }
 
-bool BTree::resize(Pointer pointer, BTreePage::Size dataSize)
+void BTree::resize(Pointer &pointer, BTreePage::Size dataSize)
 {
     BTreePage leafPage = getPage(pointer.pageIndex);
-    return leafPage.leafResize(pointer.cellIndex, dataSize);
+    if(leafPage.leafResize(pointer.cellIndex, dataSize)) {
+        return;
+    }
+
+    // No room on the page for the larger entry, so it is removed and added
+    // again, splitting the leaf if necessary
+    BTreePage::Key key = leafPage.cellKey(pointer.cellIndex);
+    std::vector<uint8_t> keyData(key.size);
+    std::memcpy(keyData.data(), key.data, key.size);
+    std::vector<uint8_t> data(leafPage.cellDataSize(pointer.cellIndex));
+    std::memcpy(data.data(), leafPage.cellData(pointer.cellIndex), data.size());
+
+    remove(pointer);
+    pointer = add(Key(keyData.data(), keyData.size()), dataSize);
+    std::memcpy(this->data(pointer), data.data(), std::min<size_t>(data.size(), dataSize));
 }
 
 void BTree::remove(Pointer pointer, std::span<Pointer*> trackPointers)
 {
     BTreePage leafPage = getPage(pointer.pageIndex);
     leafPage.leafRemove(pointer.cellIndex, trackPointers);
+    mLastLeafIndex = Page::kInvalidIndex;
     Page::Index index = leafPage.page().index();
 
     while(true) {
@@ -139,9 +256,7 @@ void BTree::remove(Pointer pointer, std::span<Pointer*> trackPointers)
 
         if(page.parent() == Page::kInvalidIndex) {
             if(page.type() == BTreePage::Indirect && page.numCells() == 1) {
-                mRootIndex = page.indirectPageIndex(0);
-                mPageSet.deletePage(page.page());
-                getPage(mRootIndex).setParent(Page::kInvalidIndex);
+                page.indirectPullUpChild(trackPointers);
             }
             break;
         }
@@ -173,6 +288,23 @@ void *BTree::data(Pointer pointer)
     }
 }
 
+BTreePage::Size BTree::dataSize(Pointer pointer)
+{
+    if(pointer.pageIndex == Page::kInvalidIndex) {
+        return 0;
+    } else {
+        BTreePage page = getPage(pointer.pageIndex);
+        return page.cellDataSize(pointer.cellIndex);
+    }
+}
+
+int BTree::compare(Pointer a, Pointer b)
+{
+    BTreePage pageA = getPage(a.pageIndex);
+    BTreePage pageB = getPage(b.pageIndex);
+    return keyCompare(pageA.cellKey(a.cellIndex), pageB.cellKey(b.cellIndex));
+}
+
 BTree::Pointer BTree::first()
 {
     Page::Index index = mRootIndex;
@@ -185,6 +317,10 @@ BTree::Pointer BTree::first()
         index = page.indirectPageIndex(0);
     }
 
+    if(getPage(index).numCells() == 0) {
+        return {Page::kInvalidIndex, 0};
+    }
+
     return {index, 0};
 }
 
@@ -201,6 +337,10 @@ BTree::Pointer BTree::last()
     }
 
     BTreePage page = getPage(index);
+    if(page.numCells() == 0) {
+        return {Page::kInvalidIndex, 0};
+    }
+
     return {index, (BTreePage::Index)(page.numCells() - 1)};
 }
 
@@ -233,6 +373,133 @@ bool BTree::movePrev(Pointer &pointer)
     }
 }
 
+void BTree::relocatePages(Page::Index limit, std::vector<Page::Index> &oldPages)
+{
+    mRootIndex = relocatePage(mRootIndex, limit, oldPages);
+    mLastLeafIndex = Page::kInvalidIndex;
+}
+
+BTree::Builder::Builder(BTree &tree, double fillFactor)
+: mTree(tree)
+{
+    // Leaves filled to less than half would be considered deficient
+    fillFactor = std::clamp(fillFactor, 0.5, 1.0);
+    mReserve = uint32_t(mTree.mPageSet.pageSize() * (1.0 - fillFactor));
+}
+
+void *BTree::Builder::add(Key key, BTreePage::Size dataSize)
+{
+    if(mLevels.empty()) {
+        newPage(0, BTreePage::Type::Leaf);
+    }
+
+    BTreePage leafPage = mTree.getPage(mLevels[0]);
+    if(leafPage.numCells() > 0 && (!leafPage.leafCanAdd(key.size, dataSize) || leafPage.freeSpace() < mReserve)) {
+        BTreePage newLeafPage = newPage(0, BTreePage::Type::Leaf);
+        Key lastKey = leafPage.cellKey(leafPage.numCells() - 1);
+        addChild(1, Key(key.data, leafPage.separatorSize(lastKey, key)), newLeafPage);
+
+        BTreePage::Index index = newLeafPage.numCells();
+        newLeafPage.insertCell(key, dataSize, index);
+        return newLeafPage.cellData(index);
+    }
+
+    BTreePage::Index index = leafPage.numCells();
+    leafPage.insertCell(key, dataSize, index);
+    return leafPage.cellData(index);
+}
+
+void BTree::Builder::finish()
+{
+    if(mLevels.empty()) {
+        return;
+    }
+
+    // The root stays at a fixed page index, so move the top of the new tree
+    // into it
+    BTreePage topPage = mTree.getPage(mLevels.back());
+    BTreePage rootPage = mTree.getPage(mTree.mRootIndex);
+    topPage.relocate(rootPage);
+    mTree.mPageSet.deletePage(topPage.page());
+    mTree.mLastLeafIndex = Page::kInvalidIndex;
+
+    mLevels.clear();
+}
+
+BTreePage BTree::Builder::newPage(size_t level, BTreePage::Type type)
+{
+    BTreePage page(mTree.mPageSet.addPage(), *mTree.mKeyDefinition, *mTree.mDataDefinition);
+    page.initialize(type);
+
+    if(level < mLevels.size()) {
+        BTreePage prevPage = mTree.getPage(mLevels[level]);
+        prevPage.setNextSibling(page.pageIndex());
+        page.setPrevSibling(prevPage.pageIndex());
+        mLevels[level] = page.pageIndex();
+    } else {
+        mLevels.push_back(page.pageIndex());
+    }
+
+    return page;
+}
+
+void BTree::Builder::addChild(size_t level, Key key, BTreePage &childPage)
+{
+    if(level == mLevels.size()) {
+        // The level below has just gained its second page, so start a new
+        // level over both of them
+        BTreePage firstChildPage = mTree.getPage(childPage.prevSibling());
+        BTreePage indirectPage = newPage(level, BTreePage::Type::Indirect);
+        indirectPage.indirectPushTail(Key(), firstChildPage);
+        indirectPage.indirectPushTail(key, childPage);
+        return;
+    }
+
+    BTreePage indirectPage = mTree.getPage(mLevels[level]);
+    if(indirectPage.indirectCanAdd(key.size)) {
+        indirectPage.indirectPushTail(key, childPage);
+    } else {
+        BTreePage newIndirectPage = newPage(level, BTreePage::Type::Indirect);
+        newIndirectPage.indirectPushTail(Key(), childPage);
+        addChild(level + 1, key, newIndirectPage);
+    }
+}
+
+BTree::SpaceStats BTree::spaceStats()
+{
+    SpaceStats stats;
+
+    // Walk each level from left to right, starting from its first page
+    Page::Index levelIndex = mRootIndex;
+    while(levelIndex != Page::kInvalidIndex) {
+        BTreePage firstPage = getPage(levelIndex);
+        stats.height++;
+        levelIndex = (firstPage.type() == BTreePage::Type::Indirect) ? firstPage.indirectPageIndex(0) : Page::kInvalidIndex;
+
+        for(Page::Index index = firstPage.pageIndex(); index != Page::kInvalidIndex; ) {
+            BTreePage page = getPage(index);
+            stats.freeBytes += page.freeSpace();
+            if(page.type() == BTreePage::Type::Leaf) {
+                stats.leafPages++;
+                stats.entries += page.numCells();
+                for(BTreePage::Index i=0; i<page.numCells(); i++) {
+                    stats.keyBytes += page.cellKey(i).size;
+                    stats.dataBytes += page.cellDataSize(i);
+                }
+            } else {
+                stats.indirectPages++;
+                stats.separators += page.numCells() - 1;
+                for(BTreePage::Index i=1; i<page.numCells(); i++) {
+                    stats.separatorBytes += page.cellKey(i).size;
+                }
+            }
+            index = page.nextSibling();
+        }
+    }
+
+    return stats;
+}
+
 void BTree::print()
  {
     Page &page = mPageSet.page(mRootIndex);
@@ -240,7 +507,8 @@ void BTree::print()
 }
 
 
-BTreePage BTree::findLeaf(Key key, KeyComparator &comparator, SearchComparison comparison, SearchPosition position)
+template<typename Comparator>
+BTreePage BTree::findLeaf(Key key, Comparator &comparator, SearchComparison comparison, SearchPosition position)
 {
     Page::Index index = mRootIndex;
     while(true) {
@@ -257,12 +525,32 @@ BTreePage BTree::findLeaf(Key key, KeyComparator &comparator, SearchComparison c
 
 BTreePage BTree::findLeaf(Key key, SearchComparison comparison, SearchPosition position)
 {
-    KeyComparator defaultComparator = [&](Key a, Key b) {
-        return mKeyDefinition->compare(a, b);
-    };
-    return findLeaf(key, defaultComparator, comparison, position);
+    return BTreePage::withComparator(*mKeyDefinition, [&](auto &comparator) {
+        return findLeaf(key, comparator, comparison, position);
+    });
 }
     
+Page::Index BTree::relocatePage(Page::Index index, Page::Index limit, std::vector<Page::Index> &oldPages)
+{
+    if(index >= limit) {
+        BTreePage page = getPage(index);
+        BTreePage newPage(mPageSet.addPage(), *mKeyDefinition, *mDataDefinition);
+        page.relocate(newPage);
+
+        oldPages.push_back(index);
+        index = newPage.pageIndex();
+    }
+
+    BTreePage page = getPage(index);
+    if(page.type() == BTreePage::Type::Indirect) {
+        for(BTreePage::Index i=0; i<page.numCells(); i++) {
+            relocatePage(page.indirectPageIndex(i), limit, oldPages);
+        }
+    }
+
+    return index;
+}
+
 BTreePage BTree::getPage(Page::Index index)
 {
     return BTreePage(mPageSet.page(index), *mKeyDefinition, *mDataDefinition);
@@ -272,3 +560,7 @@ int BTree::keyCompare(Key a, Key b)
 {
     return mKeyDefinition->compare(a, b);
 }
+
+
+template BTree::Pointer BTree::lookup(Key key, KeyComparator &comparator, SearchComparison comparison, SearchPosition position);
+template BTree::Pointer BTree::lookup(Key key, PrefixKeyComparator &comparator, SearchComparison comparison, SearchPosition position);
\ No newline at end of file
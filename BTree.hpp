@@ -18,21 +18,63 @@ public:
     typedef BTreePage::SearchPosition SearchPosition;
     typedef BTreePage::Pointer Pointer;
     typedef BTreePage::KeyComparator KeyComparator;
+    typedef BTreePage::PrefixKeyComparator PrefixKeyComparator;
+
+    static constexpr double kDefaultFillFactor = 0.9;
+
+    // Builds the tree bottom-up from cells supplied in ascending key order.
+    // Leaves are packed to the fill factor, and each level of indirect pages
+    // is filled in as the level below it grows.  The tree must be empty; the
+    // finished tree replaces it when finish() is called.
+    class Builder {
+    public:
+        Builder(BTree &tree, double fillFactor = kDefaultFillFactor);
+
+        void *add(Key key, BTreePage::Size dataSize);
+        void finish();
+
+    private:
+        BTreePage newPage(size_t level, BTreePage::Type type);
+        void addChild(size_t level, Key key, BTreePage &childPage);
+
+        BTree &mTree;
+        uint32_t mReserve;
+        std::vector<Page::Index> mLevels;
+    };
+
+    // Space used by the tree, for reporting how far the pages it occupies
+    // exceed the size of the entries they hold
+    struct SpaceStats {
+        size_t height = 0;
+        size_t leafPages = 0;
+        size_t indirectPages = 0;
+        size_t entries = 0;
+        size_t keyBytes = 0;
+        size_t dataBytes = 0;
+        size_t separators = 0;
+        size_t separatorBytes = 0;
+        size_t freeBytes = 0;
+    };
 
     BTree(PageSet &pageSet, Page::Index rootIndex, std::unique_ptr<KeyDefinition> keyDefinition, std::unique_ptr<DataDefinition> dataDefinition);
 
     void initialize();
 
     PageSet &pageSet();
+    Page::Index rootIndex();
+    bool empty();
 
-    Pointer lookup(Key key, KeyComparator &comparator, SearchComparison comparison, SearchPosition position);
+    template<typename Comparator> Pointer lookup(Key key, Comparator &comparator, SearchComparison comparison, SearchPosition position);
     Pointer lookup(Key key, SearchComparison comparison, SearchPosition position);
     Pointer add(Key key, BTreePage::Size size);
-    bool resize(Pointer pointer, BTreePage::Size size);
+    Pointer append(Key key, BTreePage::Size size);
+    void resize(Pointer &pointer, BTreePage::Size size);
     void remove(Pointer pointer, std::span<Pointer*> trackPointers = std::span<Pointer*>());
 
     void *key(Pointer pointer);
     void *data(Pointer pointer);
+    BTreePage::Size dataSize(Pointer pointer);
+    int compare(Pointer a, Pointer b);
 
     Pointer first();
     Pointer last();
@@ -40,17 +82,26 @@ public:
     bool moveNext(Pointer &pointer);
     bool movePrev(Pointer &pointer);
 
+    void relocatePages(Page::Index limit, std::vector<Page::Index> &oldPages);
+
+    SpaceStats spaceStats();
+
     void print();
 
 private:
     PageSet &mPageSet;
     Page::Index mRootIndex;
+    Page::Index mLastLeafIndex;
     std::unique_ptr<KeyDefinition> mKeyDefinition;
     std::unique_ptr<DataDefinition> mDataDefinition;
 
-    BTreePage findLeaf(Key key, KeyComparator &comparator, SearchComparison comparison, SearchPosition position);
+    template<typename Comparator> BTreePage findLeaf(Key key, Comparator &comparator, SearchComparison comparison, SearchPosition position);
     BTreePage findLeaf(Key key, SearchComparison comparison, SearchPosition position);
 
+    void addSplit(Page::Index leftSplitIndex, Page::Index rightSplitIndex, Key key, bool append, Pointer &pointer);
+
+    Page::Index relocatePage(Page::Index index, Page::Index limit, std::vector<Page::Index> &oldPages);
+
     BTreePage getPage(Page::Index index);
     int keyCompare(Key a, Key b);
 };
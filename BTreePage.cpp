@@ -8,6 +8,20 @@ BTreePage::BTreePage(Page &page, KeyDefinition &keyDefinition, DataDefinition &d
 , mKeyDefinition(keyDefinition)
 , mDataDefinition(dataDefinition)
 {
+    mPage.pin();
+}
+
+BTreePage::BTreePage(const BTreePage &other)
+: mPage(other.mPage)
+, mKeyDefinition(other.mKeyDefinition)
+, mDataDefinition(other.mDataDefinition)
+{
+    mPage.pin();
+}
+
+BTreePage::~BTreePage()
+{
+    mPage.unpin();
 }
 
 void BTreePage::initialize(Type type)
@@ -21,6 +35,7 @@ void BTreePage::initialize(Type type)
     head.parent = Page::kInvalidIndex;
     head.prevSibling = Page::kInvalidIndex;
     head.nextSibling = Page::kInvalidIndex;
+    mPage.setDirty(true);
 }
 
 Page &BTreePage::page()
@@ -46,6 +61,7 @@ Page::Index BTreePage::parent()
 void BTreePage::setParent(Page::Index parent)
 {
     header().parent = parent;
+    mPage.setDirty(true);
 }
 
 Page::Index BTreePage::prevSibling()
@@ -56,6 +72,7 @@ Page::Index BTreePage::prevSibling()
 void BTreePage::setPrevSibling(Page::Index prevSibling)
 {
     header().prevSibling = prevSibling;
+    mPage.setDirty(true);
 }
 
 Page::Index BTreePage::nextSibling()
@@ -66,9 +83,10 @@ Page::Index BTreePage::nextSibling()
 void BTreePage::setNextSibling(Page::Index nextSibling)
 {
     header().nextSibling = nextSibling;
+    mPage.setDirty(true);
 }
 
-BTreePage::Size BTreePage::freeSpace()
+uint32_t BTreePage::freeSpace()
 {
     Header &head = header();
 
@@ -151,37 +169,55 @@ BTreePage::Size BTreePage::cellTotalDataSize(Index index)
     return totalDataSize;
 }
 
+bool BTreePage::canSetCellKey(Index index, Size keySize)
+{
+    if(mKeyDefinition.fixedSize() != 0) {
+        return true;
+    }
+
+    return freeSpace() + cellTotalKeySize(index) >= keySize + sizeof(uint16_t);
+}
+
 void BTreePage::setCellKey(Index index, Key key)
 {
+    mPage.setDirty(true);
     if(key.size == cellKey(index).size) {
         std::memcpy(cellKey(index).data, key.data, key.size);
     } else {
-        Header &head = header();
-        head.freeSpace += cellSize(index);
+        // Reallocate the cell around the new key.  Removing it first lets a
+        // defragmentation reclaim its old space.
         Size dataSize = cellDataSize(index);
-        void *src = cellData(index);
         std::vector<uint8_t> data(dataSize);
-        std::memcpy(data.data(), src, dataSize);
+        std::memcpy(data.data(), cellData(index), dataSize);
 
-        uint16_t offset = allocateCell(key, dataSize);
-        uint16_t *offsets = offsetsArray();
-        offsets[index] = offset;
-        
-        Size totalKeySize = 0;
-        if(key) {
-            totalKeySize = mKeyDefinition.fixedSize();
-            if(totalKeySize == 0) {
-                totalKeySize = sizeof(uint16_t) + key.size;
-            }
-        }
-        std::memcpy(mPage.data(offset + totalKeySize), data.data(), dataSize);
+        removeCell(index);
+        insertCell(key, dataSize, index);
+        std::memcpy(cellData(index), data.data(), dataSize);
+    }
+}
+
+BTreePage::Size BTreePage::separatorSize(Key left, Key right)
+{
+    // A separator only has to sort after every key to its left and no later
+    // than every key to its right.  For keys compared bytewise the shortest
+    // prefix of right which differs from left will do.
+    if(mKeyDefinition.fixedSize() != 0 || mKeyDefinition.comparatorKind() != KeyDefinition::ComparatorKind::Bytes) {
+        return right.size;
+    }
 
-        head.freeSpace -= cellSize(index);
+    const uint8_t *leftData = reinterpret_cast<const uint8_t*>(left.data);
+    const uint8_t *rightData = reinterpret_cast<const uint8_t*>(right.data);
+    Size size = 0;
+    while(size < left.size && size < right.size && leftData[size] == rightData[size]) {
+        size++;
     }
+
+    return std::min<Size>(size + 1, right.size);
 }
 
 void BTreePage::insertCell(Key key, BTreePage::Size dataSize, Index index)
 {
+    mPage.setDirty(true);
     Header &head = header();
     uint16_t *offsets = offsetsArray();
 
@@ -200,6 +236,7 @@ void BTreePage::removeCell(Index index)
 
 void BTreePage::removeCells(Index begin, Index end)
 {
+    mPage.setDirty(true);
     Header &head = header();
     for(Index i = begin; i < end; i++) {
         head.freeSpace += cellSize(i) + sizeof(uint16_t);
@@ -246,6 +283,71 @@ BTreePage BTreePage::split(Index index)
     return newPage;
 }
 
+BTreePage::Index BTreePage::splitIndex(Key key, Size dataSize)
+{
+    // Splitting by count could leave the new key's half without room for it
+    // when the keys vary in size.  An indirect page keeps at least two
+    // children on each side, since a page with one child has no neighbor to
+    // rebalance with.
+    Index addIndex = search(key, SearchComparison::GreaterThan, SearchPosition::First);
+    if(addIndex == kInvalidIndex) {
+        addIndex = numCells();
+    }
+
+    // Sums over a whole page do not fit in Size for the largest pages
+    uint32_t addSize = key.size + dataSize + 3 * sizeof(uint16_t);
+    uint32_t totalSize = addSize;
+    for(Index i=0; i<numCells(); i++) {
+        totalSize += cellSize(i) + sizeof(uint16_t);
+    }
+
+    Index minCells = (type() == Type::Indirect) ? 2 : 1;
+    uint32_t leftSize = 0;
+    Index index = 1;
+    for(; index < numCells() - minCells; index++) {
+        leftSize += cellSize(index - 1) + sizeof(uint16_t);
+        if(index == addIndex + 1) {
+            leftSize += addSize;
+        }
+        if(index >= minCells && leftSize >= totalSize / 2) {
+            break;
+        }
+    }
+
+    return index;
+}
+
+void BTreePage::relocate(BTreePage &newPage)
+{
+    std::memcpy(newPage.page().data(), mPage.data(), mPage.size());
+    newPage.page().setDirty(true);
+
+    if(parent() != Page::kInvalidIndex) {
+        BTreePage parentPage = getPage(parent());
+        for(Index i=0; i<parentPage.numCells(); i++) {
+            if(parentPage.indirectPageIndex(i) == pageIndex()) {
+                *reinterpret_cast<Page::Index*>(parentPage.cellData(i)) = newPage.pageIndex();
+                parentPage.page().setDirty(true);
+                break;
+            }
+        }
+    }
+
+    if(prevSibling() != Page::kInvalidIndex) {
+        getPage(prevSibling()).setNextSibling(newPage.pageIndex());
+    }
+
+    if(nextSibling() != Page::kInvalidIndex) {
+        getPage(nextSibling()).setPrevSibling(newPage.pageIndex());
+    }
+
+    if(type() == Type::Indirect) {
+        for(Index i=0; i<numCells(); i++) {
+            getPage(indirectPageIndex(i)).setParent(newPage.pageIndex());
+        }
+    }
+}
+
 bool BTreePage::isDeficient()
 {
     return freeSpace() > page().size() / 2;
@@ -256,11 +358,17 @@ bool BTreePage::canSupplyItem(Index index)
     return freeSpace() + cellSize(index) + sizeof(uint16_t) < page().size() / 2;
 }
 
-BTreePage::Index BTreePage::leafLookup(Key key, KeyComparator &comparator, SearchComparison comparison, SearchPosition position)
+template<typename Comparator>
+BTreePage::Index BTreePage::leafLookup(Key key, Comparator &comparator, SearchComparison comparison, SearchPosition position)
 {
     return search(key, comparator, comparison, position);
 }
 
+BTreePage::Index BTreePage::leafLookup(Key key, SearchComparison comparison, SearchPosition position)
+{
+    return search(key, comparison, position);
+}
+
 bool BTreePage::leafCanAdd(size_t keySize, size_t dataSize)
 {
     return canAllocateCell(keySize, dataSize);
@@ -297,25 +405,32 @@ void BTreePage::leafRemove(Index index, std::span<Pointer*> trackPointers)
 
 bool BTreePage::leafResize(Index index, size_t dataSize)
 {
+    mPage.setDirty(true);
     if(cellDataSize(index) >= dataSize) {
         return true;
     }
 
+    // The cell is reallocated in place of the old one, so it only has to fit
+    // into the space that one frees
     Header &head = header();
-    head.freeSpace += cellSize(index);
-    void *src = cellData(index);
-    std::vector<uint8_t> data(cellDataSize(index));
-    std::memcpy(data.data(), src, cellDataSize(index));
-
-    uint16_t offset = allocateCell(cellKey(index), dataSize);
-    uint16_t *offsets = offsetsArray();
-    offsets[index] = offset;
-    
-    Size totalKeySize = cellTotalKeySize(index);
+    Size oldSize = cellSize(index) + sizeof(uint16_t);
+    head.freeSpace += oldSize;
+    bool fits = canAllocateCell(cellKey(index).size, dataSize);
+    head.freeSpace -= oldSize;
+    if(!fits) {
+        return false;
+    }
 
-    std::memcpy(mPage.data(offset + totalKeySize), data.data(), dataSize);
+    // Removing the cell first lets a defragmentation reclaim its old space
+    Key key = cellKey(index);
+    std::vector<uint8_t> keyData(key.size);
+    std::memcpy(keyData.data(), key.data, key.size);
+    std::vector<uint8_t> data(cellDataSize(index));
+    std::memcpy(data.data(), cellData(index), data.size());
 
-    head.freeSpace -= cellSize(index);
+    removeCell(index);
+    insertCell(Key(keyData.data(), keyData.size()), dataSize, index);
+    std::memcpy(cellData(index), data.data(), data.size());
 
     return true;
 }
@@ -345,7 +460,8 @@ void BTreePage::indirectAdd(Key key, BTreePage &childPage)
     }
 }
 
-Page::Index BTreePage::indirectLookup(Key key, KeyComparator &comparator, SearchComparison comparison, SearchPosition position)
+template<typename Comparator>
+Page::Index BTreePage::indirectLookup(Key key, Comparator &comparator, SearchComparison comparison, SearchPosition position)
 {
     Index index;
     
@@ -355,22 +471,25 @@ Page::Index BTreePage::indirectLookup(Key key, KeyComparator &comparator, Search
             index = search(key, comparator, comparison, position);
             break;
         case Equal:
-            index = search(key, comparator,comparison, position);
-            if(index == kInvalidIndex) {
+            if(position == First) {
+                // Duplicates of the separator key may also sit at the end of the preceding child
                 index = search(key, comparator, LessThan, Last);
+            } else {
+                index = search(key, comparator, comparison, position);
+                if(index == kInvalidIndex) {
+                    index = search(key, comparator, LessThan, Last);
+                }
             }
             break;
         case GreaterThanEqual:
             if(position == First) {
-                index = search(key, comparator, Equal, First);
+                index = search(key, comparator, LessThan, Last);
                 if(index == kInvalidIndex) {
-                    index = search(key, comparator, LessThan, Last);
-                    if(index == kInvalidIndex) {
-                        index = search(key, comparator, GreaterThan, First);
-                    }
+                    index = search(key, comparator, GreaterThan, First);
                 }
             } else {
-                index = search(key, comparator, comparison, position);
+                // Any match in the tree extends to its last key
+                index = numCells() - 1;
             }
             break;
         case GreaterThan:
@@ -380,13 +499,21 @@ Page::Index BTreePage::indirectLookup(Key key, KeyComparator &comparator, Search
                     index = search(key, comparator, GreaterThan, First);
                 }
             } else {
-                index = search(key, comparator, comparison, position);
+                // Any match in the tree extends to its last key
+                index = numCells() - 1;
             }
     }
 
     return indirectPageIndex(index);
 }
 
+Page::Index BTreePage::indirectLookup(Key key, SearchComparison comparison, SearchPosition position)
+{
+    return withComparator(mKeyDefinition, [&](auto &comparator) {
+        return indirectLookup(key, comparator, comparison, position);
+    });
+}
+
 Page::Index BTreePage::indirectPageIndex(Index index)
 {
     if(index == kInvalidIndex) return Page::kInvalidIndex;
@@ -397,31 +524,73 @@ Page::Index BTreePage::indirectPageIndex(Index index)
 
 void BTreePage::indirectRectifyDeficientChild(BTreePage &childPage, std::span<Pointer*> trackPointers)
 {
-    Index childIndex = search(childPage.cellKey(1), SearchComparison::LessThan, SearchPosition::Last);
+    Index childIndex = 0;
+    while(indirectPageIndex(childIndex) != childPage.pageIndex()) {
+        childIndex++;
+    }
 
+    // Only merge with a neighbor when the combined cells fit in one page,
+    // otherwise borrow a cell from it instead.  Borrowing replaces the
+    // separator in this page, so when the new separator does not fit the
+    // child is left deficient.
     if(childIndex < numCells() - 1) {
         BTreePage rightNeighbor = getPage(indirectPageIndex(childIndex + 1));
-        if(rightNeighbor.canSupplyItem(0)) {
-            indirectRotateLeft(childPage, rightNeighbor, childIndex, trackPointers);
-        } else {
+        bool canMerge = indirectCanMergeChildren(childPage, rightNeighbor, childIndex + 1);
+        bool canRotate = canSetCellKey(childIndex + 1, indirectRotateLeftSeparator(rightNeighbor).size);
+        if(canMerge && (!rightNeighbor.canSupplyItem(0) || !canRotate)) {
             indirectMergeChildren(childPage, rightNeighbor, childIndex + 1, trackPointers);
+        } else if(canRotate) {
+            indirectRotateLeft(childPage, rightNeighbor, childIndex, trackPointers);
         }
     } else {
         BTreePage leftNeighbor = getPage(indirectPageIndex(childIndex - 1));
-        if(leftNeighbor.canSupplyItem(leftNeighbor.numCells() - 1)) {
-            indirectRotateRight(leftNeighbor, childPage, childIndex, trackPointers);
-        } else {
+        bool canMerge = indirectCanMergeChildren(leftNeighbor, childPage, childIndex);
+        bool canRotate = canSetCellKey(childIndex, indirectRotateRightSeparator(leftNeighbor).size);
+        if(canMerge && (!leftNeighbor.canSupplyItem(leftNeighbor.numCells() - 1) || !canRotate)) {
             indirectMergeChildren(leftNeighbor, childPage, childIndex, trackPointers);
+        } else if(canRotate) {
+            indirectRotateRight(leftNeighbor, childPage, childIndex, trackPointers);
         }
     }
 }
 
+bool BTreePage::indirectCanMergeChildren(BTreePage &leftChild, BTreePage &rightChild, Index index)
+{
+    size_t usedSpace = rightChild.page().size() - sizeof(Header) - rightChild.freeSpace();
+    if(rightChild.type() == Type::Indirect) {
+        usedSpace += cellTotalKeySize(index);
+    }
+
+    return leftChild.freeSpace() >= usedSpace;
+}
+
+BTreePage::Key BTreePage::indirectRotateLeftSeparator(BTreePage &rightChild)
+{
+    // The separator between two leaves only needs to distinguish the keys
+    // on either side of it
+    Key key = rightChild.cellKey(1);
+    if(rightChild.type() == Type::Leaf) {
+        key.size = separatorSize(rightChild.cellKey(0), key);
+    }
+    return key;
+}
+
+BTreePage::Key BTreePage::indirectRotateRightSeparator(BTreePage &leftChild)
+{
+    Index last = leftChild.numCells() - 1;
+    Key key = leftChild.cellKey(last);
+    if(leftChild.type() == Type::Leaf) {
+        key.size = separatorSize(leftChild.cellKey(last - 1), key);
+    }
+    return key;
+}
+
 void BTreePage::indirectRotateRight(BTreePage &leftChild, BTreePage &rightChild, Index index, std::span<Pointer*> trackPointers)
 {
     for(Pointer *trackPointer : trackPointers) {
         if(trackPointer->pageIndex == leftChild.pageIndex() && trackPointer->cellIndex == leftChild.numCells() - 1) {
             trackPointer->pageIndex = rightChild.pageIndex();
-            trackPointer->pageIndex = 0;
+            trackPointer->cellIndex = 0;
         } else if(trackPointer->pageIndex == rightChild.pageIndex()) {
             trackPointer->cellIndex++;
         }
@@ -436,7 +605,7 @@ void BTreePage::indirectRotateRight(BTreePage &leftChild, BTreePage &rightChild,
         Size size = leftChild.cellDataSize(leftChild.numCells() - 1);
         rightChild.insertCell(leftChild.cellKey(leftChild.numCells() - 1), size, 0);
         std::memcpy(rightChild.cellData(0), leftChild.cellData(leftChild.numCells() - 1), size);
-        setCellKey(index, leftChild.cellKey(leftChild.numCells() - 1));
+        setCellKey(index, indirectRotateRightSeparator(leftChild));
         leftChild.removeCell(leftChild.numCells() - 1);
     }
 }
@@ -463,7 +632,7 @@ void BTreePage::indirectRotateLeft(BTreePage &leftChild, BTreePage &rightChild,
         Size dataSize = rightChild.cellDataSize(0);
         leftChild.insertCell(rightChild.cellKey(0), dataSize, leftChild.numCells());
         std::memcpy(leftChild.cellData(leftChild.numCells() - 1), rightChild.cellData(0), dataSize);
-        setCellKey(index + 1, rightChild.cellKey(1));
+        setCellKey(index + 1, indirectRotateLeftSeparator(rightChild));
         rightChild.removeCell(0);
     }
 }
@@ -501,8 +670,11 @@ void BTreePage::indirectMergeChildren(BTreePage &leftChild, BTreePage &rightChil
 
 void BTreePage::indirectPushHead(Key oldHeadKey, BTreePage &childPage)
 {
-    setCellKey(0, oldHeadKey);
-    insertCell(Key(), sizeof(Page::Index), 0);
+    // The cell at index 0 never stores a key, so rather than moving it,
+    // insert the keyed cell for the old head after it and repoint the head
+    Page::Index oldHeadIndex = indirectPageIndex(0);
+    insertCell(oldHeadKey, sizeof(Page::Index), 1);
+    *reinterpret_cast<Page::Index*>(cellData(1)) = oldHeadIndex;
     *reinterpret_cast<Page::Index*>(cellData(0)) = childPage.pageIndex();
     childPage.setParent(pageIndex());
 }
@@ -520,8 +692,8 @@ void BTreePage::indirectPushTail(Key key, BTreePage &childPage)
     
 void BTreePage::indirectPopHead()
 {
-    setCellKey(1, Key());
-    removeCell(0);
+    *reinterpret_cast<Page::Index*>(cellData(0)) = indirectPageIndex(1);
+    removeCell(1);
 }
 
 void BTreePage::indirectPopTail()
@@ -529,6 +701,30 @@ void BTreePage::indirectPopTail()
     removeCell(numCells() - 1);
 }
 
+void BTreePage::indirectPullUpChild(std::span<Pointer*> trackPointers)
+{
+    BTreePage childPage = getPage(indirectPageIndex(0));
+
+    for(Pointer *trackPointer : trackPointers) {
+        if(trackPointer->pageIndex == childPage.pageIndex()) {
+            trackPointer->pageIndex = pageIndex();
+        }
+    }
+
+    Page::Index parentIndex = parent();
+    std::memcpy(mPage.data(), childPage.page().data(), mPage.size());
+    mPage.setDirty(true);
+    setParent(parentIndex);
+
+    if(type() == Type::Indirect) {
+        for(Index i=0; i<numCells(); i++) {
+            getPage(indirectPageIndex(i)).setParent(pageIndex());
+        }
+    }
+
+    pageSet().deletePage(childPage.page());
+}
+
 void BTreePage::print(const std::string &prefix)
 {
     switch(type()) {
@@ -637,7 +833,7 @@ uint16_t BTreePage::allocateCell(Key key, Size dataSize)
     }
 
     Size totalSize = totalKeySize + totalDataSize;
-    if(head.dataStart - arrayEnd < totalSize) {
+    if(head.dataStart < arrayEnd + totalSize) {
         defragPage();
     }
 
@@ -678,7 +874,8 @@ bool BTreePage::canAllocateCell(Size keySize, Size dataSize)
     return (head.freeSpace >= totalSize + sizeof(uint16_t));
 }
 
-BTreePage::Index BTreePage::search(Key key, KeyComparator &comparator, SearchComparison comparison, SearchPosition position)
+template<typename Comparator>
+BTreePage::Index BTreePage::search(Key key, Comparator &comparator, SearchComparison comparison, SearchPosition position)
 {
     if(numCells() == 0) {
         return kInvalidIndex;
@@ -688,7 +885,7 @@ BTreePage::Index BTreePage::search(Key key, KeyComparator &comparator, SearchCom
     Index end = numCells() - 1;
 
     int startCmp = (type() == Indirect) ? -1 : comparator(cellKey(start), key);
-    int endCmp = comparator(cellKey(end), key);
+    int endCmp = (type() == Indirect && end == 0) ? -1 : comparator(cellKey(end), key);
 
     auto match = [&](int cmp) {
         switch(comparison) {
@@ -754,11 +951,9 @@ BTreePage::Index BTreePage::search(Key key, KeyComparator &comparator, SearchCom
 
 BTreePage::Index BTreePage::search(Key key, SearchComparison comparison, SearchPosition position)
 {
-    KeyComparator defaultComparator = [&](Key a, Key b) {
-        return mKeyDefinition.compare(a, b);
-    };
-
-    return search(key, defaultComparator, comparison, position);
+    return withComparator(mKeyDefinition, [&](auto &comparator) {
+        return search(key, comparator, comparison, position);
+    });
 }
 
 BTreePage BTreePage::getPage(Page::Index index)
@@ -768,6 +963,7 @@ BTreePage BTreePage::getPage(Page::Index index)
 
 void BTreePage::defragPage()
 {
+    mPage.setDirty(true);
     Header &head = header();
     uint16_t *offsets = offsetsArray();
 
@@ -792,4 +988,14 @@ void BTreePage::defragPage()
 PageSet &BTreePage::pageSet()
 {
     return mPage.pageSet();
-}
\ No newline at end of file
+}
+
+#define INSTANTIATE_LOOKUPS(Comparator) \
+    template BTreePage::Index BTreePage::leafLookup(Key key, Comparator &comparator, SearchComparison comparison, SearchPosition position); \
+    template Page::Index BTreePage::indirectLookup(Key key, Comparator &comparator, SearchComparison comparison, SearchPosition position);
+
+INSTANTIATE_LOOKUPS(BTreePage::KeyComparator)
+INSTANTIATE_LOOKUPS(BTreePage::DefinitionKeyComparator)
+INSTANTIATE_LOOKUPS(BTreePage::UInt32KeyComparator)
+INSTANTIATE_LOOKUPS(BTreePage::BytesKeyComparator)
+INSTANTIATE_LOOKUPS(BTreePage::PrefixKeyComparator)
\ No newline at end of file
@@ -3,6 +3,8 @@
 
 #include "PageSet.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <span>
 #include <functional>
@@ -33,13 +35,75 @@ public:
 
     class KeyDefinition {
     public:
+        // Kinds of keys which the tree can compare itself, without a virtual
+        // call to compare() for each probe
+        enum class ComparatorKind {
+            Custom,
+            UInt32,
+            Bytes
+        };
+
         virtual ~KeyDefinition() = default;
 
         virtual Size fixedSize() = 0;
         virtual int compare(Key a, Key b) = 0;
         virtual void print(Key key) = 0;
+        virtual ComparatorKind comparatorKind() { return ComparatorKind::Custom; }
+    };
+
+    // Comparators which searches are instantiated for, so that the comparison
+    // is inlined into the binary search
+    struct DefinitionKeyComparator {
+        KeyDefinition &definition;
+        int operator()(Key a, Key b) const { return definition.compare(a, b); }
     };
 
+    struct UInt32KeyComparator {
+        int operator()(Key a, Key b) const {
+            uint32_t valueA = *reinterpret_cast<uint32_t*>(a.data);
+            uint32_t valueB = *reinterpret_cast<uint32_t*>(b.data);
+            return (valueA > valueB) - (valueA < valueB);
+        }
+    };
+
+    // Orders keys by their bytes, with a key sorting before any longer key
+    // which it is a prefix of
+    struct BytesKeyComparator {
+        int operator()(Key a, Key b) const {
+            int result = std::memcmp(a.data, b.data, std::min(a.size, b.size));
+            return (result != 0) ? result : int(a.size) - int(b.size);
+        }
+    };
+
+    // Compares stored key a against a partial key b, treating every key
+    // which starts with b as equal to it.  Separator keys may be truncated,
+    // so a stored key which is a proper prefix of b sorts before it.
+    struct PrefixKeyComparator {
+        int operator()(Key a, Key b) const {
+            int result = std::memcmp(a.data, b.data, std::min(a.size, b.size));
+            return (result != 0) ? result : (a.size < b.size) ? -1 : 0;
+        }
+    };
+
+    // Calls function with the comparator for the given key definition
+    template<typename Function>
+    static auto withComparator(KeyDefinition &definition, Function &&function) {
+        switch(definition.comparatorKind()) {
+            case KeyDefinition::ComparatorKind::UInt32: {
+                UInt32KeyComparator comparator;
+                return function(comparator);
+            }
+            case KeyDefinition::ComparatorKind::Bytes: {
+                BytesKeyComparator comparator;
+                return function(comparator);
+            }
+            default: {
+                DefinitionKeyComparator comparator{definition};
+                return function(comparator);
+            }
+        }
+    }
+
     class DataDefinition {
     public:
         virtual ~DataDefinition() = default;
@@ -70,6 +134,8 @@ public:
     };
 
     BTreePage(Page &page, KeyDefinition &keyDefinition, DataDefinition &dataDefinition);
+    BTreePage(const BTreePage &other);
+    ~BTreePage();
 
     void initialize(Type type);
 
@@ -88,10 +154,14 @@ public:
     void setNextSibling(Page::Index prevSibling);
 
     Index numCells();
+    uint32_t freeSpace();
 
     Key cellKey(Index index);
+    bool canSetCellKey(Index index, Size keySize);
     void setCellKey(Index index, Key key);
 
+    Size separatorSize(Key left, Key right);
+
     void *cellData(Index index);
     Size cellDataSize(Index index);
 
@@ -100,11 +170,16 @@ public:
     void removeCell(Index index);
 
     BTreePage split(Index index);
+    // Where to split a full page so that both halves hold about the same
+    // number of bytes once key is added
+    Index splitIndex(Key key, Size dataSize);
+    void relocate(BTreePage &newPage);
 
     bool isDeficient();
     bool canSupplyItem(Index index);
 
-    Index leafLookup(Key key, KeyComparator &comparator, SearchComparison comparison, SearchPosition position);
+    template<typename Comparator> Index leafLookup(Key key, Comparator &comparator, SearchComparison comparison, SearchPosition position);
+    Index leafLookup(Key key, SearchComparison comparison, SearchPosition position);
     bool leafCanAdd(size_t keySize, size_t dataSize);
     Index leafAdd(Key key, size_t dataSize);
     void leafRemove(Index index, std::span<Pointer*> trackPointers);
@@ -113,12 +188,14 @@ public:
     bool indirectCanAdd(size_t keySize);
     void indirectAdd(Key key, BTreePage &childPage);
     Page::Index indirectPageIndex(Index index);
-    Page::Index indirectLookup(Key key, KeyComparator &comparator, SearchComparison comparison, SearchPosition position);
+    template<typename Comparator> Page::Index indirectLookup(Key key, Comparator &comparator, SearchComparison comparison, SearchPosition position);
+    Page::Index indirectLookup(Key key, SearchComparison comparison, SearchPosition position);
     void indirectRectifyDeficientChild(BTreePage &childPage, std::span<Pointer*> trackPointers);
     void indirectPushHead(Key oldHeadKey, BTreePage &childPage);
     void indirectPushTail(Key key, BTreePage &childPage);
     void indirectPopHead();
     void indirectPopTail();
+    void indirectPullUpChild(std::span<Pointer*> trackPointers);
 
     void print(const std::string &prefix);
 
@@ -126,8 +203,8 @@ private:
     struct Header {
         Type type;
         uint16_t numCells;
-        uint16_t dataStart;
-        uint16_t freeSpace;
+        uint32_t dataStart;
+        uint32_t freeSpace;
         Page::Index parent;
         Page::Index prevSibling;
         Page::Index nextSibling;
@@ -149,19 +226,21 @@ private:
 
     void removeCells(Index begin, Index end);
 
-    Index search(Key key, KeyComparator &comparator, SearchComparison comparison, SearchPosition position);
+    template<typename Comparator> Index search(Key key, Comparator &comparator, SearchComparison comparison, SearchPosition position);
     Index search(Key key, SearchComparison comparison, SearchPosition position);
 
-    Size freeSpace();
     void defragPage();
 
     BTreePage getPage(Page::Index index);
 
     PageSet &pageSet();
 
+    Key indirectRotateLeftSeparator(BTreePage &rightChild);
+    Key indirectRotateRightSeparator(BTreePage &leftChild);
     void indirectRotateRight(BTreePage &leftChild, BTreePage &rightChild, Index index, std::span<Pointer*> trackPointers);
     void indirectRotateLeft(BTreePage &leftChild, BTreePage &rightChild, Index index, std::span<Pointer*> trackPointers);
     void indirectMergeChildren(BTreePage &leftChild, BTreePage &rightChild, Index index, std::span<Pointer*> trackPointers);
+    bool indirectCanMergeChildren(BTreePage &leftChild, BTreePage &rightChild, Index index);
 
     Page &mPage;
     KeyDefinition &mKeyDefinition;
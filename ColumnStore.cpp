@@ -0,0 +1,568 @@
+#include "ColumnStore.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iostream>
+
+// Entries are keyed by their type followed by two numbers, big-endian so
+// that keys compare bytewise.  Groups are keyed by their first row id, and
+// dictionary entries by column and code.
+class ColumnKey {
+public:
+    static const BTreePage::Size kSize = 9;
+
+    ColumnKey(uint8_t type, uint32_t a, uint32_t b)
+    {
+        mData[0] = type;
+        for(int i=0; i<4; i++) {
+            mData[1 + i] = uint8_t(a >> (24 - 8 * i));
+            mData[5 + i] = uint8_t(b >> (24 - 8 * i));
+        }
+    }
+
+    operator BTree::Key() { return BTree::Key(mData, kSize); }
+
+    static uint8_t type(const void *key) { return reinterpret_cast<const uint8_t*>(key)[0]; }
+    static uint32_t first(const void *key) { return decode(reinterpret_cast<const uint8_t*>(key) + 1); }
+    static uint32_t second(const void *key) { return decode(reinterpret_cast<const uint8_t*>(key) + 5); }
+
+private:
+    static uint32_t decode(const uint8_t *data)
+    {
+        return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | uint32_t(data[3]);
+    }
+
+    uint8_t mData[kSize];
+};
+
+class ColumnKeyDefinition : public BTree::KeyDefinition {
+public:
+    BTreePage::Size fixedSize() override { return ColumnKey::kSize; }
+    int compare(BTree::Key a, BTree::Key b) override { return BTreePage::BytesKeyComparator()(a, b); }
+    ComparatorKind comparatorKind() override { return ComparatorKind::Bytes; }
+    void print(BTree::Key key) override {
+        std::cout << int(ColumnKey::type(key.data)) << ":" << ColumnKey::first(key.data) << ":" << ColumnKey::second(key.data);
+    }
+};
+
+class ColumnDataDefinition : public BTree::DataDefinition {
+public:
+    BTreePage::Size fixedSize() override { return 0; }
+    void print(void *) override {}
+};
+
+bool ColumnStore::Group::removed(unsigned int position) const
+{
+    return (deleted[position / 64] >> (position % 64)) & 1;
+}
+
+ColumnStore::ColumnStore(Page &rootPage, Table &table)
+: mTable(table)
+, mPageSet(rootPage.pageSet())
+{
+    mTree = std::make_unique<BTree>(mPageSet, rootPage.index(), std::make_unique<ColumnKeyDefinition>(), std::make_unique<ColumnDataDefinition>());
+
+    // Groups are as large as a page of the widest column allows
+    size_t width = sizeof(uint32_t);
+    for(const Record::Schema::Field &field : mTable.schema().fields) {
+        if(field.type == Value::Type::BigInt || field.type == Value::Type::Double || field.type == Value::Type::Timestamp || field.type == Value::Type::Decimal) {
+            width = sizeof(uint64_t);
+        }
+    }
+    mGroupCapacity = mPageSet.pageSize() / width;
+    mDictionaries.resize(mTable.schema().fields.size());
+}
+
+void ColumnStore::initialize()
+{
+    mTree->initialize();
+}
+
+void ColumnStore::load()
+{
+    // Dictionary entries are ordered by code, so each dictionary is read
+    // back in the order it was built
+    ColumnKey key(uint8_t(EntryType::Dictionary), 0, 0);
+    BTree::Pointer pointer = mTree->lookup(key, BTree::SearchComparison::GreaterThanEqual, BTree::SearchPosition::First);
+    while(pointer.valid()) {
+        unsigned int column = ColumnKey::first(mTree->key(pointer));
+        const char *data = reinterpret_cast<const char*>(mTree->data(pointer));
+        std::string string(data, mTree->dataSize(pointer) - 1);
+
+        Dictionary &dictionary = mDictionaries[column];
+        dictionary.codes[string] = dictionary.strings.size();
+        dictionary.strings.push_back(std::move(string));
+
+        mTree->moveNext(pointer);
+    }
+}
+
+Table &ColumnStore::table()
+{
+    return mTable;
+}
+
+Table::RowId ColumnStore::nextRowId()
+{
+    ColumnKey key(uint8_t(EntryType::Group), UINT32_MAX, 0);
+    BTree::Pointer pointer = mTree->lookup(key, BTree::SearchComparison::LessThanEqual, BTree::SearchPosition::Last);
+    if(!pointer.valid()) {
+        return 1;
+    }
+
+    readGroup(pointer, mGroup);
+    return mGroup.firstRowId + mGroup.count;
+}
+
+void ColumnStore::add(Table::RowId rowId, Record::Writer &writer)
+{
+    // New strings are added to their dictionaries first, since that may
+    // move the group's entry
+    for(unsigned int i=0; i<mDictionaries.size(); i++) {
+        if(mTable.schema().fields[i].type == Value::Type::String && !writer.field(i).isNull()) {
+            stringCode(i, writer.field(i).stringValue());
+        }
+    }
+
+    // Rows arrive in row id order, so a row either extends the last group
+    // or starts a new one
+    ColumnKey key(uint8_t(EntryType::Group), rowId, 0);
+    BTree::Pointer pointer = mTree->lookup(key, BTree::SearchComparison::LessThanEqual, BTree::SearchPosition::Last);
+    if(pointer.valid()) {
+        readGroup(pointer, mGroup);
+    }
+
+    if(!pointer.valid() || mGroup.count == mGroupCapacity || mGroup.firstRowId + mGroup.count != rowId) {
+        mGroup.firstRowId = rowId;
+        mGroup.count = 0;
+        mGroup.pages.clear();
+        for(unsigned int i=0; i<mTable.schema().fields.size(); i++) {
+            mGroup.pages.push_back(mPageSet.addPage().index());
+        }
+        mGroup.deleted.assign((mGroupCapacity + 63) / 64, 0);
+        mGroup.nullPages.assign(mGroup.pages.size(), Page::Index(Page::kInvalidIndex));
+
+        ColumnKey newKey(uint8_t(EntryType::Group), rowId, 0);
+        pointer = mTree->add(newKey, groupDataSize());
+    }
+
+    // The group is written back anyway, so new null pages need no check
+    for(unsigned int i=0; i<mGroup.pages.size(); i++) {
+        writeValue(mGroup, i, mGroup.count, writer.field(i));
+    }
+    mGroup.count++;
+    writeGroup(pointer, mGroup);
+}
+
+void ColumnStore::modify(Table::RowId rowId, Record::Writer &writer)
+{
+    for(unsigned int i=0; i<mDictionaries.size(); i++) {
+        if(mTable.schema().fields[i].type == Value::Type::String && !writer.field(i).isNull()) {
+            stringCode(i, writer.field(i).stringValue());
+        }
+    }
+
+    BTree::Pointer pointer = findGroup(rowId, mGroup);
+    bool changed = false;
+    for(unsigned int i=0; i<mGroup.pages.size(); i++) {
+        changed |= writeValue(mGroup, i, rowId - mGroup.firstRowId, writer.field(i));
+    }
+    if(changed) {
+        writeGroup(pointer, mGroup);
+    }
+}
+
+void ColumnStore::remove(Table::RowId rowId)
+{
+    BTree::Pointer pointer = findGroup(rowId, mGroup);
+    unsigned int position = rowId - mGroup.firstRowId;
+    mGroup.deleted[position / 64] |= uint64_t(1) << (position % 64);
+
+    unsigned int removed = 0;
+    for(uint64_t word : mGroup.deleted) {
+        removed += std::popcount(word);
+    }
+
+    // A full group with no rows left is released along with its pages
+    if(mGroup.count == mGroupCapacity && removed == mGroup.count) {
+        for(Page::Index index : mGroup.pages) {
+            mPageSet.deletePage(mPageSet.page(index));
+        }
+        for(Page::Index index : mGroup.nullPages) {
+            if(index != Page::kInvalidIndex) {
+                mPageSet.deletePage(mPageSet.page(index));
+            }
+        }
+        mTree->remove(pointer);
+    } else {
+        writeGroup(pointer, mGroup);
+    }
+}
+
+bool ColumnStore::firstGroup(Group &group)
+{
+    BTree::Pointer pointer = mTree->first();
+    if(!pointer.valid() || ColumnKey::type(mTree->key(pointer)) != uint8_t(EntryType::Group)) {
+        return false;
+    }
+
+    readGroup(pointer, group);
+    return true;
+}
+
+bool ColumnStore::nextGroup(Group &group)
+{
+    ColumnKey key(uint8_t(EntryType::Group), group.firstRowId, 0);
+    BTree::Pointer pointer = mTree->lookup(key, BTree::SearchComparison::GreaterThan, BTree::SearchPosition::First);
+    if(!pointer.valid() || ColumnKey::type(mTree->key(pointer)) != uint8_t(EntryType::Group)) {
+        return false;
+    }
+
+    readGroup(pointer, group);
+    return true;
+}
+
+bool ColumnStore::reloadGroup(Group &group)
+{
+    ColumnKey key(uint8_t(EntryType::Group), group.firstRowId, 0);
+    BTree::Pointer pointer = mTree->lookup(key, BTree::SearchComparison::Equal, BTree::SearchPosition::First);
+    if(!pointer.valid()) {
+        return false;
+    }
+
+    readGroup(pointer, group);
+    return true;
+}
+
+ValueRef ColumnStore::readValue(const Group &group, unsigned int column, unsigned int position)
+{
+    if(group.nullPages[column] != Page::kInvalidIndex) {
+        const uint8_t *nulls = mPageSet.page(group.nullPages[column]).data();
+        if((nulls[position / 8] >> (position % 8)) & 1) {
+            return ValueRef::null();
+        }
+    }
+
+    const uint8_t *data = mPageSet.page(group.pages[column]).data();
+    switch(mTable.schema().fields[column].type) {
+        case Value::Type::Int: return ValueRef(reinterpret_cast<const int*>(data)[position]);
+        case Value::Type::Float: return ValueRef(reinterpret_cast<const float*>(data)[position]);
+        case Value::Type::Boolean: return ValueRef(data[position] != 0);
+        case Value::Type::String: return ValueRef(std::string_view(mDictionaries[column].strings[reinterpret_cast<const uint32_t*>(data)[position]]));
+        case Value::Type::BigInt:
+        case Value::Type::Timestamp:
+        case Value::Type::Decimal: return ValueRef(mTable.schema().fields[column].type, reinterpret_cast<const int64_t*>(data)[position]);
+        case Value::Type::Double: return ValueRef(reinterpret_cast<const double*>(data)[position]);
+        case Value::Type::Null: break;
+    }
+
+    return ValueRef();
+}
+
+void ColumnStore::readColumn(const Group &group, unsigned int column, const std::vector<unsigned int> &positions, RowBatch::Column &result)
+{
+    if(positions.empty()) {
+        return;
+    }
+
+    // NULL rows are found before the column's page is fetched, since fetching
+    // one page may evict another
+    std::vector<unsigned int> nullRows;
+    if(group.nullPages[column] != Page::kInvalidIndex) {
+        const uint8_t *nulls = mPageSet.page(group.nullPages[column]).data();
+        for(unsigned int i=0; i<positions.size(); i++) {
+            if((nulls[positions[i] / 8] >> (positions[i] % 8)) & 1) {
+                nullRows.push_back(i);
+            }
+        }
+    }
+    unsigned int base = result.size();
+
+    // Runs without removed rows are copied whole
+    const uint8_t *data = mPageSet.page(group.pages[column]).data();
+    bool contiguous = positions.back() - positions.front() + 1 == positions.size();
+    unsigned int begin = positions.front();
+    unsigned int end = positions.back() + 1;
+    switch(mTable.schema().fields[column].type) {
+        case Value::Type::Int:
+        {
+            const int *values = reinterpret_cast<const int*>(data);
+            if(contiguous) {
+                result.ints.insert(result.ints.end(), values + begin, values + end);
+            } else {
+                for(unsigned int position : positions) {
+                    result.ints.push_back(values[position]);
+                }
+            }
+            break;
+        }
+
+        case Value::Type::Float:
+        {
+            const float *values = reinterpret_cast<const float*>(data);
+            if(contiguous) {
+                result.floats.insert(result.floats.end(), values + begin, values + end);
+            } else {
+                for(unsigned int position : positions) {
+                    result.floats.push_back(values[position]);
+                }
+            }
+            break;
+        }
+
+        case Value::Type::Boolean:
+            if(contiguous) {
+                result.booleans.insert(result.booleans.end(), data + begin, data + end);
+            } else {
+                for(unsigned int position : positions) {
+                    result.booleans.push_back(data[position]);
+                }
+            }
+            break;
+
+        case Value::Type::String:
+        {
+            // NULL rows have no code
+            const uint32_t *codes = reinterpret_cast<const uint32_t*>(data);
+            const std::vector<std::string> &strings = mDictionaries[column].strings;
+            auto nullRow = nullRows.begin();
+            for(unsigned int i=0; i<positions.size(); i++) {
+                if(nullRow != nullRows.end() && *nullRow == i) {
+                    result.strings.emplace_back();
+                    nullRow++;
+                } else {
+                    result.strings.push_back(strings[codes[positions[i]]]);
+                }
+            }
+            break;
+        }
+
+        case Value::Type::BigInt:
+        case Value::Type::Timestamp:
+        case Value::Type::Decimal:
+        {
+            const int64_t *values = reinterpret_cast<const int64_t*>(data);
+            if(contiguous) {
+                result.integers.insert(result.integers.end(), values + begin, values + end);
+            } else {
+                for(unsigned int position : positions) {
+                    result.integers.push_back(values[position]);
+                }
+            }
+            break;
+        }
+
+        case Value::Type::Double:
+        {
+            const double *values = reinterpret_cast<const double*>(data);
+            if(contiguous) {
+                result.doubles.insert(result.doubles.end(), values + begin, values + end);
+            } else {
+                for(unsigned int position : positions) {
+                    result.doubles.push_back(values[position]);
+                }
+            }
+            break;
+        }
+
+        case Value::Type::Null:
+            break;
+    }
+
+    for(unsigned int row : nullRows) {
+        result.setNull(base + row);
+    }
+}
+
+Page::Index ColumnStore::rootIndex()
+{
+    return mTree->rootIndex();
+}
+
+void ColumnStore::relocatePages(Page::Index limit, std::vector<Page::Index> &oldPages)
+{
+    mTree->relocatePages(limit, oldPages);
+
+    // Column pages are copied one at a time, since adding a page may evict
+    // the one being copied
+    std::vector<uint8_t> data(mPageSet.pageSize());
+    for(BTree::Pointer pointer = mTree->first(); pointer.valid() && ColumnKey::type(mTree->key(pointer)) == uint8_t(EntryType::Group); mTree->moveNext(pointer)) {
+        readGroup(pointer, mGroup);
+
+        bool moved = false;
+        for(std::vector<Page::Index> *pages : {&mGroup.pages, &mGroup.nullPages}) {
+            for(Page::Index &index : *pages) {
+                if(index == Page::kInvalidIndex || index < limit) {
+                    continue;
+                }
+
+                std::memcpy(data.data(), mPageSet.page(index).data(), data.size());
+                Page &newPage = mPageSet.addPage();
+                std::memcpy(newPage.data(), data.data(), data.size());
+                newPage.setDirty(true);
+
+                oldPages.push_back(index);
+                index = newPage.index();
+                moved = true;
+            }
+        }
+
+        if(moved) {
+            writeGroup(pointer, mGroup);
+        }
+    }
+}
+
+ColumnStore::SpaceStats ColumnStore::spaceStats()
+{
+    SpaceStats stats;
+    for(BTree::Pointer pointer = mTree->first(); pointer.valid() && ColumnKey::type(mTree->key(pointer)) == uint8_t(EntryType::Group); mTree->moveNext(pointer)) {
+        readGroup(pointer, mGroup);
+        stats.groups++;
+        stats.rows += mGroup.count;
+        for(uint64_t word : mGroup.deleted) {
+            stats.rows -= std::popcount(word);
+        }
+        stats.columnPages += mGroup.pages.size();
+        stats.columnPages += std::ranges::count_if(mGroup.nullPages, [](Page::Index index) { return index != Page::kInvalidIndex; });
+    }
+
+    for(Dictionary &dictionary : mDictionaries) {
+        stats.dictionaryEntries += dictionary.strings.size();
+    }
+    stats.tree = mTree->spaceStats();
+
+    return stats;
+}
+
+BTreePage::Size ColumnStore::groupDataSize()
+{
+    return sizeof(uint32_t) + 2 * mTable.schema().fields.size() * sizeof(Page::Index) + (mGroupCapacity + 63) / 64 * sizeof(uint64_t);
+}
+
+BTree::Pointer ColumnStore::findGroup(Table::RowId rowId, Group &group)
+{
+    ColumnKey key(uint8_t(EntryType::Group), rowId, 0);
+    BTree::Pointer pointer = mTree->lookup(key, BTree::SearchComparison::LessThanEqual, BTree::SearchPosition::Last);
+    readGroup(pointer, group);
+
+    return pointer;
+}
+
+// A group is stored as its row count, the index of each column's page, a
+// bitmap of removed rows, and the index of each column's null page.  Groups
+// written before columns could hold NULL end before the null pages.  Cells
+// are not aligned, so fields are copied.
+void ColumnStore::readGroup(BTree::Pointer pointer, Group &group)
+{
+    const uint8_t *data = reinterpret_cast<const uint8_t*>(mTree->data(pointer));
+    bool nullPages = mTree->dataSize(pointer) == groupDataSize();
+    group.firstRowId = ColumnKey::first(mTree->key(pointer));
+
+    uint32_t count;
+    std::memcpy(&count, data, sizeof(count));
+    group.count = count;
+    data += sizeof(count);
+
+    group.pages.resize(mTable.schema().fields.size());
+    std::memcpy(group.pages.data(), data, group.pages.size() * sizeof(Page::Index));
+    data += group.pages.size() * sizeof(Page::Index);
+
+    group.deleted.resize((mGroupCapacity + 63) / 64);
+    std::memcpy(group.deleted.data(), data, group.deleted.size() * sizeof(uint64_t));
+    data += group.deleted.size() * sizeof(uint64_t);
+
+    group.nullPages.assign(group.pages.size(), Page::Index(Page::kInvalidIndex));
+    if(nullPages) {
+        std::memcpy(group.nullPages.data(), data, group.nullPages.size() * sizeof(Page::Index));
+    }
+}
+
+void ColumnStore::writeGroup(BTree::Pointer pointer, const Group &group)
+{
+    // Resizing to the same size marks the page dirty
+    mTree->resize(pointer, groupDataSize());
+    uint8_t *data = reinterpret_cast<uint8_t*>(mTree->data(pointer));
+
+    uint32_t count = group.count;
+    std::memcpy(data, &count, sizeof(count));
+    data += sizeof(count);
+
+    std::memcpy(data, group.pages.data(), group.pages.size() * sizeof(Page::Index));
+    data += group.pages.size() * sizeof(Page::Index);
+
+    std::memcpy(data, group.deleted.data(), group.deleted.size() * sizeof(uint64_t));
+    data += group.deleted.size() * sizeof(uint64_t);
+
+    std::memcpy(data, group.nullPages.data(), group.nullPages.size() * sizeof(Page::Index));
+}
+
+bool ColumnStore::writeValue(Group &group, unsigned int column, unsigned int position, Value &value)
+{
+    // The dictionary is updated before the column page is fetched
+    uint32_t code = 0;
+    Value::Type type = mTable.schema().fields[column].type;
+    if(type == Value::Type::String && !value.isNull()) {
+        code = stringCode(column, value.stringValue());
+    }
+
+    bool changed = false;
+    Page::Index &nullPage = group.nullPages[column];
+    if(value.isNull() && nullPage == Page::kInvalidIndex) {
+        Page &page = mPageSet.addPage();
+        std::memset(page.data(), 0, mPageSet.pageSize());
+        page.setDirty(true);
+        nullPage = page.index();
+        changed = true;
+    }
+    if(nullPage != Page::kInvalidIndex) {
+        Page &page = mPageSet.page(nullPage);
+        uint8_t bit = 1 << (position % 8);
+        page.data()[position / 8] = value.isNull() ? (page.data()[position / 8] | bit) : (page.data()[position / 8] & ~bit);
+        page.setDirty(true);
+    }
+
+    // A NULL row leaves whatever the column page held
+    if(value.isNull()) {
+        return changed;
+    }
+
+    Page &page = mPageSet.page(group.pages[column]);
+    uint8_t *data = page.data();
+
+    switch(type) {
+        case Value::Type::Int: reinterpret_cast<int*>(data)[position] = value.intValue(); break;
+        case Value::Type::Float: reinterpret_cast<float*>(data)[position] = value.floatValue(); break;
+        case Value::Type::Boolean: data[position] = value.booleanValue() ? 1 : 0; break;
+        case Value::Type::String: reinterpret_cast<uint32_t*>(data)[position] = code; break;
+        case Value::Type::BigInt:
+        case Value::Type::Timestamp:
+        case Value::Type::Decimal: reinterpret_cast<int64_t*>(data)[position] = value.integerValue(type); break;
+        case Value::Type::Double: reinterpret_cast<double*>(data)[position] = value.doubleValue(); break;
+        case Value::Type::Null: break;
+    }
+    page.setDirty(true);
+    return changed;
+}
+
+uint32_t ColumnStore::stringCode(unsigned int column, std::string_view string)
+{
+    Dictionary &dictionary = mDictionaries[column];
+    auto it = dictionary.codes.find(string);
+    if(it != dictionary.codes.end()) {
+        return it->second;
+    }
+
+    uint32_t code = dictionary.strings.size();
+    ColumnKey key(uint8_t(EntryType::Dictionary), column, code);
+    BTree::Pointer pointer = mTree->add(key, string.size() + 1);
+    uint8_t *data = reinterpret_cast<uint8_t*>(mTree->data(pointer));
+    std::memcpy(data, string.data(), string.size());
+    data[string.size()] = '\0';
+
+    dictionary.codes.emplace(string, code);
+    dictionary.strings.emplace_back(string);
+
+    return code;
+}
\ No newline at end of file
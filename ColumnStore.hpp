@@ -0,0 +1,114 @@
+#ifndef COLUMNSTORE_HPP
+#define COLUMNSTORE_HPP
+
+#include "BTree.hpp"
+#include "Record.hpp"
+#include "RowBatch.hpp"
+#include "Table.hpp"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// A copy of a table's rows stored column by column, kept up to date by the
+// table alongside its row tree, so that scans read only the columns they
+// use.  Rows are held in groups of consecutive row ids, each with one page
+// per column.  Int and Float columns are stored as arrays of 4-byte values,
+// the 64-bit types as arrays of 8-byte values, and Boolean columns as bytes.
+// Strings are replaced by 4-byte codes into a per-column dictionary, which
+// only grows.  Every value therefore has a fixed position, and rows are
+// modified in place and removed by setting a bit in their group.  A column
+// which holds a NULL in a group is given a second page, a bitmap of its
+// NULL rows, when the first one is written.
+//
+// The group directory and the dictionaries share one tree, which is the
+// root of the store.
+class ColumnStore {
+public:
+    struct Group {
+        Table::RowId firstRowId;
+        unsigned int count;
+        std::vector<Page::Index> pages;
+        std::vector<uint64_t> deleted;
+
+        // Page::kInvalidIndex for the columns with no NULLs
+        std::vector<Page::Index> nullPages;
+
+        bool removed(unsigned int position) const;
+    };
+
+    ColumnStore(Page &rootPage, Table &table);
+
+    void initialize();
+    void load();
+
+    Table &table();
+
+    // Row ids up to this one may have been used by rows since removed
+    Table::RowId nextRowId();
+
+    void add(Table::RowId rowId, Record::Writer &writer);
+    void modify(Table::RowId rowId, Record::Writer &writer);
+    void remove(Table::RowId rowId);
+
+    // Reads the first group, or the one following group.  Returns false if
+    // there is none.
+    bool firstGroup(Group &group);
+    bool nextGroup(Group &group);
+    bool reloadGroup(Group &group);
+
+    // The string of a String column refers to the column's dictionary
+    ValueRef readValue(const Group &group, unsigned int column, unsigned int position);
+
+    // Appends the values of column at each of positions to result
+    void readColumn(const Group &group, unsigned int column, const std::vector<unsigned int> &positions, RowBatch::Column &result);
+
+    Page::Index rootIndex();
+    void relocatePages(Page::Index limit, std::vector<Page::Index> &oldPages);
+
+    struct SpaceStats {
+        size_t groups = 0;
+        size_t rows = 0;
+        size_t columnPages = 0;
+        size_t dictionaryEntries = 0;
+        BTree::SpaceStats tree;
+    };
+    SpaceStats spaceStats();
+
+private:
+    enum class EntryType : uint8_t {
+        Group,
+        Dictionary
+    };
+
+    // Codes are looked up by string_view without building a string
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view string) const { return std::hash<std::string_view>()(string); }
+    };
+
+    struct Dictionary {
+        std::vector<std::string> strings;
+        std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> codes;
+    };
+
+    BTreePage::Size groupDataSize();
+    BTree::Pointer findGroup(Table::RowId rowId, Group &group);
+    void readGroup(BTree::Pointer pointer, Group &group);
+    void writeGroup(BTree::Pointer pointer, const Group &group);
+    // Returns true if the group's null pages changed, in which case the
+    // caller writes the group back
+    bool writeValue(Group &group, unsigned int column, unsigned int position, Value &value);
+    uint32_t stringCode(unsigned int column, std::string_view string);
+
+    Table &mTable;
+    PageSet &mPageSet;
+    std::unique_ptr<BTree> mTree;
+    unsigned int mGroupCapacity;
+    std::vector<Dictionary> mDictionaries;
+    Group mGroup;
+};
+
+#endif
\ No newline at end of file
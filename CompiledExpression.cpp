@@ -0,0 +1,356 @@
+#include "CompiledExpression.hpp"
+
+// Constants and parameters do not read any fields
+class ConstantContext : public Expression::EvaluateContext {
+public:
+    Value fieldValue(unsigned int) override { return Value(0); }
+};
+
+CompiledExpression::CompiledExpression(Expression &expression)
+: mExpression(expression)
+{
+    mCompiled = false;
+}
+
+void CompiledExpression::compile()
+{
+    mProgram.clear();
+    mRegisters.clear();
+    mStrings.clear();
+    mStringStorage.clear();
+    mLoadedFields.clear();
+
+    mCompiled = compileNode(mExpression, mResult);
+
+    // Constant strings are only referred to once their storage stops moving
+    for(unsigned int i=0; i<mStrings.size(); i++) {
+        mStrings[i] = mStringStorage[i].stringValue();
+    }
+}
+
+bool CompiledExpression::compiled()
+{
+    return mCompiled;
+}
+
+Value CompiledExpression::evaluate(Expression::EvaluateContext &context)
+{
+    if(!mCompiled || !run(context)) {
+        return mExpression.evaluate(context);
+    }
+
+    switch(mResult.type) {
+        case Value::Type::Int: return Value(mRegisters[mResult.index].intValue);
+        case Value::Type::Float: return Value(mRegisters[mResult.index].floatValue);
+        case Value::Type::String: return Value(mStrings[mResult.index]);
+        case Value::Type::Boolean: return Value(mRegisters[mResult.index].intValue != 0);
+        case Value::Type::BigInt:
+        case Value::Type::Timestamp:
+        case Value::Type::Decimal: return Value(mResult.type, mRegisters[mResult.index].integerValue);
+        case Value::Type::Double: return Value(mRegisters[mResult.index].doubleValue);
+        case Value::Type::Null: break;
+    }
+    return Value();
+}
+
+bool CompiledExpression::evaluateBoolean(Expression::EvaluateContext &context)
+{
+    // A NULL result, like false, does not select the row
+    if(!mCompiled || mResult.type != Value::Type::Boolean || !run(context)) {
+        Value value = mExpression.evaluate(context);
+        return !value.isNull() && value.booleanValue();
+    }
+
+    return mRegisters[mResult.index].intValue != 0;
+}
+
+bool CompiledExpression::compileNode(Expression &expression, Operand &result)
+{
+    if(dynamic_cast<ConstantExpression*>(&expression) || dynamic_cast<ParameterExpression*>(&expression)) {
+        ConstantContext context;
+        Value value = expression.evaluate(context);
+        if(value.isNull()) {
+            return false;
+        }
+
+        result = addRegister(value.type());
+        switch(value.type()) {
+            case Value::Type::Int: mRegisters[result.index].intValue = value.intValue(); break;
+            case Value::Type::Float: mRegisters[result.index].floatValue = value.floatValue(); break;
+            case Value::Type::String: mStringStorage[result.index] = value; break;
+            case Value::Type::Boolean: mRegisters[result.index].intValue = value.booleanValue(); break;
+            case Value::Type::BigInt:
+            case Value::Type::Timestamp:
+            case Value::Type::Decimal: mRegisters[result.index].integerValue = value.integerValue(value.type()); break;
+            case Value::Type::Double: mRegisters[result.index].doubleValue = value.doubleValue(); break;
+            case Value::Type::Null: break;
+        }
+        return true;
+    }
+
+    if(FieldExpression *field = dynamic_cast<FieldExpression*>(&expression)) {
+        // Each field is read from the row only once
+        for(auto &[loadedField, operand] : mLoadedFields) {
+            if(loadedField == unsigned(field->field())) {
+                result = operand;
+                return true;
+            }
+        }
+
+        result = addRegister(field->type());
+        Opcode opcode = Opcode::LoadInt;
+        switch(result.type) {
+            case Value::Type::Int: opcode = Opcode::LoadInt; break;
+            case Value::Type::Float: opcode = Opcode::LoadFloat; break;
+            case Value::Type::String: opcode = Opcode::LoadString; break;
+            case Value::Type::Boolean: opcode = Opcode::LoadBoolean; break;
+            case Value::Type::BigInt:
+            case Value::Type::Timestamp:
+            case Value::Type::Decimal: opcode = Opcode::LoadInteger; break;
+            case Value::Type::Double: opcode = Opcode::LoadDouble; break;
+            case Value::Type::Null: return false;
+        }
+        mProgram.push_back({opcode, result.index, unsigned(field->field()), 0});
+        mLoadedFields.push_back({field->field(), result});
+        return true;
+    }
+
+    if(ArithmeticExpression *arithmetic = dynamic_cast<ArithmeticExpression*>(&expression)) {
+        bool negate = arithmetic->arithmeticType() == ArithmeticExpression::Negate;
+        Operand left;
+        Operand right;
+        if(!compileNode(*arithmetic->leftOperand(), left)) {
+            return false;
+        }
+        if(negate) {
+            right = left;
+        } else if(!compileNode(*arithmetic->rightOperand(), right)) {
+            return false;
+        }
+
+        // Decimals are rescaled when multiplied or divided, which is left to
+        // Value
+        static const Opcode intOpcodes[] = {Opcode::AddInt, Opcode::SubtractInt, Opcode::MultiplyInt, Opcode::DivideInt, Opcode::NegateInt};
+        static const Opcode floatOpcodes[] = {Opcode::AddFloat, Opcode::SubtractFloat, Opcode::MultiplyFloat, Opcode::DivideFloat, Opcode::NegateFloat};
+        static const Opcode integerOpcodes[] = {Opcode::AddInteger, Opcode::SubtractInteger, Opcode::MultiplyInteger, Opcode::DivideInteger, Opcode::NegateInteger};
+        static const Opcode doubleOpcodes[] = {Opcode::AddDouble, Opcode::SubtractDouble, Opcode::MultiplyDouble, Opcode::DivideDouble, Opcode::NegateDouble};
+        ArithmeticExpression::ArithmeticType arithmeticType = arithmetic->arithmeticType();
+        if(left.type != right.type) {
+            return false;
+        }
+
+        Opcode opcode = Opcode::AddInt;
+        switch(left.type) {
+            case Value::Type::Int: opcode = intOpcodes[arithmeticType]; break;
+            case Value::Type::Float: opcode = floatOpcodes[arithmeticType]; break;
+            case Value::Type::BigInt: opcode = integerOpcodes[arithmeticType]; break;
+            case Value::Type::Double: opcode = doubleOpcodes[arithmeticType]; break;
+            case Value::Type::Decimal:
+                if(arithmeticType == ArithmeticExpression::Multiply || arithmeticType == ArithmeticExpression::Divide) {
+                    return false;
+                }
+                opcode = integerOpcodes[arithmeticType];
+                break;
+            default:
+                return false;
+        }
+
+        result = addRegister(left.type);
+        mProgram.push_back({opcode, result.index, left.index, right.index});
+        return true;
+    }
+
+    if(CompareExpression *compare = dynamic_cast<CompareExpression*>(&expression)) {
+        Operand left;
+        Operand right;
+        if(!compileNode(*compare->leftOperand(), left) || !compileNode(*compare->rightOperand(), right) || left.type != right.type) {
+            return false;
+        }
+
+        // Booleans only have equality; Value orders no boolean before another
+        static const Opcode intOpcodes[] = {Opcode::LessThanInt, Opcode::LessThanEqualInt, Opcode::EqualInt, Opcode::NotEqualInt, Opcode::GreaterThanInt, Opcode::GreaterThanEqualInt};
+        static const Opcode floatOpcodes[] = {Opcode::LessThanFloat, Opcode::LessThanEqualFloat, Opcode::EqualFloat, Opcode::NotEqualFloat, Opcode::GreaterThanFloat, Opcode::GreaterThanEqualFloat};
+        static const Opcode stringOpcodes[] = {Opcode::LessThanString, Opcode::LessThanEqualString, Opcode::EqualString, Opcode::NotEqualString, Opcode::GreaterThanString, Opcode::GreaterThanEqualString};
+        static const Opcode integerOpcodes[] = {Opcode::LessThanInteger, Opcode::LessThanEqualInteger, Opcode::EqualInteger, Opcode::NotEqualInteger, Opcode::GreaterThanInteger, Opcode::GreaterThanEqualInteger};
+        static const Opcode doubleOpcodes[] = {Opcode::LessThanDouble, Opcode::LessThanEqualDouble, Opcode::EqualDouble, Opcode::NotEqualDouble, Opcode::GreaterThanDouble, Opcode::GreaterThanEqualDouble};
+        CompareExpression::CompareType compareType = compare->compareType();
+        Opcode opcode = Opcode::EqualInt;
+        switch(left.type) {
+            case Value::Type::Int: opcode = intOpcodes[compareType]; break;
+            case Value::Type::Float: opcode = floatOpcodes[compareType]; break;
+            case Value::Type::String: opcode = stringOpcodes[compareType]; break;
+            case Value::Type::BigInt:
+            case Value::Type::Timestamp:
+            case Value::Type::Decimal: opcode = integerOpcodes[compareType]; break;
+            case Value::Type::Double: opcode = doubleOpcodes[compareType]; break;
+            case Value::Type::Boolean:
+                if(compareType != CompareExpression::Equal && compareType != CompareExpression::NotEqual) {
+                    return false;
+                }
+                opcode = intOpcodes[compareType];
+                break;
+            case Value::Type::Null:
+                return false;
+        }
+
+        result = addRegister(Value::Type::Boolean);
+        mProgram.push_back({opcode, result.index, left.index, right.index});
+        return true;
+    }
+
+    if(LogicalExpression *logical = dynamic_cast<LogicalExpression*>(&expression)) {
+        bool negate = logical->logicalType() == LogicalExpression::Not;
+        Operand left;
+        Operand right;
+        if(!compileNode(*logical->leftOperand(), left)) {
+            return false;
+        }
+        if(negate) {
+            right = left;
+        } else if(!compileNode(*logical->rightOperand(), right)) {
+            return false;
+        }
+
+        if(left.type != Value::Type::Boolean || right.type != Value::Type::Boolean) {
+            return false;
+        }
+
+        Opcode opcode = Opcode::Not;
+        switch(logical->logicalType()) {
+            case LogicalExpression::And: opcode = Opcode::And; break;
+            case LogicalExpression::Or: opcode = Opcode::Or; break;
+            case LogicalExpression::Not: opcode = Opcode::Not; break;
+        }
+
+        result = addRegister(Value::Type::Boolean);
+        mProgram.push_back({opcode, result.index, left.index, right.index});
+        return true;
+    }
+
+    return false;
+}
+
+CompiledExpression::Operand CompiledExpression::addRegister(Value::Type type)
+{
+    if(type == Value::Type::String) {
+        mStrings.emplace_back();
+        mStringStorage.emplace_back(std::string());
+        return {unsigned(mStrings.size() - 1), type};
+    }
+
+    mRegisters.push_back({0});
+    return {unsigned(mRegisters.size() - 1), type};
+}
+
+bool CompiledExpression::run(Expression::EvaluateContext &context)
+{
+    Register *r = mRegisters.data();
+    std::string_view *s = mStrings.data();
+    for(const Instruction &instruction : mProgram) {
+        unsigned int t = instruction.target;
+        unsigned int a = instruction.left;
+        unsigned int b = instruction.right;
+
+        switch(instruction.opcode) {
+            case Opcode::LoadInt:
+            {
+                Value value = context.fieldValue(a);
+                if(value.isNull()) return false;
+                r[t].intValue = value.intValue();
+                break;
+            }
+            case Opcode::LoadFloat:
+            {
+                Value value = context.fieldValue(a);
+                if(value.isNull()) return false;
+                r[t].floatValue = value.floatValue();
+                break;
+            }
+            case Opcode::LoadBoolean:
+            {
+                Value value = context.fieldValue(a);
+                if(value.isNull()) return false;
+                r[t].intValue = value.booleanValue();
+                break;
+            }
+            case Opcode::LoadString:
+            {
+                ValueRef value = context.fieldRef(a, mStringStorage[t]);
+                if(value.isNull()) return false;
+                s[t] = value.stringValue();
+                break;
+            }
+            case Opcode::LoadInteger:
+            {
+                ValueRef value = context.fieldRef(a, mNumberStorage);
+                if(value.isNull()) return false;
+                r[t].integerValue = value.bigIntValue();
+                break;
+            }
+            case Opcode::LoadDouble:
+            {
+                ValueRef value = context.fieldRef(a, mNumberStorage);
+                if(value.isNull()) return false;
+                r[t].doubleValue = value.doubleValue();
+                break;
+            }
+
+            case Opcode::AddInt: r[t].intValue = r[a].intValue + r[b].intValue; break;
+            case Opcode::SubtractInt: r[t].intValue = r[a].intValue - r[b].intValue; break;
+            case Opcode::MultiplyInt: r[t].intValue = r[a].intValue * r[b].intValue; break;
+            case Opcode::DivideInt: r[t].intValue = r[a].intValue / r[b].intValue; break;
+            case Opcode::NegateInt: r[t].intValue = -r[a].intValue; break;
+            case Opcode::AddFloat: r[t].floatValue = r[a].floatValue + r[b].floatValue; break;
+            case Opcode::SubtractFloat: r[t].floatValue = r[a].floatValue - r[b].floatValue; break;
+            case Opcode::MultiplyFloat: r[t].floatValue = r[a].floatValue * r[b].floatValue; break;
+            case Opcode::DivideFloat: r[t].floatValue = r[a].floatValue / r[b].floatValue; break;
+            case Opcode::NegateFloat: r[t].floatValue = -r[a].floatValue; break;
+            case Opcode::AddInteger: r[t].integerValue = r[a].integerValue + r[b].integerValue; break;
+            case Opcode::SubtractInteger: r[t].integerValue = r[a].integerValue - r[b].integerValue; break;
+            case Opcode::MultiplyInteger: r[t].integerValue = r[a].integerValue * r[b].integerValue; break;
+            case Opcode::DivideInteger: r[t].integerValue = r[a].integerValue / r[b].integerValue; break;
+            case Opcode::NegateInteger: r[t].integerValue = -r[a].integerValue; break;
+            case Opcode::AddDouble: r[t].doubleValue = r[a].doubleValue + r[b].doubleValue; break;
+            case Opcode::SubtractDouble: r[t].doubleValue = r[a].doubleValue - r[b].doubleValue; break;
+            case Opcode::MultiplyDouble: r[t].doubleValue = r[a].doubleValue * r[b].doubleValue; break;
+            case Opcode::DivideDouble: r[t].doubleValue = r[a].doubleValue / r[b].doubleValue; break;
+            case Opcode::NegateDouble: r[t].doubleValue = -r[a].doubleValue; break;
+
+            case Opcode::LessThanInt: r[t].intValue = r[a].intValue < r[b].intValue; break;
+            case Opcode::LessThanEqualInt: r[t].intValue = r[a].intValue <= r[b].intValue; break;
+            case Opcode::EqualInt: r[t].intValue = r[a].intValue == r[b].intValue; break;
+            case Opcode::NotEqualInt: r[t].intValue = r[a].intValue != r[b].intValue; break;
+            case Opcode::GreaterThanEqualInt: r[t].intValue = r[a].intValue >= r[b].intValue; break;
+            case Opcode::GreaterThanInt: r[t].intValue = r[a].intValue > r[b].intValue; break;
+            case Opcode::LessThanFloat: r[t].intValue = r[a].floatValue < r[b].floatValue; break;
+            case Opcode::LessThanEqualFloat: r[t].intValue = r[a].floatValue <= r[b].floatValue; break;
+            case Opcode::EqualFloat: r[t].intValue = r[a].floatValue == r[b].floatValue; break;
+            case Opcode::NotEqualFloat: r[t].intValue = r[a].floatValue != r[b].floatValue; break;
+            case Opcode::GreaterThanEqualFloat: r[t].intValue = r[a].floatValue >= r[b].floatValue; break;
+            case Opcode::GreaterThanFloat: r[t].intValue = r[a].floatValue > r[b].floatValue; break;
+            case Opcode::LessThanString: r[t].intValue = s[a] < s[b]; break;
+            case Opcode::LessThanEqualString: r[t].intValue = s[a] <= s[b]; break;
+            case Opcode::EqualString: r[t].intValue = s[a] == s[b]; break;
+            case Opcode::NotEqualString: r[t].intValue = s[a] != s[b]; break;
+            case Opcode::GreaterThanEqualString: r[t].intValue = s[a] >= s[b]; break;
+            case Opcode::GreaterThanString: r[t].intValue = s[a] > s[b]; break;
+            case Opcode::LessThanInteger: r[t].intValue = r[a].integerValue < r[b].integerValue; break;
+            case Opcode::LessThanEqualInteger: r[t].intValue = r[a].integerValue <= r[b].integerValue; break;
+            case Opcode::EqualInteger: r[t].intValue = r[a].integerValue == r[b].integerValue; break;
+            case Opcode::NotEqualInteger: r[t].intValue = r[a].integerValue != r[b].integerValue; break;
+            case Opcode::GreaterThanEqualInteger: r[t].intValue = r[a].integerValue >= r[b].integerValue; break;
+            case Opcode::GreaterThanInteger: r[t].intValue = r[a].integerValue > r[b].integerValue; break;
+            case Opcode::LessThanDouble: r[t].intValue = r[a].doubleValue < r[b].doubleValue; break;
+            case Opcode::LessThanEqualDouble: r[t].intValue = r[a].doubleValue <= r[b].doubleValue; break;
+            case Opcode::EqualDouble: r[t].intValue = r[a].doubleValue == r[b].doubleValue; break;
+            case Opcode::NotEqualDouble: r[t].intValue = r[a].doubleValue != r[b].doubleValue; break;
+            case Opcode::GreaterThanEqualDouble: r[t].intValue = r[a].doubleValue >= r[b].doubleValue; break;
+            case Opcode::GreaterThanDouble: r[t].intValue = r[a].doubleValue > r[b].doubleValue; break;
+
+            case Opcode::And: r[t].intValue = r[a].intValue && r[b].intValue; break;
+            case Opcode::Or: r[t].intValue = r[a].intValue || r[b].intValue; break;
+            case Opcode::Not: r[t].intValue = !r[a].intValue; break;
+        }
+    }
+    return true;
+}
\ No newline at end of file
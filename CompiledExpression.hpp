@@ -0,0 +1,136 @@
+#ifndef COMPILEDEXPRESSION_HPP
+#define COMPILEDEXPRESSION_HPP
+
+#include "Expression.hpp"
+#include "Value.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+// A bound expression translated into a flat program over typed registers,
+// so that evaluating it for a row boxes nothing but the fields it reads and
+// the final result.  Constants and parameters are loaded into registers by
+// compile(), which must be called again whenever parameters change.
+//
+// Operands of mixed types, and operators the compiler does not handle, leave
+// the program empty; evaluation then falls back to the expression itself,
+// which keeps its behaviour for such operands exactly.  So does a row with a
+// NULL field, since the registers cannot hold NULL.
+class CompiledExpression {
+public:
+    CompiledExpression(Expression &expression);
+
+    void compile();
+    bool compiled();
+
+    Value evaluate(Expression::EvaluateContext &context);
+    bool evaluateBoolean(Expression::EvaluateContext &context);
+
+private:
+    enum class Opcode : uint8_t {
+        LoadInt,
+        LoadFloat,
+        LoadBoolean,
+        LoadString,
+        LoadInteger,
+        LoadDouble,
+
+        AddInt,
+        SubtractInt,
+        MultiplyInt,
+        DivideInt,
+        NegateInt,
+        AddFloat,
+        SubtractFloat,
+        MultiplyFloat,
+        DivideFloat,
+        NegateFloat,
+        AddInteger,
+        SubtractInteger,
+        MultiplyInteger,
+        DivideInteger,
+        NegateInteger,
+        AddDouble,
+        SubtractDouble,
+        MultiplyDouble,
+        DivideDouble,
+        NegateDouble,
+
+        LessThanInt,
+        LessThanEqualInt,
+        EqualInt,
+        NotEqualInt,
+        GreaterThanEqualInt,
+        GreaterThanInt,
+        LessThanFloat,
+        LessThanEqualFloat,
+        EqualFloat,
+        NotEqualFloat,
+        GreaterThanEqualFloat,
+        GreaterThanFloat,
+        LessThanString,
+        LessThanEqualString,
+        EqualString,
+        NotEqualString,
+        GreaterThanEqualString,
+        GreaterThanString,
+        LessThanInteger,
+        LessThanEqualInteger,
+        EqualInteger,
+        NotEqualInteger,
+        GreaterThanEqualInteger,
+        GreaterThanInteger,
+        LessThanDouble,
+        LessThanEqualDouble,
+        EqualDouble,
+        NotEqualDouble,
+        GreaterThanEqualDouble,
+        GreaterThanDouble,
+
+        And,
+        Or,
+        Not
+    };
+
+    // Loads name a field in left.  Booleans are held as ints, the types held
+    // as 64-bit integers in integerValue, and strings in a separate file of
+    // registers, each referring to the field it was loaded from where the
+    // context allows, or else to its own storage.
+    struct Instruction {
+        Opcode opcode;
+        unsigned int target;
+        unsigned int left;
+        unsigned int right;
+    };
+
+    union Register {
+        int intValue;
+        float floatValue;
+        int64_t integerValue;
+        double doubleValue;
+    };
+
+    struct Operand {
+        unsigned int index;
+        Value::Type type;
+    };
+
+    bool compileNode(Expression &expression, Operand &result);
+    Operand addRegister(Value::Type type);
+    // Returns false, leaving the result unset, if a field read is NULL
+    bool run(Expression::EvaluateContext &context);
+
+    Expression &mExpression;
+    bool mCompiled;
+    std::vector<Instruction> mProgram;
+    std::vector<Register> mRegisters;
+    std::vector<std::string_view> mStrings;
+    std::vector<Value> mStringStorage;
+    Value mNumberStorage;
+    std::vector<std::tuple<unsigned int, Operand>> mLoadedFields;
+    Operand mResult;
+};
+
+#endif
\ No newline at end of file
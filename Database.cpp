@@ -3,59 +3,454 @@
 #include "Optimizer.hpp"
 #include "Parser.hpp"
 
+#include "PageSets/MemoryPageSet.hpp"
+
 #include "RowIterators/TableIterator.hpp"
+#include "RowIterators/ColumnScanIterator.hpp"
 #include "RowIterators/IndexIterator.hpp"
 #include "RowIterators/SelectIterator.hpp"
 #include "RowIterators/SortIterator.hpp"
 #include "RowIterators/ProjectIterator.hpp"
 #include "RowIterators/AggregateIterator.hpp"
+#include "RowIterators/ProfileIterator.hpp"
 
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
 #include <sstream>
 #include <ranges>
 
+Database::Database()
+: Database(std::make_unique<PageSets::MemoryPageSet>())
+{
+}
+
+Database::Database(std::unique_ptr<PageSet> pageSet)
+: mPageSet(std::move(pageSet))
+{
+    mPlanCacheGeneration = 0;
+
+    mCatalogSchema.fields.push_back({Value::Type::String, "type"});
+    mCatalogSchema.fields.push_back({Value::Type::String, "name"});
+    mCatalogSchema.fields.push_back({Value::Type::Int, "root"});
+    mCatalogSchema.fields.push_back({Value::Type::String, "query"});
+
+    if(mPageSet->rootIndex() == Page::kInvalidIndex) {
+        Page &rootPage = mPageSet->addPage();
+        mCatalog = std::make_unique<Table>(rootPage, mCatalogSchema);
+        mCatalog->initialize();
+        mPageSet->setRootIndex(rootPage.index());
+    } else {
+        mCatalog = std::make_unique<Table>(mPageSet->page(mPageSet->rootIndex()), mCatalogSchema);
+        mCatalog->load();
+        loadCatalog();
+    }
+}
+
 PageSet &Database::pageSet()
 {
-    return mPageSet;
+    return *mPageSet;
 }
 
 struct QueryError {
     std::string message;
 };
 
-Database::QueryResult Database::executeQuery(const std::string &queryString)
+// The catalog records root pages in an INTEGER column, so a root beyond its
+// range is refused rather than truncated
+static Value catalogRootValue(Page::Index rootIndex)
+{
+    if(rootIndex > INT32_MAX) {
+        throw QueryError {"Error: Root page index too large for the catalog"};
+    }
+
+    return Value((int)rootIndex);
+}
+
+Database::Statement::Statement(Database &database)
+: mDatabase(database)
+{
+    mReusable = true;
+}
+
+unsigned int Database::Statement::numParameters()
+{
+    if(mOperation && std::holds_alternative<Operation::Insert>(mOperation->operation)) {
+        return std::get<Operation::Insert>(mOperation->operation).parameters.size();
+    }
+
+    return mParameters.size();
+}
+
+Database::QueryResult Database::Statement::execute(const std::vector<Value> &parameters)
 {
-    Parser parser(queryString);
+    return mDatabase.execute(*this, parameters);
+}
+
+std::unique_ptr<Database::Statement> Database::prepare(const std::string &queryString)
+{
+    return prepare(queryString, false);
+}
 
-    std::unique_ptr<Operation> operation = parser.parse();
-    if(!operation) {
-        return {parser.errorMessage()};
+std::unique_ptr<Database::Statement> Database::prepare(const std::string &queryString, bool parameterizeLiterals)
+{
+    std::unique_ptr<Statement> statement(new Statement(*this));
+
+    Parser parser(queryString, parameterizeLiterals);
+    statement->mOperation = parser.parse();
+    if(!statement->mOperation) {
+        statement->mErrorMessage = parser.errorMessage();
+        return statement;
     }
+    statement->mParameters = parser.parameters();
 
+    // Queries which read rows have their iterator tree built and bound here,
+    // so that executing the statement only needs to restart it
+    std::lock_guard<std::mutex> lock(mMutex);
     try {
-        if(std::holds_alternative<Operation::CreateTable>(operation->operation))
-            return createTable(std::get<Operation::CreateTable>(operation->operation));
-        else if(std::holds_alternative<Operation::CreateIndex>(operation->operation))
-            return createIndex(std::get<Operation::CreateIndex>(operation->operation));
-        else if(std::holds_alternative<Operation::Insert>(operation->operation))
-            return insert(std::get<Operation::Insert>(operation->operation));
-        else if(std::holds_alternative<Operation::Select>(operation->operation))
-            return select(std::get<Operation::Select>(operation->operation));
-        else if(std::holds_alternative<Operation::Delete>(operation->operation))
-            return delete_(std::get<Operation::Delete>(operation->operation));
-        else if(std::holds_alternative<Operation::Update>(operation->operation))
-            return update(std::get<Operation::Update>(operation->operation));
-        else return {};
+        auto &operation = statement->mOperation->operation;
+        if(std::holds_alternative<Operation::Explain>(operation)) {
+            planStatement(*statement, *std::get<Operation::Explain>(operation).operation, &statement->mExplainNodes);
+        } else {
+            planStatement(*statement, *statement->mOperation, nullptr);
+        }
     } catch(QueryError e) {
-        return {e.message};
+        statement->mErrorMessage = e.message;
+    }
+
+    return statement;
+}
+
+void Database::planStatement(Statement &statement, Operation &operation, std::vector<Statement::ExplainNode> *explainNodes)
+{
+    if(std::holds_alternative<Operation::Select>(operation.operation)) {
+        auto &select = std::get<Operation::Select>(operation.operation);
+        statement.mIterator = buildIterator(select.query, {}, explainNodes);
+        statement.mReusable = !select.query.literalDependent;
+    } else if(std::holds_alternative<Operation::Delete>(operation.operation)) {
+        auto &delete_ = std::get<Operation::Delete>(operation.operation);
+        statement.mIterator = buildIterator(delete_.query, {}, explainNodes);
+        statement.mReusable = !delete_.query.literalDependent;
+    } else if(std::holds_alternative<Operation::Update>(operation.operation)) {
+        auto &update = std::get<Operation::Update>(operation.operation);
+        std::vector<std::string> columns;
+        for(auto &[name, expression] : update.values) {
+            columns.push_back(name);
+        }
+        statement.mIterator = buildIterator(update.query, columns, explainNodes);
+        statement.mModifyEntries = buildModifyEntries(update, *statement.mIterator);
+        statement.mReusable = !update.query.literalDependent;
+    }
+}
+
+Database::QueryResult Database::executeQuery(const std::string &queryString)
+{
+    // Queries are cached under their text with the literals replaced by
+    // parameters, so that a repeated query skips parsing and planning and
+    // only has its literal values bound
+    std::vector<Value> literals;
+    std::optional<std::string> key = Parser::normalize(queryString, literals);
+    if(!key) {
+        return prepare(queryString)->execute();
+    }
+
+    uint64_t generation;
+    std::unique_ptr<Statement> statement = takeCachedStatement(*key, generation);
+    if(!statement) {
+        statement = prepare(queryString, true);
+        if(!statement->mErrorMessage.empty() || statement->numParameters() != literals.size()) {
+            return prepare(queryString)->execute();
+        }
+    }
+
+    QueryResult result = statement->execute(literals);
+    returnCachedStatement(*key, std::move(statement), generation);
+
+    return result;
+}
+
+Database::PlanCacheStats Database::planCacheStats()
+{
+    std::lock_guard<std::mutex> lock(mPlanCacheMutex);
+    return mPlanCacheStats;
+}
+
+std::unique_ptr<Database::Statement> Database::takeCachedStatement(const std::string &key, uint64_t &generation)
+{
+    std::lock_guard<std::mutex> lock(mPlanCacheMutex);
+    generation = mPlanCacheGeneration;
+
+    // A SELECT whose previous result is still held by the caller cannot be
+    // restarted, so it counts as a miss
+    auto it = mPlanCacheIndex.find(key);
+    if(it == mPlanCacheIndex.end() || it->second->statement->mIterator.use_count() > 1) {
+        mPlanCacheStats.misses++;
+        return nullptr;
+    }
+
+    std::unique_ptr<Statement> statement = std::move(it->second->statement);
+    mPlanCache.erase(it->second);
+    mPlanCacheIndex.erase(it);
+    mPlanCacheStats.hits++;
+    mPlanCacheStats.entries--;
+    mPlanCacheStats.bytes -= planCacheEntrySize(key);
+
+    return statement;
+}
+
+void Database::returnCachedStatement(const std::string &key, std::unique_ptr<Statement> statement, uint64_t generation)
+{
+    std::lock_guard<std::mutex> lock(mPlanCacheMutex);
+
+    // Statements planned before a schema change are dropped, as are those
+    // whose plan only suits the literals they were first executed with
+    if(generation != mPlanCacheGeneration || mPlanCacheIndex.contains(key) || !statement->mReusable) {
+        return;
+    }
+
+    mPlanCache.push_front({key, std::move(statement)});
+    mPlanCacheIndex[key] = mPlanCache.begin();
+    mPlanCacheStats.entries++;
+    mPlanCacheStats.bytes += planCacheEntrySize(key);
+
+    if(mPlanCache.size() > kPlanCacheSize) {
+        const std::string &lastKey = mPlanCache.back().key;
+        mPlanCacheStats.entries--;
+        mPlanCacheStats.bytes -= planCacheEntrySize(lastKey);
+        mPlanCacheStats.evictions++;
+        mPlanCacheIndex.erase(lastKey);
+        mPlanCache.pop_back();
+    }
+}
+
+void Database::invalidatePlanCache()
+{
+    std::lock_guard<std::mutex> lock(mPlanCacheMutex);
+
+    mPlanCache.clear();
+    mPlanCacheIndex.clear();
+    mPlanCacheGeneration++;
+    mPlanCacheStats.entries = 0;
+    mPlanCacheStats.bytes = 0;
+}
+
+size_t Database::planCacheEntrySize(const std::string &key)
+{
+    // Only the fixed-size parts of a statement are counted, not its plan
+    return key.size() + sizeof(PlanCacheEntry) + sizeof(Statement) + sizeof(Operation);
+}
+
+Database::QueryResult Database::insertBatch(const std::string &tableName, std::vector<std::vector<Value>> rows)
+{
+    Operation operation{Operation::Insert{tableName, std::move(rows), {}}};
+
+    return execute(operation);
+}
+
+Database::QueryResult Database::execute(Operation &operation)
+{
+    return run(true, [&]() { return dispatch(operation); });
+}
+
+Database::QueryResult Database::execute(Statement &statement, const std::vector<Value> &parameters)
+{
+    if(!statement.mErrorMessage.empty()) {
+        return {statement.mErrorMessage};
+    }
+
+    if(parameters.size() != statement.numParameters()) {
+        std::stringstream ss;
+        ss << "Error: Expected " << statement.numParameters() << " parameters, got " << parameters.size();
+        return {ss.str()};
+    }
+
+    auto &operation = statement.mOperation->operation;
+    if(std::holds_alternative<Operation::Insert>(operation)) {
+        auto &insert = std::get<Operation::Insert>(operation);
+        for(unsigned int i=0; i<parameters.size(); i++) {
+            auto [row, column] = insert.parameters[i];
+            insert.rows[row][column] = parameters[i];
+        }
+    } else {
+        // Values are checked against the types the parameters were bound
+        // to, as INSERT checks them against its columns
+        for(ParameterExpression *parameter : statement.mParameters) {
+            if(!parameter->setValue(parameters[parameter->index()])) {
+                std::stringstream ss;
+                ss << "Error: Incorrect type for parameter " << parameter->index() + 1;
+                return {ss.str()};
+            }
+        }
+    }
+
+    bool commit = !std::holds_alternative<Operation::Select>(operation);
+    return run(commit, [&]() -> QueryResult {
+        if(std::holds_alternative<Operation::Select>(operation)) {
+            return {"", statement.mIterator};
+        } else if(std::holds_alternative<Operation::Delete>(operation)) {
+            return delete_(*statement.mIterator);
+        } else if(std::holds_alternative<Operation::Update>(operation)) {
+            return update(*statement.mIterator, statement.mModifyEntries);
+        } else if(std::holds_alternative<Operation::Explain>(operation)) {
+            return explain(statement);
+        } else {
+            return dispatch(*statement.mOperation);
+        }
+    });
+}
+
+Database::QueryResult Database::run(bool commit, const std::function<QueryResult()> &body)
+{
+    // Queries run one at a time, but the wait for a commit to become durable
+    // happens outside the lock so that concurrent commits can share an fsync
+    QueryResult result;
+    uint64_t commitId = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        try {
+            result = body();
+        } catch(QueryError e) {
+            result = {e.message};
+        }
+
+        if(commit) {
+            commitId = mPageSet->commit();
+        }
+    }
+
+    mPageSet->sync(commitId);
+
+    return result;
+}
+
+Database::QueryResult Database::dispatch(Operation &operation)
+{
+    if(std::holds_alternative<Operation::CreateTable>(operation.operation))
+        return createTable(std::get<Operation::CreateTable>(operation.operation));
+    else if(std::holds_alternative<Operation::CreateIndex>(operation.operation))
+        return createIndex(std::get<Operation::CreateIndex>(operation.operation));
+    else if(std::holds_alternative<Operation::Insert>(operation.operation))
+        return insert(std::get<Operation::Insert>(operation.operation));
+    else if(std::holds_alternative<Operation::Copy>(operation.operation))
+        return copy(std::get<Operation::Copy>(operation.operation));
+    else if(std::holds_alternative<Operation::Vacuum>(operation.operation))
+        return vacuum(std::get<Operation::Vacuum>(operation.operation));
+    else if(std::holds_alternative<Operation::Analyze>(operation.operation))
+        return analyze(std::get<Operation::Analyze>(operation.operation));
+    else if(std::holds_alternative<Operation::ShowSpace>(operation.operation))
+        return showSpace(std::get<Operation::ShowSpace>(operation.operation));
+    else if(std::holds_alternative<Operation::ShowCache>(operation.operation))
+        return showCache(std::get<Operation::ShowCache>(operation.operation));
+
+    return {};
+}
+
+static std::string typeName(Value::Type type)
+{
+    switch(type) {
+        case Value::Type::Int: return "INTEGER";
+        case Value::Type::Float: return "FLOAT";
+        case Value::Type::String: return "STRING";
+        case Value::Type::Boolean: return "BOOLEAN";
+        case Value::Type::BigInt: return "BIGINT";
+        case Value::Type::Double: return "DOUBLE";
+        case Value::Type::Timestamp: return "TIMESTAMP";
+        case Value::Type::Decimal: return "DECIMAL";
+        case Value::Type::Null: return "NULL";
     }
+    return "";
+}
+
+void Database::loadCatalog()
+{
+    Table::Pointer pointer = mCatalog->first();
+    while(pointer.valid()) {
+        Record::Reader reader(mCatalogSchema, mCatalog->data(pointer));
+        std::string type(reader.readField(0).stringValue());
+        std::string name(reader.readField(1).stringValue());
+        Page::Index rootIndex = reader.readField(2).intValue();
+        std::string query(reader.readField(3).stringValue());
+
+        // A column store follows the entry of its table, and has no query
+        if(type == "columns") {
+            Table &table = findTable(name);
+            std::unique_ptr columnStore = std::make_unique<ColumnStore>(mPageSet->page(rootIndex), table);
+            columnStore->load();
+            table.setColumnStore(*columnStore);
+            mColumnStores[name] = std::move(columnStore);
+
+            mCatalog->moveNext(pointer);
+            continue;
+        }
+
+        Parser parser(query);
+        std::unique_ptr<Operation> operation = parser.parse();
+        if(std::holds_alternative<Operation::CreateTable>(operation->operation)) {
+            auto &createTable = std::get<Operation::CreateTable>(operation->operation);
+            std::unique_ptr table = std::make_unique<Table>(mPageSet->page(rootIndex), std::move(createTable.schema));
+            table->load();
+            mTables[createTable.tableName] = std::move(table);
+        } else if(std::holds_alternative<Operation::CreateIndex>(operation->operation)) {
+            auto &createIndex = std::get<Operation::CreateIndex>(operation->operation);
+            Table &table = findTable(createIndex.tableName);
+
+            std::vector<unsigned int> keys;
+            for(auto &column : createIndex.columns) {
+                keys.push_back(fieldIndex(column, table.schema(), createIndex.tableName));
+            }
+
+            std::unique_ptr index = std::make_unique<Index>(mPageSet->page(rootIndex), table, std::move(keys));
+            table.addIndex(*index);
+            mIndices[createIndex.indexName] = std::move(index);
+        }
+
+        mCatalog->moveNext(pointer);
+    }
+}
+
+void Database::addCatalogEntry(const std::string &type, const std::string &name, Page::Index rootIndex, const std::string &query)
+{
+    Record::Writer writer(mCatalogSchema);
+    writer.setField(0, Value(type));
+    writer.setField(1, Value(name));
+    writer.setField(2, catalogRootValue(rootIndex));
+    writer.setField(3, Value(query));
+    mCatalog->addRow(writer);
 }
 
 Database::QueryResult Database::createTable(Operation::CreateTable &createTable)
 {
-    Page &rootPage = mPageSet.addPage();
+    if(mTables.contains(createTable.tableName)) {
+        std::stringstream ss;
+        ss << "Error: Table " << createTable.tableName << " already exists";
+        return {ss.str()};
+    }
+
+    std::stringstream query;
+    query << "CREATE TABLE " << createTable.tableName << " (";
+    for(unsigned int i=0; i<createTable.schema.fields.size(); i++) {
+        auto &field = createTable.schema.fields[i];
+        query << ((i == 0) ? "" : ", ") << typeName(field.type) << " " << field.name;
+    }
+    query << ")";
+
+    Page &rootPage = mPageSet->addPage();
     std::unique_ptr table = std::make_unique<Table>(rootPage, std::move(createTable.schema));
     table->initialize();
+    addCatalogEntry("table", createTable.tableName, rootPage.index(), query.str());
+
+    if(createTable.columnar) {
+        std::unique_ptr columnStore = std::make_unique<ColumnStore>(mPageSet->addPage(), *table);
+        columnStore->initialize();
+        table->setColumnStore(*columnStore);
+        addCatalogEntry("columns", createTable.tableName, columnStore->rootIndex(), "");
+        mColumnStores[createTable.tableName] = std::move(columnStore);
+    }
+
     mTables[createTable.tableName] = std::move(table);
+    invalidatePlanCache();
 
     return {"Created table " + createTable.tableName};
 }
@@ -76,11 +471,24 @@ Database::QueryResult Database::createIndex(Operation::CreateIndex &createIndex)
         keys.push_back(field);
     }
 
-    Page &rootPage = mPageSet.addPage();
+    std::stringstream query;
+    query << "CREATE INDEX " << createIndex.indexName << " ON " << createIndex.tableName << " (";
+    for(unsigned int i=0; i<createIndex.columns.size(); i++) {
+        query << ((i == 0) ? "" : ", ") << createIndex.columns[i];
+    }
+    query << ")";
+
+    Page &rootPage = mPageSet->addPage();
     std::unique_ptr index = std::make_unique<Index>(rootPage, table, std::move(keys));
+    index->initialize();
+    index->backfill();
+
+    // The backfill may have reused the root page's frame for another page
+    addCatalogEntry("index", createIndex.indexName, index->rootIndex(), query.str());
     table.addIndex(*index);
 
     mIndices[createIndex.indexName] = std::move(index);
+    invalidatePlanCache();
 
     return {"Created index " + createIndex.indexName};
 }
@@ -89,43 +497,56 @@ Database::QueryResult Database::insert(Operation::Insert &insert)
 {
     Table &table = findTable(insert.tableName);
 
-    if(insert.values.size() != table.schema().fields.size()) {
-        std::stringstream ss;
-        ss << "Error: Incorrect number of values for table " << insert.tableName;
-        return {ss.str()};
-    }
-
-    Record::Writer writer(table.schema());
-    for(int i=0; i<insert.values.size(); i++) {
-        if(insert.values[i].type() != table.schema().fields[i].type) {
+    // Every row is checked before any is added, so a bad row leaves the
+    // table unchanged.  Values are converted to their column's type where
+    // nothing but precision is lost.
+    for(auto &values : insert.rows) {
+        if(values.size() != table.schema().fields.size()) {
             std::stringstream ss;
-            ss << "Error: Incorrect type for column " << table.schema().fields[i].name << " in table " << insert.tableName;
+            ss << "Error: Incorrect number of values for table " << insert.tableName;
             return {ss.str()};
         }
 
-        writer.setField(i, insert.values[i]);
+        for(int i=0; i<values.size(); i++) {
+            if(!values[i].convert(table.schema().fields[i].type)) {
+                std::stringstream ss;
+                ss << "Error: Incorrect type for column " << table.schema().fields[i].name << " in table " << insert.tableName;
+                return {ss.str()};
+            }
+        }
     }
 
-    table.addRow(writer);
+    Record::Writer writer(table.schema());
+    if(insert.rows.size() == 1) {
+        for(int i=0; i<insert.rows[0].size(); i++) {
+            writer.setField(i, insert.rows[0][i]);
+        }
+        table.addRow(writer);
 
-    return {"Added row to table " + insert.tableName};
-}
+        return {"Added row to table " + insert.tableName};
+    }
 
-Database::QueryResult Database::select(Operation::Select &select)
-{
-    auto iterator = buildIterator(select.query);
+    // Index entries for the whole batch are sorted and added together
+    Table::Loader loader(table);
+    for(auto &values : insert.rows) {
+        for(int i=0; i<values.size(); i++) {
+            writer.setField(i, values[i]);
+        }
+        loader.add(writer);
+    }
+    loader.finish();
 
-    return {"", std::move(iterator)};
+    std::stringstream ss;
+    ss << "Added " << insert.rows.size() << " rows to table " << insert.tableName;
+    return {ss.str()};
 }
 
-Database::QueryResult Database::delete_(Operation::Delete &delete_)
+Database::QueryResult Database::delete_(RowIterator &iterator)
 {
-    auto iterator = buildIterator(delete_.query);
-
     int rowsRemoved = 0;
-    iterator->start();
-    while(iterator->valid()) {
-        iterator->remove();
+    iterator.start();
+    while(iterator.valid()) {
+        iterator.remove();
         rowsRemoved++;
     }
     std::stringstream ss;
@@ -133,25 +554,17 @@ Database::QueryResult Database::delete_(Operation::Delete &delete_)
     return {ss.str()};
 }
 
-Database::QueryResult Database::update(Operation::Update &update)
+Database::QueryResult Database::update(RowIterator &iterator, const std::vector<RowIterator::ModifyEntry> &entries)
 {
-    auto iterator = buildIterator(update.query);
-
-    Record::Schema &schema = iterator->schema();
-
-    std::vector<RowIterator::ModifyEntry> entries;
-    for(auto &[name, expression] : update.values) {
-        unsigned int field = fieldIndex(name, schema, tableName(update.query));
-        bindExpression(*expression, schema, tableName(update.query));
-        RowIterator::ModifyEntry entry = {field, std::move(expression)};
-        entries.push_back(std::move(entry));
+    for(auto &entry : entries) {
+        entry.compiled->compile();
     }
 
     int rowsUpdated = 0;
-    iterator->start();
-    while(iterator->valid()) {
-        iterator->modify(entries);
-        iterator->next();
+    iterator.start();
+    while(iterator.valid()) {
+        iterator.modify(entries);
+        iterator.next();
         rowsUpdated++;
     }
     std::stringstream ss;
@@ -159,71 +572,490 @@ Database::QueryResult Database::update(Operation::Update &update)
     return {ss.str()};
 }
 
-std::unique_ptr<RowIterator> Database::buildIterator(Query &query)
+// Splits one line of comma-separated values.  Fields may be enclosed in double
+// quotes, in which case they can contain commas.
+static std::vector<std::string> splitCsvLine(const std::string &line)
+{
+    std::vector<std::string> fields;
+    std::string field;
+    bool quoted = false;
+    for(char c : line) {
+        if(c == '\"') {
+            quoted = !quoted;
+        } else if(c == ',' && !quoted) {
+            fields.push_back(std::move(field));
+            field.clear();
+        } else if(c != '\r') {
+            field.push_back(c);
+        }
+    }
+    fields.push_back(std::move(field));
+
+    return fields;
+}
+
+static std::optional<Value> parseCsvField(const std::string &field, Value::Type type)
+{
+    size_t begin = field.find_first_not_of(" \t");
+    size_t end = field.find_last_not_of(" \t");
+    std::string text = (begin == std::string::npos) ? "" : field.substr(begin, end - begin + 1);
+
+    // An empty field is NULL, except in a String column
+    if(text.empty() && type != Value::Type::String) {
+        return Value::null();
+    }
+
+    switch(type) {
+        case Value::Type::Int:
+        {
+            int value;
+            auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+            if(ec != std::errc() || ptr != text.data() + text.size()) return std::nullopt;
+            return Value(value);
+        }
+        case Value::Type::Float:
+        {
+            char *ptr;
+            float value = std::strtof(text.c_str(), &ptr);
+            if(text.empty() || ptr != text.c_str() + text.size()) return std::nullopt;
+            return Value(value);
+        }
+        case Value::Type::Boolean:
+            if(text == "true") return Value(true);
+            if(text == "false") return Value(false);
+            return std::nullopt;
+        case Value::Type::String:
+            return Value(field);
+        case Value::Type::BigInt:
+        {
+            int64_t value;
+            auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+            if(ec != std::errc() || ptr != text.data() + text.size()) return std::nullopt;
+            return Value(value);
+        }
+        case Value::Type::Double:
+        {
+            char *ptr;
+            double value = std::strtod(text.c_str(), &ptr);
+            if(text.empty() || ptr != text.c_str() + text.size()) return std::nullopt;
+            return Value(value);
+        }
+        case Value::Type::Timestamp:
+        {
+            std::optional<int64_t> value = Value::parseTimestamp(text);
+            if(!value) return std::nullopt;
+            return Value(Value::Type::Timestamp, *value);
+        }
+        case Value::Type::Decimal:
+        {
+            std::optional<int64_t> value = Value::parseDecimal(text);
+            if(!value) return std::nullopt;
+            return Value(Value::Type::Decimal, *value);
+        }
+        case Value::Type::Null:
+            break;
+    }
+
+    return std::nullopt;
+}
+
+Database::QueryResult Database::copy(Operation::Copy &copy)
+{
+    Table &table = findTable(copy.tableName);
+    Record::Schema &schema = table.schema();
+
+    std::ifstream file(copy.fileName);
+    if(!file) {
+        std::stringstream ss;
+        ss << "Error: Unable to open file " << copy.fileName;
+        return {ss.str()};
+    }
+
+    // Rows already read are kept if a later line is malformed
+    Table::Loader loader(table, copy.fillFactor);
+    int rowsCopied = 0;
+    std::string error;
+    std::string line;
+    for(int lineNumber = 1; std::getline(file, line); lineNumber++) {
+        if(line.empty() || line == "\r") {
+            continue;
+        }
+
+        std::vector<std::string> fields = splitCsvLine(line);
+        if(fields.size() != schema.fields.size()) {
+            std::stringstream ss;
+            ss << "Error: Incorrect number of values on line " << lineNumber << " of " << copy.fileName;
+            error = ss.str();
+            break;
+        }
+
+        Record::Writer writer(schema);
+        for(unsigned int i=0; i<fields.size() && error.empty(); i++) {
+            std::optional<Value> value = parseCsvField(fields[i], schema.fields[i].type);
+            if(!value) {
+                std::stringstream ss;
+                ss << "Error: Incorrect type for column " << schema.fields[i].name << " on line " << lineNumber << " of " << copy.fileName;
+                error = ss.str();
+            } else {
+                writer.setField(i, *value);
+            }
+        }
+        if(!error.empty()) {
+            break;
+        }
+
+        loader.add(writer);
+        rowsCopied++;
+    }
+    loader.finish();
+
+    std::stringstream ss;
+    if(!error.empty()) {
+        ss << error << " (" << rowsCopied << " rows copied)";
+    } else {
+        ss << "Copied " << rowsCopied << " rows into table " << copy.tableName;
+    }
+    return {ss.str()};
+}
+
+Database::QueryResult Database::vacuum(Operation::Vacuum &)
 {
+    mPageSet->sortFreeList();
+    Page::Index oldNumPages = mPageSet->numPages();
+    Page::Index limit = mPageSet->numPages() - mPageSet->numFreePages();
+
+    std::vector<Page::Index> oldPages;
+    mCatalog->relocatePages(limit, oldPages);
+    for(auto &[name, table] : mTables) {
+        table->relocatePages(limit, oldPages);
+    }
+    for(auto &[name, index] : mIndices) {
+        index->relocatePages(limit, oldPages);
+    }
+    for(auto &[name, columnStore] : mColumnStores) {
+        columnStore->relocatePages(limit, oldPages);
+    }
+
+    for(Page::Index index : oldPages) {
+        mPageSet->deletePage(mPageSet->page(index));
+    }
+    mPageSet->setRootIndex(mCatalog->rootIndex());
+
+    Table::Pointer pointer = mCatalog->first();
+    while(pointer.valid()) {
+        Record::Reader reader(mCatalogSchema, mCatalog->data(pointer));
+        std::string type(reader.readField(0).stringValue());
+        std::string name(reader.readField(1).stringValue());
+        Page::Index rootIndex;
+        if(type == "table") {
+            rootIndex = mTables[name]->rootIndex();
+        } else if(type == "columns") {
+            rootIndex = mColumnStores[name]->rootIndex();
+        } else {
+            rootIndex = mIndices[name]->rootIndex();
+        }
+
+        Record::Writer writer(mCatalogSchema);
+        writer.setField(0, reader.readField(0));
+        writer.setField(1, reader.readField(1));
+        writer.setField(2, catalogRootValue(rootIndex));
+        writer.setField(3, reader.readField(3));
+        mCatalog->modifyRow(pointer, writer);
+
+        mCatalog->moveNext(pointer);
+    }
+
+    mPageSet->truncate();
+
+    std::stringstream ss;
+    ss << "Released " << oldNumPages - mPageSet->numPages() << " pages";
+    return {ss.str()};
+}
+
+Database::QueryResult Database::analyze(Operation::Analyze &analyze)
+{
+    std::vector<std::tuple<std::string, Table*>> tables;
+    if(analyze.tableName.empty()) {
+        for(auto &[name, table] : mTables) {
+            tables.push_back({name, table.get()});
+        }
+    } else {
+        tables.push_back({analyze.tableName, &findTable(analyze.tableName)});
+    }
+
+    std::stringstream ss;
+    for(auto &[name, table] : tables) {
+        ss << "Analyzed " << table->analyze() << " rows in table " << name << "\n";
+    }
+
+    // Plans were chosen using the old statistics
+    invalidatePlanCache();
+
+    std::string message = ss.str();
+    if(!message.empty()) {
+        message.pop_back();
+    }
+    return {message};
+}
+
+Database::QueryResult Database::showSpace(Operation::ShowSpace &)
+{
+    // Space amplification is the size of the pages a tree occupies relative
+    // to the bytes of the entries stored in it
+    std::stringstream ss;
+    auto report = [&](const std::string &type, const std::string &name, BTree::SpaceStats stats) {
+        size_t pages = stats.leafPages + stats.indirectPages;
+        size_t entryBytes = stats.keyBytes + stats.dataBytes;
+        ss << type << " " << name << ": " << stats.entries << " entries, height " << stats.height << ", "
+           << stats.leafPages << " leaf + " << stats.indirectPages << " indirect pages, "
+           << entryBytes << " entry bytes, " << stats.freeBytes << " free bytes, "
+           << (stats.separators > 0 ? double(stats.separatorBytes) / stats.separators : 0.0) << " bytes per separator, "
+           << "amplification " << (entryBytes > 0 ? double(pages * mPageSet->pageSize()) / entryBytes : 0.0) << "\n";
+    };
+
+    for(auto &[name, table] : mTables) {
+        report("Table", name, table->spaceStats());
+    }
+    for(auto &[name, index] : mIndices) {
+        report("Index", name, index->spaceStats());
+    }
+    for(auto &[name, columnStore] : mColumnStores) {
+        ColumnStore::SpaceStats stats = columnStore->spaceStats();
+        size_t treePages = stats.tree.leafPages + stats.tree.indirectPages;
+        ss << "Columns " << name << ": " << stats.rows << " rows in " << stats.groups << " groups, "
+           << stats.columnPages << " column pages, " << stats.dictionaryEntries << " dictionary entries, "
+           << treePages << " directory pages\n";
+    }
+
+    std::string message = ss.str();
+    if(!message.empty()) {
+        message.pop_back();
+    }
+    return {message};
+}
+
+Database::QueryResult Database::showCache(Operation::ShowCache &)
+{
+    PlanCacheStats stats = planCacheStats();
+    std::stringstream ss;
+    ss << "Plan cache: " << stats.entries << " entries, " << stats.bytes << " bytes, "
+       << stats.hits << " hits, " << stats.misses << " misses, " << stats.evictions << " evictions";
+    return {ss.str()};
+}
+
+Database::QueryResult Database::explain(Statement &statement)
+{
+    auto &explain = std::get<Operation::Explain>(statement.mOperation->operation);
+    auto &operation = explain.operation->operation;
+    RowIterator *iterator = statement.mIterator.get();
+    std::vector<Statement::ExplainNode> &nodes = statement.mExplainNodes;
+
+    // A SELECT is read to the end with every field fetched, as it would be
+    // by a client printing its result
+    std::string message;
+    uint64_t nanoseconds = 0;
+    if(explain.analyze) {
+        for(auto &node : nodes) {
+            node.profile->resetStats();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        if(std::holds_alternative<Operation::Select>(operation)) {
+            Value storage;
+            for(iterator->start(); iterator->valid(); iterator->next()) {
+                for(unsigned int i=0; i<iterator->schema().fields.size(); i++) {
+                    iterator->getFieldRef(i, storage);
+                }
+            }
+        } else if(std::holds_alternative<Operation::Delete>(operation)) {
+            message = delete_(*iterator).message;
+        } else {
+            message = update(*iterator, statement.mModifyEntries).message;
+        }
+        nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // The last iterator built is the root of the tree, and is listed first
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    for(size_t i=0; i<nodes.size(); i++) {
+        Statement::ExplainNode &node = nodes[nodes.size() - 1 - i];
+        ss << std::string(2 * i, ' ') << node.description;
+        if(explain.analyze) {
+            const RowIterators::ProfileIterator::Stats &stats = node.profile->stats();
+            ss << " (rows " << stats.rows << ", next " << stats.nextCalls << ", getField " << stats.getFieldCalls;
+            if(stats.batches > 0) {
+                ss << ", batches " << stats.batches;
+            }
+            ss << ", time " << stats.nanoseconds / 1e6 << " ms";
+            if(node.sort) {
+                ss << ", buffered " << node.sort->bufferedBytes() << " bytes";
+            }
+            ss << ")";
+        }
+        ss << "\n";
+    }
+
+    if(explain.analyze) {
+        ss << "Total time " << nanoseconds / 1e6 << " ms";
+        if(!message.empty()) {
+            ss << ", " << message;
+        }
+    }
+
+    std::string result = ss.str();
+    if(!result.empty() && result.back() == '\n') {
+        result.pop_back();
+    }
+    return {result};
+}
+
+static std::string limitString(RowIterators::IndexIterator::Limit &limit)
+{
+    std::string result;
+    switch(limit.comparison) {
+        case BTree::SearchComparison::LessThan: result = "< ("; break;
+        case BTree::SearchComparison::LessThanEqual: result = "<= ("; break;
+        case BTree::SearchComparison::Equal: result = "== ("; break;
+        case BTree::SearchComparison::GreaterThanEqual: result = ">= ("; break;
+        case BTree::SearchComparison::GreaterThan: result = "> ("; break;
+    }
+
+    for(unsigned int i=0; i<limit.values.size(); i++) {
+        result += (i > 0 ? ", " : "") + limit.values[i]->toString();
+    }
+    return result + ")";
+}
+
+std::unique_ptr<RowIterator> Database::buildIterator(Query &query, const std::vector<std::string> &modifiedColumns, std::vector<Statement::ExplainNode> *explainNodes)
+{
+    // Literals in the predicate take the types of the columns they are
+    // compared with before the optimizer matches them to indexes
+    if(query.predicate) {
+        bindExpression(*query.predicate, findTable(tableName(query)).schema(), tableName(query));
+    }
+
     Optimizer optimizer(*this);
-    optimizer.optimize(query);
+    optimizer.optimize(query, modifiedColumns);
 
     std::unique_ptr<RowIterator> iterator;
+    auto explainIterator = [&](const std::string &description, RowIterators::SortIterator *sort = nullptr) {
+        if(explainNodes) {
+            auto profile = std::make_unique<RowIterators::ProfileIterator>(std::move(iterator));
+            explainNodes->push_back({description, profile.get(), sort});
+            iterator = std::move(profile);
+        }
+    };
 
     if(std::holds_alternative<Query::Table>(query.source)) {
         auto &table = std::get<Query::Table>(query.source);
-        iterator = std::make_unique<RowIterators::TableIterator>(findTable(table.name));
+        ColumnStore *columnStore = findTable(table.name).columnStore();
+        if(columnStore) {
+            iterator = std::make_unique<RowIterators::ColumnScanIterator>(*columnStore);
+            explainIterator("Column scan of " + table.name);
+        } else {
+            iterator = std::make_unique<RowIterators::TableIterator>(findTable(table.name));
+            explainIterator("Table scan of " + table.name);
+        }
     } else if(std::holds_alternative<Query::Index>(query.source)) {
         auto &index = std::get<Query::Index>(query.source);
+        std::string description = "Index scan of " + index.tableName + " using " + index.name;
+        if(index.startLimit) {
+            description += " from " + limitString(*index.startLimit);
+        }
+        if(index.endLimit) {
+            description += " to " + limitString(*index.endLimit);
+        }
         iterator = std::make_unique<RowIterators::IndexIterator>(findIndex(index.name), std::move(index.startLimit), std::move(index.endLimit));
+        explainIterator(description);
     }
 
     Record::Schema &schema = iterator->schema();
 
     if(query.predicate) {
         bindExpression(*query.predicate, schema, tableName(query));
+        std::string description = "Select where " + query.predicate->toString();
         iterator = std::make_unique<RowIterators::SelectIterator>(std::move(iterator), std::move(query.predicate));
+        explainIterator(description);
     }
 
     if(std::holds_alternative<Query::Aggregate>(query.columns)) {
         auto &aggregate = std::get<Query::Aggregate>(query.columns);
         RowIterators::AggregateIterator::Operation operation;
+        std::string description;
         switch(aggregate.operation) {
-            case Query::Aggregate::Operation::Min: operation = RowIterators::AggregateIterator::Operation::Min; break;
-            case Query::Aggregate::Operation::Average: operation = RowIterators::AggregateIterator::Operation::Average; break;
-            case Query::Aggregate::Operation::Sum: operation = RowIterators::AggregateIterator::Operation::Sum; break;
-            case Query::Aggregate::Operation::Max: operation = RowIterators::AggregateIterator::Operation::Max; break;
-            case Query::Aggregate::Operation::Count: operation = RowIterators::AggregateIterator::Operation::Count; break;
+            case Query::Aggregate::Operation::Min: operation = RowIterators::AggregateIterator::Operation::Min; description = "Aggregate MIN(" + aggregate.field + ")"; break;
+            case Query::Aggregate::Operation::Average: operation = RowIterators::AggregateIterator::Operation::Average; description = "Aggregate AVG(" + aggregate.field + ")"; break;
+            case Query::Aggregate::Operation::Sum: operation = RowIterators::AggregateIterator::Operation::Sum; description = "Aggregate SUM(" + aggregate.field + ")"; break;
+            case Query::Aggregate::Operation::Max: operation = RowIterators::AggregateIterator::Operation::Max; description = "Aggregate MAX(" + aggregate.field + ")"; break;
+            case Query::Aggregate::Operation::Count: operation = RowIterators::AggregateIterator::Operation::Count; description = "Aggregate COUNT(*)"; break;
         };
         unsigned int field = -1;
         if(aggregate.operation != Query::Aggregate::Operation::Count) {
             field = fieldIndex(aggregate.field, schema, tableName(query));
         }
+        bool adds = aggregate.operation == Query::Aggregate::Operation::Sum || aggregate.operation == Query::Aggregate::Operation::Average;
+        if(adds && schema.fields[field].type == Value::Type::Timestamp) {
+            throw QueryError {"Error: Timestamps in column " + aggregate.field + " cannot be added"};
+        }
         unsigned int groupField = -1;
         if(aggregate.groupField != "") {
             groupField = fieldIndex(aggregate.groupField, schema, tableName(query));
-            iterator = std::make_unique<RowIterators::SortIterator>(std::move(iterator), groupField);
+            auto sort = std::make_unique<RowIterators::SortIterator>(std::move(iterator), groupField);
+            RowIterators::SortIterator *sortIterator = sort.get();
+            iterator = std::move(sort);
+            explainIterator("Sort on " + aggregate.groupField, sortIterator);
+            description += " grouped by " + aggregate.groupField;
         }
         iterator = std::make_unique<RowIterators::AggregateIterator>(std::move(iterator), operation, field, groupField);
+        explainIterator(description);
     } else {
         if(!query.sortField.empty()) {
             unsigned int field = fieldIndex(query.sortField, schema, tableName(query));
-            iterator = std::make_unique<RowIterators::SortIterator>(std::move(iterator), field);
+            auto sort = std::make_unique<RowIterators::SortIterator>(std::move(iterator), field);
+            RowIterators::SortIterator *sortIterator = sort.get();
+            iterator = std::move(sort);
+            explainIterator("Sort on " + query.sortField, sortIterator);
         }
 
         if(std::holds_alternative<Query::ColumnList>(query.columns)) {
             auto &columnList = std::get<Query::ColumnList>(query.columns);
             std::vector<RowIterators::ProjectIterator::FieldDefinition> fields;
+            std::string description = "Project";
             for(auto &[name, expression] : columnList.columns) {
                 bindExpression(*expression, schema, tableName(query));
+                std::string text = expression->toString();
+                description += (fields.empty() ? " " : ", ") + (text == name ? text : text + " AS " + name);
                 RowIterators::ProjectIterator::FieldDefinition field;
                 field.name = name;
                 field.expression = std::move(expression);
                 fields.push_back(std::move(field));
             }
             iterator = std::make_unique<RowIterators::ProjectIterator>(std::move(iterator), std::move(fields));
+            explainIterator(description);
         }
     }
 
     return iterator;
 }
 
+std::vector<RowIterator::ModifyEntry> Database::buildModifyEntries(Operation::Update &update, RowIterator &iterator)
+{
+    Record::Schema &schema = iterator.schema();
+
+    std::vector<RowIterator::ModifyEntry> entries;
+    for(auto &[name, expression] : update.values) {
+        unsigned int field = fieldIndex(name, schema, tableName(update.query));
+        bindExpression(*expression, schema, tableName(update.query));
+        expression->convert(schema.fields[field].type);
+        auto compiled = std::make_unique<CompiledExpression>(*expression);
+        RowIterator::ModifyEntry entry = {field, std::move(expression), std::move(compiled)};
+        entries.push_back(std::move(entry));
+    }
+
+    return entries;
+}
+
 Table &Database::findTable(const std::string &name)
 {
     auto it = mTables.find(name);
@@ -257,6 +1089,9 @@ public:
 
     std::tuple<int, Value::Type> field(const std::string &name) {
         int fieldIndex = mSchema.fieldIndex(name);
+        if(fieldIndex == -1) {
+            return {-1, Value::Type::Int};
+        }
         Value::Type type = mSchema.fields[fieldIndex].type;
 
         return {fieldIndex, type};
@@ -295,6 +1130,6 @@ const std::string &Database::tableName(Query &query)
     if(std::holds_alternative<Query::Table>(query.source)) {
         return std::get<Query::Table>(query.source).name;
     } else if(std::holds_alternative<Query::Index>(query.source)) {
-        return std::get<Query::Index>(query.source).name;
+        return std::get<Query::Index>(query.source).tableName;
     }
 }
\ No newline at end of file
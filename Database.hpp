@@ -1,14 +1,27 @@
 #ifndef DATABASE_HPP
 #define DATABASE_HPP
 
+#include "ColumnStore.hpp"
 #include "PageSet.hpp"
 #include "Table.hpp"
 #include "Index.hpp"
 #include "RowIterator.hpp"
 
+#include "RowIterators/IndexIterator.hpp"
+
+#include <functional>
+#include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <unordered_map>
+#include <variant>
+
+namespace RowIterators {
+    class ProfileIterator;
+    class SortIterator;
+}
 
 class Database {
 public:
@@ -36,19 +49,26 @@ public:
         };
         struct Index {
             std::string name;
-            std::optional<::Index::Limit> startLimit;
-            std::optional<::Index::Limit> endLimit;
+            std::string tableName;
+            std::optional<RowIterators::IndexIterator::Limit> startLimit;
+            std::optional<RowIterators::IndexIterator::Limit> endLimit;
         };
         std::variant<Table, Index> source;
 
         std::unique_ptr<Expression> predicate;
         std::string sortField;
+
+        // Set when the plan was chosen using the values of literals, and a
+        // query with other values in their place might be planned differently
+        bool literalDependent = false;
     };
 
     struct Operation {
+        // A columnar table also keeps its rows in a column store
         struct CreateTable {
             std::string tableName;
             Record::Schema schema;
+            bool columnar = false;
         };
 
         struct CreateIndex {
@@ -59,7 +79,8 @@ public:
 
         struct Insert {
             std::string tableName;
-            std::vector<Value> values;
+            std::vector<std::vector<Value>> rows;
+            std::vector<std::tuple<unsigned int, unsigned int>> parameters;
         };
 
         struct Delete {
@@ -75,27 +96,129 @@ public:
             std::vector<std::tuple<std::string, std::unique_ptr<Expression>>> values;
         };
 
-        std::variant<CreateTable, CreateIndex, Insert, Select, Delete, Update> operation;
+        struct Copy {
+            std::string tableName;
+            std::string fileName;
+            double fillFactor;
+        };
+
+        struct Vacuum {};
+
+        // Analyzes every table if no table is named
+        struct Analyze {
+            std::string tableName;
+        };
+
+        struct ShowSpace {};
+
+        struct ShowCache {};
+
+        // Describes the plan of a SELECT, UPDATE or DELETE.  With analyze,
+        // the query is also run and the work of each iterator reported.
+        struct Explain {
+            bool analyze;
+            std::unique_ptr<Operation> operation;
+        };
+
+        std::variant<CreateTable, CreateIndex, Insert, Select, Delete, Update, Copy, Vacuum, Analyze, ShowSpace, ShowCache, Explain> operation;
     };
 
     struct QueryResult {
         std::string message;
-        std::unique_ptr<RowIterator> iterator;
+        std::shared_ptr<RowIterator> iterator;
+    };
+
+    // A parsed query whose plan is built once and reused by every execution.
+    // Each ? in the query is a parameter, supplied in order to execute().
+    // The iterator returned by a SELECT belongs to the statement and is
+    // restarted by the next execution.
+    class Statement {
+    public:
+        unsigned int numParameters();
+        QueryResult execute(const std::vector<Value> &parameters = {});
+
+    private:
+        friend class Database;
+
+        // An iterator of an explained query, with the ProfileIterator above it
+        struct ExplainNode {
+            std::string description;
+            RowIterators::ProfileIterator *profile;
+            RowIterators::SortIterator *sort;
+        };
+
+        Statement(Database &database);
+
+        Database &mDatabase;
+        std::string mErrorMessage;
+        std::unique_ptr<Operation> mOperation;
+        std::vector<ParameterExpression*> mParameters;
+        std::shared_ptr<RowIterator> mIterator;
+        std::vector<RowIterator::ModifyEntry> mModifyEntries;
+        bool mReusable;
+        std::vector<ExplainNode> mExplainNodes;
     };
 
+    struct PlanCacheStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    Database();
+    Database(std::unique_ptr<PageSet> pageSet);
+
     PageSet &pageSet();
 
+    std::unique_ptr<Statement> prepare(const std::string &queryString);
     QueryResult executeQuery(const std::string &queryString);
+    QueryResult insertBatch(const std::string &tableName, std::vector<std::vector<Value>> rows);
+
+    PlanCacheStats planCacheStats();
 
 private:
+    friend class Optimizer;
+
+    static const size_t kPlanCacheSize = 128;
+
+    struct PlanCacheEntry {
+        std::string key;
+        std::unique_ptr<Statement> statement;
+    };
+
+    std::unique_ptr<Statement> prepare(const std::string &queryString, bool parameterizeLiterals);
+    std::unique_ptr<Statement> takeCachedStatement(const std::string &key, uint64_t &generation);
+    void returnCachedStatement(const std::string &key, std::unique_ptr<Statement> statement, uint64_t generation);
+    void invalidatePlanCache();
+    static size_t planCacheEntrySize(const std::string &key);
+
+    QueryResult execute(Operation &operation);
+    QueryResult execute(Statement &statement, const std::vector<Value> &parameters);
+    QueryResult run(bool commit, const std::function<QueryResult()> &body);
+    QueryResult dispatch(Operation &operation);
+
+    void loadCatalog();
+    void addCatalogEntry(const std::string &type, const std::string &name, Page::Index rootIndex, const std::string &query);
+
     QueryResult createTable(Operation::CreateTable &createTable);
     QueryResult createIndex(Operation::CreateIndex &createIndex);
     QueryResult insert(Operation::Insert &insert);
-    QueryResult select(Operation::Select &select);
-    QueryResult delete_(Operation::Delete &delete_);
-    QueryResult update(Operation::Update &update);
-
-    std::unique_ptr<RowIterator> buildIterator(Query &query);
+    QueryResult delete_(RowIterator &iterator);
+    QueryResult update(RowIterator &iterator, const std::vector<RowIterator::ModifyEntry> &entries);
+    QueryResult copy(Operation::Copy &copy);
+    QueryResult vacuum(Operation::Vacuum &vacuum);
+    QueryResult analyze(Operation::Analyze &analyze);
+    QueryResult showSpace(Operation::ShowSpace &showSpace);
+    QueryResult showCache(Operation::ShowCache &showCache);
+    QueryResult explain(Statement &statement);
+
+    // If explainNodes is given, each iterator is wrapped in a ProfileIterator
+    // and described there, from the bottom of the tree up
+    void planStatement(Statement &statement, Operation &operation, std::vector<Statement::ExplainNode> *explainNodes);
+    std::unique_ptr<RowIterator> buildIterator(Query &query, const std::vector<std::string> &modifiedColumns = {}, std::vector<Statement::ExplainNode> *explainNodes = nullptr);
+    std::vector<RowIterator::ModifyEntry> buildModifyEntries(Operation::Update &update, RowIterator &iterator);
 
     Table &findTable(const std::string &name);
     Index &findIndex(const std::string &name);
@@ -103,9 +226,21 @@ private:
     unsigned int fieldIndex(const std::string &name, Record::Schema &schema, const std::string &tableName);
     const std::string &tableName(Query &query);
 
-    PageSet mPageSet;
+    std::unique_ptr<PageSet> mPageSet;
+    Record::Schema mCatalogSchema;
+    std::unique_ptr<Table> mCatalog;
     std::map<std::string, std::unique_ptr<Table>> mTables;
     std::map<std::string, std::unique_ptr<Index>> mIndices;
+    std::map<std::string, std::unique_ptr<ColumnStore>> mColumnStores;
+    std::mutex mMutex;
+
+    // Statements for recently executed queries, most recently used first.  A
+    // statement is taken out of the cache while it executes.
+    std::list<PlanCacheEntry> mPlanCache;
+    std::unordered_map<std::string, std::list<PlanCacheEntry>::iterator> mPlanCacheIndex;
+    uint64_t mPlanCacheGeneration;
+    PlanCacheStats mPlanCacheStats;
+    std::mutex mPlanCacheMutex;
 };
 
 #endif
\ No newline at end of file
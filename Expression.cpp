@@ -1,5 +1,235 @@
 #include "Expression.hpp"
 
+#include "FilterKernels.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <sstream>
+
+// Operators are written with their operands parenthesized wherever an
+// operand is itself an operator, so that no precedence rules are needed to
+// read the result
+static std::string operandString(Expression &operand)
+{
+    if(dynamic_cast<CompareExpression*>(&operand) || dynamic_cast<LogicalExpression*>(&operand) || dynamic_cast<ArithmeticExpression*>(&operand) || dynamic_cast<IsNullExpression*>(&operand)) {
+        return "(" + operand.toString() + ")";
+    }
+
+    return operand.toString();
+}
+
+static std::string valueString(Value value)
+{
+    std::stringstream ss;
+    switch(value.type()) {
+        case Value::Type::Int: ss << value.intValue(); break;
+        case Value::Type::Float: ss << value.floatValue(); break;
+        case Value::Type::String: ss << "\"" << value.stringValue() << "\""; break;
+        case Value::Type::Boolean: ss << (value.booleanValue() ? "true" : "false"); break;
+        case Value::Type::BigInt: ss << value.bigIntValue(); break;
+        case Value::Type::Double: ss << value.doubleValue(); break;
+        case Value::Type::Timestamp: ss << "\"" << Value::formatTimestamp(value.timestampValue()) << "\""; break;
+        case Value::Type::Decimal: ss << Value::formatDecimal(value.decimalValue()); break;
+        case Value::Type::Null: ss << "NULL"; break;
+    }
+    return ss.str();
+}
+
+// Reads fields from one row of a batch
+class BatchEvaluateContext : public Expression::EvaluateContext {
+public:
+    BatchEvaluateContext(RowBatch &batch, unsigned int row) : mBatch(batch), mRow(row) {}
+
+    Value fieldValue(unsigned int field) override {
+        return mBatch.column(field).value(mRow);
+    }
+
+    ValueRef fieldRef(unsigned int field, Value &) override {
+        return mBatch.column(field).valueRef(mRow);
+    }
+
+private:
+    RowBatch &mBatch;
+    unsigned int mRow;
+};
+
+// Columns an operand reads directly are used in place rather than copied
+static RowBatch::Column &operandColumn(Expression &operand, RowBatch &batch, RowBatch::Column &scratch)
+{
+    FieldExpression *field = dynamic_cast<FieldExpression*>(&operand);
+    if(field) {
+        return batch.column(field->field());
+    }
+
+    operand.evaluateBatch(batch, scratch);
+    return scratch;
+}
+
+static void fillColumn(RowBatch::Column &result, Value value, unsigned int count)
+{
+    result.type = value.type();
+    result.clear();
+    switch(value.type()) {
+        case Value::Type::Int: result.ints.assign(count, value.intValue()); break;
+        case Value::Type::Float: result.floats.assign(count, value.floatValue()); break;
+        case Value::Type::String: result.strings.assign(count, std::string(value.stringValue())); break;
+        case Value::Type::Boolean: result.booleans.assign(count, value.booleanValue()); break;
+        case Value::Type::BigInt:
+        case Value::Type::Timestamp:
+        case Value::Type::Decimal: result.integers.assign(count, value.integerValue(value.type())); break;
+        case Value::Type::Double: result.doubles.assign(count, value.doubleValue()); break;
+        case Value::Type::Null: break;
+    }
+}
+
+// A row of a result computed from two operands is NULL where either is
+static void mergeNulls(RowBatch::Column &result, const RowBatch::Column &left, const RowBatch::Column &right)
+{
+    result.nulls.assign(std::max(left.nulls.size(), right.nulls.size()), 0);
+    for(size_t i=0; i<left.nulls.size(); i++) result.nulls[i] |= left.nulls[i];
+    for(size_t i=0; i<right.nulls.size(); i++) result.nulls[i] |= right.nulls[i];
+}
+
+// Three-valued logic, with NULL as unknown
+static std::optional<bool> combine(LogicalExpression::LogicalType logicalType, std::optional<bool> left, std::optional<bool> right)
+{
+    switch(logicalType) {
+        case LogicalExpression::And:
+            if(left == false || right == false) {
+                return false;
+            }
+            return (left && right) ? std::optional<bool>(true) : std::nullopt;
+        case LogicalExpression::Or:
+            if(left == true || right == true) {
+                return true;
+            }
+            return (left && right) ? std::optional<bool>(false) : std::nullopt;
+        case LogicalExpression::Not:
+            return left ? std::optional<bool>(!*left) : std::nullopt;
+    }
+    return std::nullopt;
+}
+
+static std::optional<bool> truth(const Value &value)
+{
+    return value.isNull() ? std::nullopt : std::optional<bool>(value.booleanValue());
+}
+
+template<typename T> static void compareValues(CompareExpression::CompareType compareType, const std::vector<T> &left, const std::vector<T> &right, std::vector<uint8_t> &result)
+{
+    size_t size = left.size();
+    result.resize(size);
+    switch(compareType) {
+        case CompareExpression::LessThan:
+            for(size_t i=0; i<size; i++) result[i] = left[i] < right[i];
+            break;
+        case CompareExpression::LessThanEqual:
+            for(size_t i=0; i<size; i++) result[i] = left[i] <= right[i];
+            break;
+        case CompareExpression::Equal:
+            for(size_t i=0; i<size; i++) result[i] = left[i] == right[i];
+            break;
+        case CompareExpression::NotEqual:
+            for(size_t i=0; i<size; i++) result[i] = left[i] != right[i];
+            break;
+        case CompareExpression::GreaterThanEqual:
+            for(size_t i=0; i<size; i++) result[i] = left[i] >= right[i];
+            break;
+        case CompareExpression::GreaterThan:
+            for(size_t i=0; i<size; i++) result[i] = left[i] > right[i];
+            break;
+    }
+}
+
+template<typename T> static void computeValues(ArithmeticExpression::ArithmeticType arithmeticType, const std::vector<T> &left, const std::vector<T> &right, std::vector<T> &result)
+{
+    size_t size = left.size();
+    result.resize(size);
+    switch(arithmeticType) {
+        case ArithmeticExpression::Add:
+            for(size_t i=0; i<size; i++) result[i] = left[i] + right[i];
+            break;
+        case ArithmeticExpression::Subtract:
+            for(size_t i=0; i<size; i++) result[i] = left[i] - right[i];
+            break;
+        case ArithmeticExpression::Multiply:
+            for(size_t i=0; i<size; i++) result[i] = left[i] * right[i];
+            break;
+        case ArithmeticExpression::Divide:
+            for(size_t i=0; i<size; i++) result[i] = left[i] / right[i];
+            break;
+        case ArithmeticExpression::Negate:
+            for(size_t i=0; i<size; i++) result[i] = -left[i];
+            break;
+    }
+}
+
+// A literal takes the type of the other operand, which is tried first on the
+// right, where literals are usually written.  This is done even when the
+// types already match, so that a parameter keeps the type for later values.
+static void adoptType(Expression &left, Expression &right)
+{
+    if(!right.convert(left.type())) {
+        left.convert(right.type());
+    }
+}
+
+ValueRef Expression::EvaluateContext::fieldRef(unsigned int field, Value &storage)
+{
+    storage = fieldValue(field);
+    return ValueRef(storage);
+}
+
+bool Expression::convert(Value::Type)
+{
+    return false;
+}
+
+void Expression::evaluateBatch(RowBatch &batch, RowBatch::Column &result)
+{
+    result.type = type();
+    result.clear();
+    for(unsigned int row=0; row<batch.size(); row++) {
+        BatchEvaluateContext context(batch, row);
+        Value value = evaluate(context);
+        result.append(value);
+    }
+}
+
+void Expression::filterBatch(RowBatch &batch, std::vector<uint64_t> &selection, std::vector<uint64_t> &unknown)
+{
+    RowBatch::Column result;
+    evaluateBatch(batch, result);
+    if(result.type != Value::Type::Boolean) {
+        // Reading a non-boolean result fails just as it does for one row.
+        // A result of type Null has its bitmap filled in.
+        result.booleans.resize(batch.size());
+        for(unsigned int i=0; i<batch.size(); i++) {
+            if(result.isNull(i)) {
+                result.booleans[i] = 0;
+                result.setNull(i);
+            } else {
+                result.booleans[i] = result.value(i).booleanValue();
+            }
+        }
+    }
+
+    selection.resize(FilterKernels::words(batch.size()));
+    unknown.assign(selection.size(), 0);
+    FilterKernels::pack(result.booleans.data(), batch.size(), selection.data());
+    FilterKernels::maskNulls(result.nulls.data(), std::min(result.nulls.size(), selection.size()), selection.data(), unknown.data());
+}
+
+void Expression::filterBatch(RowBatch &batch, std::vector<uint64_t> &selection)
+{
+    std::vector<uint64_t> unknown;
+    filterBatch(batch, selection, unknown);
+}
+
+void Expression::usedFields(std::vector<bool> &)
+{
+}
+
 CompareExpression::CompareExpression(CompareType compareType, std::unique_ptr<Expression> leftOperand, std::unique_ptr<Expression> rightOperand)
 : mCompareType(compareType)
 , mLeftOperand(std::move(leftOperand))
@@ -7,10 +237,28 @@ CompareExpression::CompareExpression(CompareType compareType, std::unique_ptr<Ex
 {
 }
 
+CompareExpression::CompareType CompareExpression::compareType()
+{
+    return mCompareType;
+}
+
+std::unique_ptr<Expression> &CompareExpression::leftOperand()
+{
+    return mLeftOperand;
+}
+
+std::unique_ptr<Expression> &CompareExpression::rightOperand()
+{
+    return mRightOperand;
+}
+
 Value CompareExpression::evaluate(EvaluateContext &context)
 {
     Value leftValue = mLeftOperand->evaluate(context);
     Value rightValue = mRightOperand->evaluate(context);
+    if(leftValue.isNull() || rightValue.isNull()) {
+        return Value::null();
+    }
 
     switch(mCompareType) {
         case CompareType::LessThan:
@@ -32,6 +280,7 @@ void CompareExpression::bind(BindContext &context)
 {
     mLeftOperand->bind(context);
     mRightOperand->bind(context);
+    adoptType(*mLeftOperand, *mRightOperand);
 }
 
 Value::Type CompareExpression::type()
@@ -39,6 +288,118 @@ Value::Type CompareExpression::type()
     return Value::Type::Boolean;
 }
 
+std::string CompareExpression::toString()
+{
+    std::string op;
+    switch(mCompareType) {
+        case CompareType::LessThan: op = " < "; break;
+        case CompareType::LessThanEqual: op = " <= "; break;
+        case CompareType::Equal: op = " == "; break;
+        case CompareType::NotEqual: op = " != "; break;
+        case CompareType::GreaterThanEqual: op = " >= "; break;
+        case CompareType::GreaterThan: op = " > "; break;
+    }
+
+    return operandString(*mLeftOperand) + op + operandString(*mRightOperand);
+}
+
+void CompareExpression::evaluateBatch(RowBatch &batch, RowBatch::Column &result)
+{
+    RowBatch::Column leftScratch;
+    RowBatch::Column rightScratch;
+    RowBatch::Column &left = operandColumn(*mLeftOperand, batch, leftScratch);
+    RowBatch::Column &right = operandColumn(*mRightOperand, batch, rightScratch);
+    if(left.type != right.type || left.type == Value::Type::Null) {
+        Expression::evaluateBatch(batch, result);
+        return;
+    }
+
+    result.type = Value::Type::Boolean;
+    result.clear();
+    switch(left.type) {
+        case Value::Type::Int: compareValues(mCompareType, left.ints, right.ints, result.booleans); break;
+        case Value::Type::Float: compareValues(mCompareType, left.floats, right.floats, result.booleans); break;
+        case Value::Type::String: compareValues(mCompareType, left.strings, right.strings, result.booleans); break;
+        case Value::Type::Boolean: compareValues(mCompareType, left.booleans, right.booleans, result.booleans); break;
+        case Value::Type::BigInt:
+        case Value::Type::Timestamp:
+        case Value::Type::Decimal: compareValues(mCompareType, left.integers, right.integers, result.booleans); break;
+        case Value::Type::Double: compareValues(mCompareType, left.doubles, right.doubles, result.booleans); break;
+        case Value::Type::Null: break;
+    }
+    mergeNulls(result, left, right);
+}
+
+void CompareExpression::filterBatch(RowBatch &batch, std::vector<uint64_t> &selection, std::vector<uint64_t> &unknown)
+{
+    // Numeric columns compared with a constant or with each other go
+    // through the filter kernels, with any constant moved to the right, and
+    // then have their NULL rows masked out
+    auto isValue = [](Expression &operand) {
+        return dynamic_cast<ConstantExpression*>(&operand) || dynamic_cast<ParameterExpression*>(&operand);
+    };
+
+    Expression *leftOperand = mLeftOperand.get();
+    Expression *rightOperand = mRightOperand.get();
+    CompareType compareType = mCompareType;
+    if(isValue(*leftOperand) && !isValue(*rightOperand)) {
+        std::swap(leftOperand, rightOperand);
+        switch(compareType) {
+            case LessThan: compareType = GreaterThan; break;
+            case LessThanEqual: compareType = GreaterThanEqual; break;
+            case GreaterThanEqual: compareType = LessThanEqual; break;
+            case GreaterThan: compareType = LessThan; break;
+            default: break;
+        }
+    }
+
+    RowBatch::Column leftScratch;
+    RowBatch::Column rightScratch;
+    RowBatch::Column &left = operandColumn(*leftOperand, batch, leftScratch);
+    selection.resize(FilterKernels::words(batch.size()));
+    unknown.assign(selection.size(), 0);
+    auto maskNulls = [&](const RowBatch::Column &column) {
+        FilterKernels::maskNulls(column.nulls.data(), std::min(column.nulls.size(), selection.size()), selection.data(), unknown.data());
+    };
+
+    if(isValue(*rightOperand)) {
+        BatchEvaluateContext context(batch, 0);
+        Value value = rightOperand->evaluate(context);
+        if(left.type == Value::Type::Int && value.type() == Value::Type::Int) {
+            FilterKernels::compare(compareType, left.ints.data(), value.intValue(), batch.size(), selection.data());
+            maskNulls(left);
+            return;
+        }
+        if(left.type == Value::Type::Float && value.type() == Value::Type::Float) {
+            FilterKernels::compare(compareType, left.floats.data(), value.floatValue(), batch.size(), selection.data());
+            maskNulls(left);
+            return;
+        }
+    } else {
+        RowBatch::Column &right = operandColumn(*rightOperand, batch, rightScratch);
+        if(left.type == Value::Type::Int && right.type == Value::Type::Int) {
+            FilterKernels::compare(compareType, left.ints.data(), right.ints.data(), batch.size(), selection.data());
+            maskNulls(left);
+            maskNulls(right);
+            return;
+        }
+        if(left.type == Value::Type::Float && right.type == Value::Type::Float) {
+            FilterKernels::compare(compareType, left.floats.data(), right.floats.data(), batch.size(), selection.data());
+            maskNulls(left);
+            maskNulls(right);
+            return;
+        }
+    }
+
+    Expression::filterBatch(batch, selection, unknown);
+}
+
+void CompareExpression::usedFields(std::vector<bool> &fields)
+{
+    mLeftOperand->usedFields(fields);
+    mRightOperand->usedFields(fields);
+}
+
 LogicalExpression::LogicalExpression(LogicalType logicalType, std::unique_ptr<Expression> leftOperand, std::unique_ptr<Expression> rightOperand)
 : mLogicalType(logicalType)
 , mLeftOperand(std::move(leftOperand))
@@ -46,32 +407,205 @@ LogicalExpression::LogicalExpression(LogicalType logicalType, std::unique_ptr<Ex
 {
 }
 
+LogicalExpression::LogicalType LogicalExpression::logicalType()
+{
+    return mLogicalType;
+}
+
+std::unique_ptr<Expression> &LogicalExpression::leftOperand()
+{
+    return mLeftOperand;
+}
+
+std::unique_ptr<Expression> &LogicalExpression::rightOperand()
+{
+    return mRightOperand;
+}
+
 Value LogicalExpression::evaluate(EvaluateContext &context)
 {
     Value leftValue = mLeftOperand->evaluate(context);
-    Value rightValue = (mLogicalType != Not) ? mRightOperand->evaluate(context) : Value();
+    Value rightValue = (mLogicalType != Not) ? mRightOperand->evaluate(context) : Value(false);
+
+    std::optional<bool> result = combine(mLogicalType, truth(leftValue), truth(rightValue));
+    return result ? Value(*result) : Value::null();
+}
+
+void LogicalExpression::bind(BindContext &context)
+{
+    mLeftOperand->bind(context);
+    if(mRightOperand) mRightOperand->bind(context);
+}
 
+Value::Type LogicalExpression::type()
+{
+    return Value::Type::Boolean;
+}
+
+std::string LogicalExpression::toString()
+{
     switch(mLogicalType) {
         case LogicalType::And:
-            return Value(leftValue.booleanValue() && rightValue.booleanValue());
+            return operandString(*mLeftOperand) + " && " + operandString(*mRightOperand);
         case LogicalType::Or:
-            return Value(leftValue.booleanValue() || rightValue.booleanValue());
+            return operandString(*mLeftOperand) + " || " + operandString(*mRightOperand);
         case LogicalType::Not:
-            return Value(!leftValue.booleanValue());
+            return "!" + operandString(*mLeftOperand);
     }
+    return "";
 }
 
-void LogicalExpression::bind(BindContext &context)
+void LogicalExpression::evaluateBatch(RowBatch &batch, RowBatch::Column &result)
 {
-    mLeftOperand->bind(context);
-    if(mRightOperand) mRightOperand->bind(context);
+    RowBatch::Column leftScratch;
+    RowBatch::Column rightScratch;
+    RowBatch::Column &left = operandColumn(*mLeftOperand, batch, leftScratch);
+    RowBatch::Column &right = (mLogicalType != Not) ? operandColumn(*mRightOperand, batch, rightScratch) : left;
+    if(left.type != Value::Type::Boolean || right.type != Value::Type::Boolean) {
+        Expression::evaluateBatch(batch, result);
+        return;
+    }
+
+    size_t size = left.booleans.size();
+    result.type = Value::Type::Boolean;
+    result.clear();
+    result.booleans.resize(size);
+    if(!left.nulls.empty() || !right.nulls.empty()) {
+        for(size_t i=0; i<size; i++) {
+            std::optional<bool> leftValue = left.isNull(i) ? std::nullopt : std::optional<bool>(left.booleans[i]);
+            std::optional<bool> rightValue = right.isNull(i) ? std::nullopt : std::optional<bool>(right.booleans[i]);
+            std::optional<bool> value = combine(mLogicalType, leftValue, rightValue);
+            if(value) {
+                result.booleans[i] = *value;
+            } else {
+                result.setNull(i);
+            }
+        }
+        return;
+    }
+
+    switch(mLogicalType) {
+        case LogicalType::And:
+            for(size_t i=0; i<size; i++) result.booleans[i] = left.booleans[i] & right.booleans[i];
+            break;
+        case LogicalType::Or:
+            for(size_t i=0; i<size; i++) result.booleans[i] = left.booleans[i] | right.booleans[i];
+            break;
+        case LogicalType::Not:
+            for(size_t i=0; i<size; i++) result.booleans[i] = !left.booleans[i];
+            break;
+    }
 }
 
-Value::Type LogicalExpression::type()
+void LogicalExpression::filterBatch(RowBatch &batch, std::vector<uint64_t> &selection, std::vector<uint64_t> &unknown)
+{
+    if(mLeftOperand->type() != Value::Type::Boolean || (mRightOperand && mRightOperand->type() != Value::Type::Boolean)) {
+        Expression::filterBatch(batch, selection, unknown);
+        return;
+    }
+
+    mLeftOperand->filterBatch(batch, selection, unknown);
+
+    // Bits past the last row may be left set, since they are never read.  A
+    // row is false where it is in neither selection nor unknown.
+    std::vector<uint64_t> right;
+    std::vector<uint64_t> rightUnknown;
+    switch(mLogicalType) {
+        case LogicalType::And:
+            mRightOperand->filterBatch(batch, right, rightUnknown);
+            for(size_t i=0; i<selection.size(); i++) {
+                uint64_t isFalse = (~selection[i] & ~unknown[i]) | (~right[i] & ~rightUnknown[i]);
+                selection[i] &= right[i];
+                unknown[i] = (unknown[i] | rightUnknown[i]) & ~isFalse;
+            }
+            break;
+        case LogicalType::Or:
+            mRightOperand->filterBatch(batch, right, rightUnknown);
+            for(size_t i=0; i<selection.size(); i++) {
+                selection[i] |= right[i];
+                unknown[i] = (unknown[i] | rightUnknown[i]) & ~selection[i];
+            }
+            break;
+        case LogicalType::Not:
+            for(size_t i=0; i<selection.size(); i++) selection[i] = ~selection[i] & ~unknown[i];
+            break;
+    }
+}
+
+void LogicalExpression::usedFields(std::vector<bool> &fields)
+{
+    mLeftOperand->usedFields(fields);
+    if(mRightOperand) mRightOperand->usedFields(fields);
+}
+
+IsNullExpression::IsNullExpression(std::unique_ptr<Expression> operand, bool negated)
+: mOperand(std::move(operand))
+, mNegated(negated)
+{
+}
+
+std::unique_ptr<Expression> &IsNullExpression::operand()
+{
+    return mOperand;
+}
+
+bool IsNullExpression::negated()
+{
+    return mNegated;
+}
+
+Value IsNullExpression::evaluate(EvaluateContext &context)
+{
+    return Value(mOperand->evaluate(context).isNull() != mNegated);
+}
+
+void IsNullExpression::bind(BindContext &context)
+{
+    mOperand->bind(context);
+}
+
+Value::Type IsNullExpression::type()
 {
     return Value::Type::Boolean;
 }
 
+std::string IsNullExpression::toString()
+{
+    return operandString(*mOperand) + (mNegated ? " IS NOT NULL" : " IS NULL");
+}
+
+void IsNullExpression::evaluateBatch(RowBatch &batch, RowBatch::Column &result)
+{
+    RowBatch::Column scratch;
+    RowBatch::Column &column = operandColumn(*mOperand, batch, scratch);
+
+    result.type = Value::Type::Boolean;
+    result.clear();
+    result.booleans.resize(batch.size());
+    for(unsigned int i=0; i<batch.size(); i++) {
+        result.booleans[i] = column.isNull(i) != mNegated;
+    }
+}
+
+void IsNullExpression::filterBatch(RowBatch &batch, std::vector<uint64_t> &selection, std::vector<uint64_t> &unknown)
+{
+    // The selection is the operand's null bitmap
+    RowBatch::Column scratch;
+    RowBatch::Column &column = operandColumn(*mOperand, batch, scratch);
+
+    selection.assign(FilterKernels::words(batch.size()), column.type == Value::Type::Null ? ~uint64_t(0) : 0);
+    unknown.assign(selection.size(), 0);
+    std::copy_n(column.nulls.begin(), std::min(column.nulls.size(), selection.size()), selection.begin());
+    if(mNegated) {
+        for(uint64_t &word : selection) word = ~word;
+    }
+}
+
+void IsNullExpression::usedFields(std::vector<bool> &fields)
+{
+    mOperand->usedFields(fields);
+}
+
 ArithmeticExpression::ArithmeticExpression(ArithmeticType arithmeticType, std::unique_ptr<Expression> leftOperand, std::unique_ptr<Expression> rightOperand)
 : mArithmeticType(arithmeticType)
 , mLeftOperand(std::move(leftOperand))
@@ -79,6 +613,21 @@ ArithmeticExpression::ArithmeticExpression(ArithmeticType arithmeticType, std::u
 {
 }
 
+ArithmeticExpression::ArithmeticType ArithmeticExpression::arithmeticType()
+{
+    return mArithmeticType;
+}
+
+std::unique_ptr<Expression> &ArithmeticExpression::leftOperand()
+{
+    return mLeftOperand;
+}
+
+std::unique_ptr<Expression> &ArithmeticExpression::rightOperand()
+{
+    return mRightOperand;
+}
+
 Value ArithmeticExpression::evaluate(EvaluateContext &context)
 {
     Value leftValue = mLeftOperand->evaluate(context);
@@ -101,7 +650,10 @@ Value ArithmeticExpression::evaluate(EvaluateContext &context)
 void ArithmeticExpression::bind(BindContext &context)
 {
     mLeftOperand->bind(context);
-    if(mRightOperand) mRightOperand->bind(context);
+    if(mRightOperand) {
+        mRightOperand->bind(context);
+        adoptType(*mLeftOperand, *mRightOperand);
+    }
 }
 
 Value::Type ArithmeticExpression::type()
@@ -109,6 +661,79 @@ Value::Type ArithmeticExpression::type()
     return mLeftOperand->type();
 }
 
+// Converts literals computed from other literals, such as -1.0, by
+// converting each operand.  An operand which cannot be converted leaves the
+// other as it was.
+bool ArithmeticExpression::convert(Value::Type type)
+{
+    if(this->type() == type) {
+        return true;
+    }
+
+    Value::Type leftType = mLeftOperand->type();
+    if(!mLeftOperand->convert(type)) {
+        return false;
+    }
+
+    if(mRightOperand && mRightOperand->type() != type && !mRightOperand->convert(type)) {
+        mLeftOperand->convert(leftType);
+        return false;
+    }
+
+    return true;
+}
+
+std::string ArithmeticExpression::toString()
+{
+    switch(mArithmeticType) {
+        case ArithmeticType::Add:
+            return operandString(*mLeftOperand) + " + " + operandString(*mRightOperand);
+        case ArithmeticType::Subtract:
+            return operandString(*mLeftOperand) + " - " + operandString(*mRightOperand);
+        case ArithmeticType::Multiply:
+            return operandString(*mLeftOperand) + " * " + operandString(*mRightOperand);
+        case ArithmeticType::Divide:
+            return operandString(*mLeftOperand) + " / " + operandString(*mRightOperand);
+        case ArithmeticType::Negate:
+            return "-" + operandString(*mLeftOperand);
+    }
+    return "";
+}
+
+void ArithmeticExpression::evaluateBatch(RowBatch &batch, RowBatch::Column &result)
+{
+    RowBatch::Column leftScratch;
+    RowBatch::Column rightScratch;
+    RowBatch::Column &left = operandColumn(*mLeftOperand, batch, leftScratch);
+    RowBatch::Column &right = (mArithmeticType != Negate) ? operandColumn(*mRightOperand, batch, rightScratch) : left;
+    // Decimals are rescaled when multiplied or divided, which Value does,
+    // and NULL divisors are left to Value rather than divided by
+    bool rescaled = mArithmeticType == Multiply || mArithmeticType == Divide;
+    bool computed = left.type == right.type && (left.type != Value::Type::Decimal || !rescaled) && (mArithmeticType != Divide || right.nulls.empty());
+    if(!computed) {
+        Expression::evaluateBatch(batch, result);
+        return;
+    }
+
+    result.type = left.type;
+    result.clear();
+    switch(left.type) {
+        case Value::Type::Int: computeValues(mArithmeticType, left.ints, right.ints, result.ints); break;
+        case Value::Type::Float: computeValues(mArithmeticType, left.floats, right.floats, result.floats); break;
+        case Value::Type::BigInt:
+        case Value::Type::Decimal: computeValues(mArithmeticType, left.integers, right.integers, result.integers); break;
+        case Value::Type::Double: computeValues(mArithmeticType, left.doubles, right.doubles, result.doubles); break;
+        default: Expression::evaluateBatch(batch, result); return;
+    }
+    mergeNulls(result, left, right);
+}
+
+void ArithmeticExpression::usedFields(std::vector<bool> &fields)
+{
+    mLeftOperand->usedFields(fields);
+    if(mRightOperand) mRightOperand->usedFields(fields);
+}
+
 ConstantExpression::ConstantExpression(Value value)
 : mValue(value)
 {
@@ -128,6 +753,95 @@ Value::Type ConstantExpression::type()
     return mValue.type();
 }
 
+bool ConstantExpression::convert(Value::Type type)
+{
+    return mValue.convert(type);
+}
+
+std::string ConstantExpression::toString()
+{
+    return valueString(mValue);
+}
+
+void ConstantExpression::evaluateBatch(RowBatch &batch, RowBatch::Column &result)
+{
+    fillColumn(result, mValue, batch.size());
+}
+
+ParameterExpression::ParameterExpression(unsigned int index)
+: mIndex(index)
+, mValue(0)
+{
+    mTyped = false;
+    mConverted = false;
+}
+
+ParameterExpression::ParameterExpression(unsigned int index, Value value)
+: mIndex(index)
+, mValue(value)
+{
+    mTyped = true;
+    mConverted = false;
+}
+
+unsigned int ParameterExpression::index()
+{
+    return mIndex;
+}
+
+bool ParameterExpression::typed()
+{
+    return mTyped;
+}
+
+bool ParameterExpression::setValue(const Value &value)
+{
+    mValue = value;
+    if(mConverted) {
+        return mValue.convert(mConvertType);
+    }
+
+    return true;
+}
+
+Value ParameterExpression::evaluate(EvaluateContext &)
+{
+    return mValue;
+}
+
+void ParameterExpression::bind(BindContext &)
+{
+}
+
+Value::Type ParameterExpression::type()
+{
+    return mValue.type();
+}
+
+bool ParameterExpression::convert(Value::Type type)
+{
+    // Until a value is supplied, a parameter written as ? converts to any
+    // type
+    if(!mValue.convert(type) && mTyped) {
+        return false;
+    }
+
+    mConverted = true;
+    mConvertType = type;
+    return true;
+}
+
+std::string ParameterExpression::toString()
+{
+    // A parameter standing in for a literal is shown as the literal
+    return mTyped ? valueString(mValue) : "?";
+}
+
+void ParameterExpression::evaluateBatch(RowBatch &batch, RowBatch::Column &result)
+{
+    fillColumn(result, mValue, batch.size());
+}
+
 FieldExpression::FieldExpression(int field)
 : mField(field)
 {
@@ -144,6 +858,11 @@ const std::string &FieldExpression::name()
     return mName;
 }
 
+int FieldExpression::field()
+{
+    return mField;
+}
+
 Value FieldExpression::evaluate(EvaluateContext &context)
 {
     return context.fieldValue(mField);
@@ -161,3 +880,25 @@ Value::Type FieldExpression::type()
 {
     return mType;
 }
+
+std::string FieldExpression::toString()
+{
+    return mName;
+}
+
+void FieldExpression::evaluateBatch(RowBatch &batch, RowBatch::Column &result)
+{
+    result = batch.column(mField);
+}
+
+void FieldExpression::usedFields(std::vector<bool> &fields)
+{
+    if(mField < 0) {
+        return;
+    }
+
+    if(fields.size() <= unsigned(mField)) {
+        fields.resize(mField + 1, false);
+    }
+    fields[mField] = true;
+}
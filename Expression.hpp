@@ -1,10 +1,12 @@
 #ifndef EXPRESSION_HPP
 #define EXPRESSION_HPP
 
+#include "RowBatch.hpp"
 #include "Value.hpp"
 
 #include <memory>
 #include <string>
+#include <vector>
 
 class Expression {
 public:
@@ -14,6 +16,10 @@ public:
     public:
         virtual ~EvaluateContext() = default;
         virtual Value fieldValue(unsigned int field) = 0;
+
+        // Reads a field without copying it if the context can, and otherwise
+        // into storage.  By default the field is read through fieldValue().
+        virtual ValueRef fieldRef(unsigned int field, Value &storage);
     };
     virtual Value evaluate(EvaluateContext &context) = 0;
 
@@ -29,6 +35,29 @@ public:
 
     virtual void bind(BindContext &context) = 0;
     virtual Value::Type type() = 0;
+
+    // Gives a literal the type of the operand it is compared or combined
+    // with, as Value::convert() would.  Returns false, changing nothing, for
+    // anything but a literal or if the value cannot be converted.
+    virtual bool convert(Value::Type type);
+
+    // Writes the expression back out in query syntax
+    virtual std::string toString() = 0;
+
+    // Evaluates the expression for every row of batch into result, which is
+    // given the expression's type.  By default each row is evaluated on its
+    // own through evaluate().
+    virtual void evaluateBatch(RowBatch &batch, RowBatch::Column &result);
+
+    // Sets bit i of selection, which holds 64 rows to a word, if the
+    // expression is true for row i of batch, and bit i of unknown instead if
+    // it is NULL.  By default the result of evaluateBatch() is packed into
+    // bits.
+    virtual void filterBatch(RowBatch &batch, std::vector<uint64_t> &selection, std::vector<uint64_t> &unknown);
+    void filterBatch(RowBatch &batch, std::vector<uint64_t> &selection);
+
+    // Sets the entries of fields for the fields the expression reads
+    virtual void usedFields(std::vector<bool> &fields);
 };
 
 class CompareExpression : public Expression {
@@ -43,9 +72,18 @@ public:
     };
 
     CompareExpression(CompareType compareType, std::unique_ptr<Expression> leftOperand, std::unique_ptr<Expression> rightOperand);
+
+    CompareType compareType();
+    std::unique_ptr<Expression> &leftOperand();
+    std::unique_ptr<Expression> &rightOperand();
+
     Value evaluate(EvaluateContext &context) override;
     void bind(BindContext &context) override;
     Value::Type type() override;
+    std::string toString() override;
+    void evaluateBatch(RowBatch &batch, RowBatch::Column &result) override;
+    void filterBatch(RowBatch &batch, std::vector<uint64_t> &selection, std::vector<uint64_t> &unknown) override;
+    void usedFields(std::vector<bool> &fields) override;
 
 private:
     CompareType mCompareType;
@@ -53,6 +91,9 @@ private:
     std::unique_ptr<Expression> mRightOperand;
 };
 
+// Operands are NULL where unknown, following SQL's three-valued logic: And
+// is false if either operand is false, and Or true if either is true, even
+// where the other is NULL
 class LogicalExpression : public Expression {
 public:
     enum LogicalType {
@@ -62,9 +103,18 @@ public:
     };
 
     LogicalExpression(LogicalType logicalType, std::unique_ptr<Expression> leftOperand, std::unique_ptr<Expression> rightOperand);
+
+    LogicalType logicalType();
+    std::unique_ptr<Expression> &leftOperand();
+    std::unique_ptr<Expression> &rightOperand();
+
     Value evaluate(EvaluateContext &context) override;
     void bind(BindContext &context) override;
     Value::Type type() override;
+    std::string toString() override;
+    void evaluateBatch(RowBatch &batch, RowBatch::Column &result) override;
+    void filterBatch(RowBatch &batch, std::vector<uint64_t> &selection, std::vector<uint64_t> &unknown) override;
+    void usedFields(std::vector<bool> &fields) override;
 
 private:
     LogicalType mLogicalType;
@@ -72,6 +122,27 @@ private:
     std::unique_ptr<Expression> mRightOperand;
 };
 
+// Tests an operand for NULL; unlike a comparison, the result is never NULL
+class IsNullExpression : public Expression {
+public:
+    IsNullExpression(std::unique_ptr<Expression> operand, bool negated);
+
+    std::unique_ptr<Expression> &operand();
+    bool negated();
+
+    Value evaluate(EvaluateContext &context) override;
+    void bind(BindContext &context) override;
+    Value::Type type() override;
+    std::string toString() override;
+    void evaluateBatch(RowBatch &batch, RowBatch::Column &result) override;
+    void filterBatch(RowBatch &batch, std::vector<uint64_t> &selection, std::vector<uint64_t> &unknown) override;
+    void usedFields(std::vector<bool> &fields) override;
+
+private:
+    std::unique_ptr<Expression> mOperand;
+    bool mNegated;
+};
+
 class ArithmeticExpression : public Expression {
 public:
     enum ArithmeticType {
@@ -83,9 +154,18 @@ public:
     };
 
     ArithmeticExpression(ArithmeticType arithmeticType, std::unique_ptr<Expression> leftOperand, std::unique_ptr<Expression> rightOperand);
+
+    ArithmeticType arithmeticType();
+    std::unique_ptr<Expression> &leftOperand();
+    std::unique_ptr<Expression> &rightOperand();
+
     Value evaluate(EvaluateContext &context) override;
     void bind(BindContext &context) override;
     Value::Type type() override;
+    bool convert(Value::Type type) override;
+    std::string toString() override;
+    void evaluateBatch(RowBatch &batch, RowBatch::Column &result) override;
+    void usedFields(std::vector<bool> &fields) override;
 
 private:
     ArithmeticType mArithmeticType;
@@ -99,9 +179,41 @@ public:
     Value evaluate(EvaluateContext &context) override;
     void bind(BindContext &context) override;
     Value::Type type() override;
+    bool convert(Value::Type type) override;
+    std::string toString() override;
+    void evaluateBatch(RowBatch &batch, RowBatch::Column &result) override;
+
+private:
+    Value mValue;
+};
+
+// Placeholder for a value supplied when a prepared statement is executed.
+// A parameter standing in for a literal has that literal's type; one written
+// as ? takes the type of whatever value is supplied.  Once converted, a
+// parameter converts each value supplied to the same type, and setValue()
+// returns false for a value that cannot be.
+class ParameterExpression : public Expression {
+public:
+    ParameterExpression(unsigned int index);
+    ParameterExpression(unsigned int index, Value value);
+
+    unsigned int index();
+    bool typed();
+    bool setValue(const Value &value);
+
+    Value evaluate(EvaluateContext &context) override;
+    void bind(BindContext &context) override;
+    Value::Type type() override;
+    bool convert(Value::Type type) override;
+    std::string toString() override;
+    void evaluateBatch(RowBatch &batch, RowBatch::Column &result) override;
 
 private:
+    unsigned int mIndex;
     Value mValue;
+    bool mTyped;
+    bool mConverted;
+    Value::Type mConvertType;
 };
 
 class FieldExpression : public Expression {
@@ -110,10 +222,14 @@ public:
     FieldExpression(const std::string &name);
 
     const std::string &name();
+    int field();
 
     Value evaluate(EvaluateContext &context) override;
     void bind(BindContext &context) override;
     Value::Type type() override;
+    std::string toString() override;
+    void evaluateBatch(RowBatch &batch, RowBatch::Column &result) override;
+    void usedFields(std::vector<bool> &fields) override;
 
 private:
     int mField;
@@ -0,0 +1,138 @@
+#include "File.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+File::File(const std::string &filename)
+: mFilename(filename)
+{
+#ifdef _WIN32
+    mHandle = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(mHandle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Unable to open file " + filename);
+    }
+#else
+    mHandle = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if(mHandle == -1) {
+        throw std::runtime_error("Unable to open file " + filename);
+    }
+#endif
+}
+
+File::~File()
+{
+#ifdef _WIN32
+    CloseHandle(mHandle);
+#else
+    ::close(mHandle);
+#endif
+}
+
+const std::string &File::filename() const
+{
+    return mFilename;
+}
+
+uint64_t File::size()
+{
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(mHandle, &size)) {
+        throw std::runtime_error("Unable to query size of file " + mFilename);
+    }
+    return size.QuadPart;
+#else
+    struct stat info;
+    if(fstat(mHandle, &info) != 0) {
+        throw std::runtime_error("Unable to query size of file " + mFilename);
+    }
+    return info.st_size;
+#endif
+}
+
+size_t File::read(uint64_t offset, void *data, size_t size)
+{
+    size_t total = 0;
+    while(total < size) {
+        uint8_t *dest = reinterpret_cast<uint8_t*>(data) + total;
+#ifdef _WIN32
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = DWORD(offset + total);
+        overlapped.OffsetHigh = DWORD((offset + total) >> 32);
+        DWORD count = 0;
+        if(!ReadFile(mHandle, dest, DWORD(size - total), &count, &overlapped) && GetLastError() != ERROR_HANDLE_EOF) {
+            throw std::runtime_error("Unable to read file " + mFilename);
+        }
+#else
+        ssize_t count = pread(mHandle, dest, size - total, off_t(offset + total));
+        if(count < 0) {
+            throw std::runtime_error("Unable to read file " + mFilename);
+        }
+#endif
+        if(count == 0) {
+            break;
+        }
+        total += count;
+    }
+
+    return total;
+}
+
+void File::write(uint64_t offset, const void *data, size_t size)
+{
+    size_t total = 0;
+    while(total < size) {
+        const uint8_t *src = reinterpret_cast<const uint8_t*>(data) + total;
+#ifdef _WIN32
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = DWORD(offset + total);
+        overlapped.OffsetHigh = DWORD((offset + total) >> 32);
+        DWORD count = 0;
+        if(!WriteFile(mHandle, src, DWORD(size - total), &count, &overlapped)) {
+            throw std::runtime_error("Unable to write file " + mFilename);
+        }
+#else
+        ssize_t count = pwrite(mHandle, src, size - total, off_t(offset + total));
+        if(count < 0) {
+            throw std::runtime_error("Unable to write file " + mFilename);
+        }
+#endif
+        total += count;
+    }
+}
+
+void File::resize(uint64_t size)
+{
+#ifdef _WIN32
+    LARGE_INTEGER position;
+    position.QuadPart = size;
+    if(!SetFilePointerEx(mHandle, position, NULL, FILE_BEGIN) || !SetEndOfFile(mHandle)) {
+        throw std::runtime_error("Unable to resize file " + mFilename);
+    }
+#else
+    if(ftruncate(mHandle, off_t(size)) != 0) {
+        throw std::runtime_error("Unable to resize file " + mFilename);
+    }
+#endif
+}
+
+void File::sync()
+{
+#ifdef _WIN32
+    if(!FlushFileBuffers(mHandle)) {
+        throw std::runtime_error("Unable to sync file " + mFilename);
+    }
+#else
+    if(fsync(mHandle) != 0) {
+        throw std::runtime_error("Unable to sync file " + mFilename);
+    }
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#ifndef FILE_HPP
+#define FILE_HPP
+
+#include <string>
+#include <cstdint>
+
+// Thin wrapper around a native file handle, providing positioned reads and
+// writes and an explicit sync to stable storage
+class File {
+public:
+    File(const std::string &filename);
+    ~File();
+
+    File(const File &other) = delete;
+    File &operator=(const File &other) = delete;
+
+    const std::string &filename() const;
+    uint64_t size();
+
+    size_t read(uint64_t offset, void *data, size_t size);
+    void write(uint64_t offset, const void *data, size_t size);
+    void resize(uint64_t size);
+    void sync();
+
+private:
+    std::string mFilename;
+#ifdef _WIN32
+    void *mHandle;
+#else
+    int mHandle;
+#endif
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,214 @@
+#include "FilterKernels.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FILTERKERNELS_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FILTERKERNELS_SSE2
+#endif
+
+// Operations on a vector of lanes of T.  Each comparison returns a mask with
+// one bit per lane, lowest lane first.
+template<typename T> struct ScalarOps {
+    static const unsigned int kLanes = 1;
+    typedef T Vector;
+
+    static Vector load(const T *values) { return *values; }
+    static Vector broadcast(T value) { return value; }
+    static unsigned int lessThan(Vector a, Vector b) { return a < b; }
+    static unsigned int lessThanEqual(Vector a, Vector b) { return a <= b; }
+    static unsigned int equal(Vector a, Vector b) { return a == b; }
+};
+
+template<typename T> struct VectorOps : ScalarOps<T> {};
+
+#if defined(FILTERKERNELS_AVX2)
+template<> struct VectorOps<int> {
+    static const unsigned int kLanes = 8;
+    typedef __m256i Vector;
+
+    static Vector load(const int *values) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values)); }
+    static Vector broadcast(int value) { return _mm256_set1_epi32(value); }
+    static unsigned int mask(Vector v) { return _mm256_movemask_ps(_mm256_castsi256_ps(v)); }
+    static unsigned int lessThan(Vector a, Vector b) { return mask(_mm256_cmpgt_epi32(b, a)); }
+    static unsigned int lessThanEqual(Vector a, Vector b) { return ~mask(_mm256_cmpgt_epi32(a, b)) & 0xff; }
+    static unsigned int equal(Vector a, Vector b) { return mask(_mm256_cmpeq_epi32(a, b)); }
+};
+
+template<> struct VectorOps<float> {
+    static const unsigned int kLanes = 8;
+    typedef __m256 Vector;
+
+    static Vector load(const float *values) { return _mm256_loadu_ps(values); }
+    static Vector broadcast(float value) { return _mm256_set1_ps(value); }
+    static unsigned int lessThan(Vector a, Vector b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+    static unsigned int lessThanEqual(Vector a, Vector b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LE_OQ)); }
+    static unsigned int equal(Vector a, Vector b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)); }
+};
+#elif defined(FILTERKERNELS_SSE2)
+template<> struct VectorOps<int> {
+    static const unsigned int kLanes = 4;
+    typedef __m128i Vector;
+
+    static Vector load(const int *values) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(values)); }
+    static Vector broadcast(int value) { return _mm_set1_epi32(value); }
+    static unsigned int mask(Vector v) { return _mm_movemask_ps(_mm_castsi128_ps(v)); }
+    static unsigned int lessThan(Vector a, Vector b) { return mask(_mm_cmplt_epi32(a, b)); }
+    static unsigned int lessThanEqual(Vector a, Vector b) { return ~mask(_mm_cmpgt_epi32(a, b)) & 0xf; }
+    static unsigned int equal(Vector a, Vector b) { return mask(_mm_cmpeq_epi32(a, b)); }
+};
+
+template<> struct VectorOps<float> {
+    static const unsigned int kLanes = 4;
+    typedef __m128 Vector;
+
+    static Vector load(const float *values) { return _mm_loadu_ps(values); }
+    static Vector broadcast(float value) { return _mm_set1_ps(value); }
+    static unsigned int lessThan(Vector a, Vector b) { return _mm_movemask_ps(_mm_cmplt_ps(a, b)); }
+    static unsigned int lessThanEqual(Vector a, Vector b) { return _mm_movemask_ps(_mm_cmple_ps(a, b)); }
+    static unsigned int equal(Vector a, Vector b) { return _mm_movemask_ps(_mm_cmpeq_ps(a, b)); }
+};
+#endif
+
+// The right hand side of a comparison, loaded a vector at a time
+template<typename T> struct ConstantOperand {
+    T value;
+
+    template<typename Ops> typename Ops::Vector load(size_t) const { return Ops::broadcast(value); }
+};
+
+template<typename T> struct ColumnOperand {
+    const T *values;
+
+    template<typename Ops> typename Ops::Vector load(size_t row) const { return Ops::load(values + row); }
+};
+
+// Every comparison is one of these, with its operands possibly swapped and
+// its result possibly negated.  Negating equality gives true for NaN, which
+// matches the != operator.
+enum class Test {
+    LessThan,
+    LessThanEqual,
+    Equal
+};
+
+template<Test kTest, bool kSwap, bool kNegate, typename Ops> static unsigned int test(typename Ops::Vector a, typename Ops::Vector b)
+{
+    if constexpr(kSwap) {
+        std::swap(a, b);
+    }
+
+    unsigned int mask;
+    if constexpr(kTest == Test::LessThan) {
+        mask = Ops::lessThan(a, b);
+    } else if constexpr(kTest == Test::LessThanEqual) {
+        mask = Ops::lessThanEqual(a, b);
+    } else {
+        mask = Ops::equal(a, b);
+    }
+
+    if constexpr(kNegate) {
+        mask = ~mask & ((1u << Ops::kLanes) - 1);
+    }
+    return mask;
+}
+
+// Whole words of the selection are filled a vector at a time, and the rows
+// left over at the end one at a time
+template<Test kTest, bool kSwap, bool kNegate, typename T, typename Right> static void run(const T *left, const Right &right, size_t count, uint64_t *selection)
+{
+    typedef VectorOps<T> Ops;
+    typedef ScalarOps<T> Scalar;
+
+    size_t row = 0;
+    for(; row + 64 <= count; row += 64) {
+        uint64_t word = 0;
+        for(unsigned int lane=0; lane<64; lane+=Ops::kLanes) {
+            uint64_t mask = test<kTest, kSwap, kNegate, Ops>(Ops::load(left + row + lane), right.template load<Ops>(row + lane));
+            word |= mask << lane;
+        }
+        selection[row / 64] = word;
+    }
+
+    if(row < count) {
+        uint64_t word = 0;
+        for(size_t i=row; i<count; i++) {
+            uint64_t bit = test<kTest, kSwap, kNegate, Scalar>(Scalar::load(left + i), right.template load<Scalar>(i));
+            word |= bit << (i - row);
+        }
+        selection[row / 64] = word;
+    }
+}
+
+template<typename T, typename Right> static void compareRows(CompareExpression::CompareType compareType, const T *left, const Right &right, size_t count, uint64_t *selection)
+{
+    switch(compareType) {
+        case CompareExpression::LessThan:
+            run<Test::LessThan, false, false>(left, right, count, selection);
+            break;
+        case CompareExpression::LessThanEqual:
+            run<Test::LessThanEqual, false, false>(left, right, count, selection);
+            break;
+        case CompareExpression::Equal:
+            run<Test::Equal, false, false>(left, right, count, selection);
+            break;
+        case CompareExpression::NotEqual:
+            run<Test::Equal, false, true>(left, right, count, selection);
+            break;
+        case CompareExpression::GreaterThanEqual:
+            run<Test::LessThanEqual, true, false>(left, right, count, selection);
+            break;
+        case CompareExpression::GreaterThan:
+            run<Test::LessThan, true, false>(left, right, count, selection);
+            break;
+    }
+}
+
+size_t FilterKernels::words(size_t rows)
+{
+    return (rows + 63) / 64;
+}
+
+void FilterKernels::compare(CompareExpression::CompareType compareType, const int *values, int constant, size_t count, uint64_t *selection)
+{
+    compareRows(compareType, values, ConstantOperand<int> {constant}, count, selection);
+}
+
+void FilterKernels::compare(CompareExpression::CompareType compareType, const float *values, float constant, size_t count, uint64_t *selection)
+{
+    compareRows(compareType, values, ConstantOperand<float> {constant}, count, selection);
+}
+
+void FilterKernels::compare(CompareExpression::CompareType compareType, const int *left, const int *right, size_t count, uint64_t *selection)
+{
+    compareRows(compareType, left, ColumnOperand<int> {right}, count, selection);
+}
+
+void FilterKernels::compare(CompareExpression::CompareType compareType, const float *left, const float *right, size_t count, uint64_t *selection)
+{
+    compareRows(compareType, left, ColumnOperand<float> {right}, count, selection);
+}
+
+void FilterKernels::pack(const uint8_t *booleans, size_t count, uint64_t *selection)
+{
+    for(size_t word=0; word<words(count); word++) {
+        uint64_t bits = 0;
+        size_t end = std::min<size_t>(64, count - word * 64);
+        for(size_t i=0; i<end; i++) {
+            bits |= uint64_t(booleans[word * 64 + i] != 0) << i;
+        }
+        selection[word] = bits;
+    }
+}
+
+void FilterKernels::maskNulls(const uint64_t *nulls, size_t words, uint64_t *selection, uint64_t *unknown)
+{
+    for(size_t word=0; word<words; word++) {
+        selection[word] &= ~nulls[word];
+        unknown[word] |= nulls[word];
+    }
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef FILTERKERNELS_HPP
+#define FILTERKERNELS_HPP
+
+#include "Expression.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Comparison kernels used to filter batches of rows.  Each one sets bit i of
+// selection, which holds 64 rows to a word, if the comparison holds for row
+// i, and clears it otherwise.  They are built with AVX2 when the compiler
+// targets it, with SSE2 on other x86 targets, and as plain loops elsewhere.
+class FilterKernels {
+public:
+    static size_t words(size_t rows);
+
+    static void compare(CompareExpression::CompareType compareType, const int *values, int constant, size_t count, uint64_t *selection);
+    static void compare(CompareExpression::CompareType compareType, const float *values, float constant, size_t count, uint64_t *selection);
+    static void compare(CompareExpression::CompareType compareType, const int *left, const int *right, size_t count, uint64_t *selection);
+    static void compare(CompareExpression::CompareType compareType, const float *left, const float *right, size_t count, uint64_t *selection);
+
+    // Sets the bit of each row whose entry in booleans is non-zero
+    static void pack(const uint8_t *booleans, size_t count, uint64_t *selection);
+
+    // Moves the rows set in the first words words of nulls from selection to
+    // unknown, since a comparison with NULL is neither true nor false
+    static void maskNulls(const uint64_t *nulls, size_t words, uint64_t *selection, uint64_t *unknown);
+};
+
+#endif
\ No newline at end of file
@@ -1,25 +1,25 @@
 #include "Index.hpp"
 
+#include <algorithm>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+
 class IndexKeyDefinition : public BTree::KeyDefinition {
 public:
     IndexKeyDefinition(Record::Schema &schema) : mSchema(schema) {}
 
     virtual BTreePage::Size fixedSize() override { return 0; }
     virtual int compare(BTree::Key a, BTree::Key b) override {
-        Record::Reader readerA(mSchema, a.data);
-        Record::Reader readerB(mSchema, b.data);
-        for(int i=0; i<mSchema.fields.size(); i++) {
-            Value valueA = readerA.readField(i);
-            Value valueB = readerB.readField(i);
-
-            if(valueA < valueB) return -1;
-            if(valueA > valueB) return 1;
-        }
-        return 0;
+        // Keys are in the order-preserving encoding, followed by the row id,
+        // and no complete key is a prefix of a different one
+        return BTreePage::BytesKeyComparator()(a, b);
     }
 
+    virtual ComparatorKind comparatorKind() override { return ComparatorKind::Bytes; }
+
     virtual void print(BTree::Key key) override {
-        Record::Reader reader(mSchema, key.data);
+        Record::KeyReader reader(mSchema, key.data);
         reader.print();
     }
 
@@ -37,13 +37,28 @@ public:
     }
 };
 
+// Stored keys end in the row id, big-endian, which makes every entry unique
+// and orders duplicate keys by row id
+static void appendRowId(std::vector<uint8_t> &data, Table::RowId rowId)
+{
+    for(int shift=8 * (sizeof(rowId) - 1); shift>=0; shift-=8) {
+        data.push_back(uint8_t(rowId >> shift));
+    }
+}
+
 class RecordKey {
 public:
-    RecordKey(Record::Writer &writer) {
+    RecordKey(Record::KeyWriter &writer) {
         mData.resize(writer.dataSize());
         writer.write(mData.data());
     }
 
+    RecordKey(Record::KeyWriter &writer, Table::RowId rowId)
+    : RecordKey(writer)
+    {
+        appendRowId(mData, rowId);
+    }
+
     operator BTree::Key() {
         return BTree::Key(mData.data(), mData.size());
     }
@@ -61,9 +76,244 @@ Index::Index(Page &rootPage, Table &table, std::vector<unsigned int> keys)
     }
 
     mTree = std::make_unique<BTree>(rootPage.pageSet(), rootPage.index(), std::make_unique<IndexKeyDefinition>(mKeySchema), std::make_unique<RowIdDataDefinition>());
+}
+
+Index::Loader::Loader(Index &index, double fillFactor)
+: mIndex(index)
+, mFillFactor(fillFactor)
+{
+}
+
+Index::Loader::~Loader()
+{
+    for(std::FILE *run : mRuns) {
+        std::fclose(run);
+    }
+}
+
+void Index::Loader::add(Table::RowId rowId, Record::Writer &writer)
+{
+    Record::KeyWriter keyWriter(mIndex.mKeySchema);
+    for(unsigned int i=0; i<mIndex.mKeys.size(); i++) {
+        keyWriter.setField(i, writer.field(mIndex.mKeys[i]));
+    }
+
+    RecordKey key(keyWriter);
+    BTree::Key k = key;
+    addKey(rowId, k.data, k.size);
+}
+
+void Index::Loader::addKey(Table::RowId rowId, const void *key, BTreePage::Size size)
+{
+    Entry entry;
+    entry.offset = mKeyData.size();
+    entry.size = size;
+    entry.rowId = rowId;
+    mKeyData.insert(mKeyData.end(), reinterpret_cast<const uint8_t*>(key), reinterpret_cast<const uint8_t*>(key) + size);
+    appendRowId(mKeyData, rowId);
+    entry.size += sizeof(Table::RowId);
+    mEntries.push_back(entry);
+
+    if(mKeyData.size() >= kSortMemory) {
+        spillRun();
+    }
+}
+
+void Index::Loader::sortEntries()
+{
+    // Keys end in their row ids, so no two compare equal
+    IndexKeyDefinition keyDefinition(mIndex.mKeySchema);
+    std::sort(mEntries.begin(), mEntries.end(), [&](const Entry &a, const Entry &b) {
+        return keyDefinition.compare(BTree::Key(mKeyData.data() + a.offset, a.size), BTree::Key(mKeyData.data() + b.offset, b.size)) < 0;
+    });
+}
+
+void Index::Loader::spillRun()
+{
+    sortEntries();
+
+    std::FILE *run = std::tmpfile();
+    if(!run) {
+        throw std::runtime_error("Unable to create temporary file for index build");
+    }
+    mRuns.push_back(run);
+
+    for(Entry &entry : mEntries) {
+        std::fwrite(&entry.size, sizeof(entry.size), 1, run);
+        std::fwrite(&entry.rowId, sizeof(entry.rowId), 1, run);
+        std::fwrite(mKeyData.data() + entry.offset, 1, entry.size, run);
+    }
+    if(std::ferror(run)) {
+        throw std::runtime_error("Unable to write temporary file for index build");
+    }
+    std::rewind(run);
+
+    mKeyData.clear();
+    mEntries.clear();
+}
+
+void Index::Loader::finish()
+{
+    std::unique_ptr<BTree::Builder> builder;
+    if(mIndex.mTree->empty()) {
+        builder = std::make_unique<BTree::Builder>(*mIndex.mTree, mFillFactor);
+    }
+
+    auto insert = [&](BTree::Key key, Table::RowId rowId) {
+        void *data;
+        if(builder) {
+            data = builder->add(key, sizeof(Table::RowId));
+        } else {
+            Pointer pointer = mIndex.mTree->add(key, sizeof(Table::RowId));
+            data = mIndex.mTree->data(pointer);
+        }
+        std::memcpy(data, &rowId, sizeof(rowId));
+    };
+
+    if(mRuns.empty()) {
+        sortEntries();
+        for(Entry &entry : mEntries) {
+            insert(BTree::Key(mKeyData.data() + entry.offset, entry.size), entry.rowId);
+        }
+    } else {
+        if(!mEntries.empty()) {
+            spillRun();
+        }
+
+        struct RunEntry {
+            std::vector<uint8_t> key;
+            Table::RowId rowId;
+        };
+
+        std::vector<RunEntry> heads(mRuns.size());
+        auto readHead = [&](size_t run) {
+            BTreePage::Size size;
+            if(std::fread(&size, sizeof(size), 1, mRuns[run]) != 1) {
+                return false;
+            }
+            heads[run].key.resize(size);
+            std::fread(&heads[run].rowId, sizeof(Table::RowId), 1, mRuns[run]);
+            std::fread(heads[run].key.data(), 1, size, mRuns[run]);
+            return true;
+        };
+
+        IndexKeyDefinition keyDefinition(mIndex.mKeySchema);
+        auto greater = [&](size_t a, size_t b) {
+            return keyDefinition.compare(BTree::Key(heads[a].key.data(), heads[a].key.size()), BTree::Key(heads[b].key.data(), heads[b].key.size())) > 0;
+        };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> queue(greater);
+        for(size_t run=0; run<mRuns.size(); run++) {
+            if(readHead(run)) {
+                queue.push(run);
+            }
+        }
+
+        while(!queue.empty()) {
+            size_t run = queue.top();
+            queue.pop();
+            insert(BTree::Key(heads[run].key.data(), heads[run].key.size()), heads[run].rowId);
+            if(readHead(run)) {
+                queue.push(run);
+            }
+        }
+
+        for(std::FILE *run : mRuns) {
+            std::fclose(run);
+        }
+        mRuns.clear();
+    }
+
+    if(builder) {
+        builder->finish();
+    }
+
+    mKeyData.clear();
+    mEntries.clear();
+}
+
+void Index::initialize()
+{
     mTree->initialize();
 }
 
+void Index::backfill()
+{
+    // Rows are copied out of the table a batch at a time on this thread,
+    // since page access is not thread-safe.  Keys for each batch are then
+    // extracted in parallel, one contiguous slice per thread, and handed to
+    // the loader in row id order.
+    const size_t kRowsPerThread = 4096;
+    size_t numThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+    struct Slice {
+        std::vector<uint8_t> keyData;
+        std::vector<std::pair<Table::RowId, BTreePage::Size>> keys;
+    };
+
+    Loader loader(*this);
+    std::vector<uint8_t> rowData;
+    std::vector<std::pair<Table::RowId, size_t>> rows;
+    std::vector<Slice> slices(numThreads);
+
+    auto extract = [&](Slice &slice, size_t begin, size_t end) {
+        slice.keyData.clear();
+        slice.keys.clear();
+        for(size_t i=begin; i<end; i++) {
+            Record::Reader reader(mTable.schema(), rowData.data() + rows[i].second);
+            Record::KeyWriter keyWriter(mKeySchema);
+            for(unsigned int j=0; j<mKeys.size(); j++) {
+                keyWriter.setField(j, reader.readField(mKeys[j]));
+            }
+
+            size_t offset = slice.keyData.size();
+            slice.keyData.resize(offset + keyWriter.dataSize());
+            keyWriter.write(slice.keyData.data() + offset);
+            slice.keys.push_back({rows[i].first, BTreePage::Size(slice.keyData.size() - offset)});
+        }
+    };
+
+    auto flushBatch = [&]() {
+        size_t used = std::min(numThreads, (rows.size() + kRowsPerThread - 1) / kRowsPerThread);
+        size_t perThread = (rows.size() + used - 1) / std::max<size_t>(used, 1);
+        std::vector<std::thread> threads;
+        for(size_t t=1; t<used; t++) {
+            threads.emplace_back(extract, std::ref(slices[t]), t * perThread, std::min(rows.size(), (t + 1) * perThread));
+        }
+        if(used > 0) {
+            extract(slices[0], 0, std::min(rows.size(), perThread));
+        }
+        for(std::thread &thread : threads) {
+            thread.join();
+        }
+
+        for(size_t t=0; t<used; t++) {
+            size_t offset = 0;
+            for(auto &[rowId, size] : slices[t].keys) {
+                loader.addKey(rowId, slices[t].keyData.data() + offset, size);
+                offset += size;
+            }
+        }
+
+        rowData.clear();
+        rows.clear();
+    };
+
+    for(Pointer pointer = mTable.first(); pointer.valid(); mTable.moveNext(pointer)) {
+        BTreePage::Size size = mTable.dataSize(pointer);
+        size_t offset = rowData.size();
+        rowData.resize(offset + size);
+        std::memcpy(rowData.data() + offset, mTable.data(pointer), size);
+        rows.push_back({mTable.getRowId(pointer), offset});
+
+        if(rows.size() >= numThreads * kRowsPerThread) {
+            flushBatch();
+        }
+    }
+    flushBatch();
+
+    loader.finish();
+}
+
 Table &Index::table()
 {
     return mTable;
@@ -76,11 +326,11 @@ Record::Schema &Index::keySchema()
 
 void Index::add(Table::RowId rowId, Record::Writer &writer)
 {
-    Record::Writer keyWriter(mKeySchema);
+    Record::KeyWriter keyWriter(mKeySchema);
     for(unsigned int i=0; i<mKeys.size(); i++) {
         keyWriter.setField(i, writer.field(mKeys[i]));
     }
-    RecordKey key(keyWriter);
+    RecordKey key(keyWriter, rowId);
     Pointer pointer = mTree->add(key, sizeof(Table::RowId));
     void *data = mTree->data(pointer);
     std::memcpy(data, &rowId, sizeof(rowId));
@@ -88,23 +338,24 @@ void Index::add(Table::RowId rowId, Record::Writer &writer)
 
 void Index::modify(Table::RowId rowId, Record::Writer &writer)
 {
-    Pointer tablePointer = mTable.lookup(rowId);
-    void *data = mTable.data(tablePointer);
-    Record::Reader reader(mTable.schema(), data);
-
-    Record::Writer keyWriter(mKeySchema);
+    Record::Reader reader(mTable.schema(), mTable.data(mTable.lookup(rowId)));
+    Record::KeyWriter oldKeyWriter(mKeySchema);
+    Record::KeyWriter newKeyWriter(mKeySchema);
     for(unsigned int i=0; i<mKeys.size(); i++) {
-        keyWriter.setField(i, reader.readField(mKeys[i]));
+        oldKeyWriter.setField(i, reader.readField(mKeys[i]));
+        newKeyWriter.setField(i, writer.field(mKeys[i]));
     }
-    RecordKey key(keyWriter);
-    Pointer indexPointer = mTree->lookup(key, BTree::SearchComparison::Equal, BTree::SearchPosition::First);
-    mTree->remove(indexPointer);
+    RecordKey oldKey(oldKeyWriter, rowId);
+    RecordKey newKey(newKeyWriter, rowId);
 
-    Record::Writer newKeyWriter(mKeySchema);
-    for(unsigned int i=0; i<mKeys.size(); i++) {
-        newKeyWriter.setField(i, writer.field(mKeys[i]));
+    // An unchanged key leaves the entry where it is, so that iterators
+    // positioned on it remain valid
+    if(BTreePage::BytesKeyComparator()(oldKey, newKey) == 0) {
+        return;
     }
-    RecordKey newKey(newKeyWriter);
+
+    Pointer indexPointer = mTree->lookup(oldKey, BTree::SearchComparison::Equal, BTree::SearchPosition::First);
+    mTree->remove(indexPointer);
     Pointer newPointer = mTree->add(newKey, sizeof(Table::RowId));
     void *newData = mTree->data(newPointer);
     std::memcpy(newData, &rowId, sizeof(rowId));
@@ -112,16 +363,7 @@ void Index::modify(Table::RowId rowId, Record::Writer &writer)
 
 void Index::remove(Table::RowId rowId, std::span<Pointer*> trackPointers)
 {
-    Pointer tablePointer = mTable.lookup(rowId);
-    void *data = mTable.data(tablePointer);
-    Record::Reader reader(mTable.schema(), data);
-
-    Record::Writer keyWriter(mKeySchema);
-    for(unsigned int i=0; i<mKeys.size(); i++) {
-        keyWriter.setField(i, reader.readField(mKeys[i]));
-    }
-    RecordKey key(keyWriter);
-    Pointer indexPointer = mTree->lookup(key, BTree::SearchComparison::Equal, BTree::SearchPosition::First);
+    Pointer indexPointer = find(rowId);
     mTree->remove(indexPointer, trackPointers);
 }
 
@@ -145,11 +387,31 @@ bool Index::movePrev(Pointer &pointer)
     return mTree->movePrev(pointer);
 }
 
+int Index::compare(Pointer a, Pointer b)
+{
+    return mTree->compare(a, b);
+}
+
 Table::RowId Index::rowId(Pointer pointer)
 {
     return *reinterpret_cast<Table::RowId*>(mTree->data(pointer));
 }
 
+Page::Index Index::rootIndex()
+{
+    return mTree->rootIndex();
+}
+
+void Index::relocatePages(Page::Index limit, std::vector<Page::Index> &oldPages)
+{
+    mTree->relocatePages(limit, oldPages);
+}
+
+BTree::SpaceStats Index::spaceStats()
+{
+    return mTree->spaceStats();
+}
+
 void Index::print()
 {
     mTree->print();
@@ -157,14 +419,14 @@ void Index::print()
 
 Index::Pointer Index::lookup(Limit &limit)
 {
-    BTree::KeyComparator comparator = [&](BTree::Key a, BTree::Key b) {
-        return partialKeyCompare(a, b, limit.values.size());
-    };
+    // The encoding of the leading fields of a key is a prefix of the whole
+    // key, so keys which match on the fields of the limit compare equal
+    BTree::PrefixKeyComparator comparator;
     Record::Schema schema;
     for(int i=0; i<limit.values.size(); i++) {
         schema.fields.push_back(keySchema().fields[i]);
     }
-    Record::Writer keyWriter(schema);
+    Record::KeyWriter keyWriter(schema);
     for(int i=0; i<limit.values.size(); i++) {
         keyWriter.setField(i, limit.values[i]);
     }
@@ -172,16 +434,17 @@ Index::Pointer Index::lookup(Limit &limit)
     return mTree->lookup(key, comparator, limit.comparison, limit.position);
 }
 
-int Index::partialKeyCompare(BTree::Key a, BTree::Key b, int numFields)
+Index::Pointer Index::find(Table::RowId rowId)
 {
-    Record::Reader readerA(keySchema(), a.data);
-    Record::Reader readerB(keySchema(), b.data);
-    for(int i=0; i<numFields; i++) {
-        Value valueA = readerA.readField(i);
-        Value valueB = readerB.readField(i);
+    Pointer tablePointer = mTable.lookup(rowId);
+    void *data = mTable.data(tablePointer);
+    Record::Reader reader(mTable.schema(), data);
 
-        if(valueA < valueB) return -1;
-        if(valueA > valueB) return 1;
+    Record::KeyWriter keyWriter(mKeySchema);
+    for(unsigned int i=0; i<mKeys.size(); i++) {
+        keyWriter.setField(i, reader.readField(mKeys[i]));
     }
-    return 0;
-}
+    RecordKey key(keyWriter, rowId);
+
+    return mTree->lookup(key, BTree::SearchComparison::Equal, BTree::SearchPosition::First);
+}
\ No newline at end of file
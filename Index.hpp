@@ -8,6 +8,7 @@
 #include <vector>
 #include <memory>
 #include <span>
+#include <cstdio>
 
 class Index {
 public:
@@ -15,6 +16,42 @@ public:
 
     typedef BTree::Pointer Pointer;
 
+    // Collects index entries for a bulk load, then sorts them once and builds
+    // the index tree bottom-up.  If the index already has entries they are
+    // added one at a time instead, in sorted order.  Once the buffered keys
+    // outgrow kSortMemory they are sorted and spilled to a temporary file as a
+    // run, and finish() merges the runs.
+    class Loader {
+    public:
+        Loader(Index &index, double fillFactor = BTree::kDefaultFillFactor);
+        ~Loader();
+
+        void add(Table::RowId rowId, Record::Writer &writer);
+        void addKey(Table::RowId rowId, const void *key, BTreePage::Size size);
+        void finish();
+
+    private:
+        static const size_t kSortMemory = 64 * 1024 * 1024;
+
+        struct Entry {
+            size_t offset;
+            BTreePage::Size size;
+            Table::RowId rowId;
+        };
+
+        void sortEntries();
+        void spillRun();
+
+        Index &mIndex;
+        double mFillFactor;
+        std::vector<uint8_t> mKeyData;
+        std::vector<Entry> mEntries;
+        std::vector<std::FILE*> mRuns;
+    };
+
+    void initialize();
+    void backfill();
+
     struct Limit {
         BTree::SearchComparison comparison;
         BTree::SearchPosition position;
@@ -35,12 +72,18 @@ public:
     bool movePrev(Pointer &pointer);
 
     Pointer lookup(Limit &limit);
+    int compare(Pointer a, Pointer b);
     Table::RowId rowId(Pointer pointer);
 
+    Page::Index rootIndex();
+    void relocatePages(Page::Index limit, std::vector<Page::Index> &oldPages);
+
+    BTree::SpaceStats spaceStats();
+
     void print();
 
 private:
-    int partialKeyCompare(BTree::Key a, BTree::Key b, int numFields);
+    Pointer find(Table::RowId rowId);
 
     Table &mTable;
     std::vector<unsigned int> mKeys;
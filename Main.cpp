@@ -54,8 +54,8 @@ void printIterator(RowIterator &iterator)
                 std::cout.width(widths[j]);
                 std::cout << i;
             } else {
-                Value value = iterator.getField(j - 1);
-                value.print(widths[j]);
+                Value storage;
+                iterator.getFieldRef(j - 1, storage).print(widths[j]);
             }
             std::cout << " |";
         }
@@ -1,11 +1,283 @@
 #include "Optimizer.hpp"
 
+#include <algorithm>
+
+// Constants and parameters do not read any fields
+class ValueContext : public Expression::EvaluateContext {
+public:
+    Value fieldValue(unsigned int) override { return Value(0); }
+};
+
 Optimizer::Optimizer(Database &database)
 : mDatabase(database)
 {
 }
 
-void Optimizer::optimize(Database::Query &query)
+void Optimizer::optimize(Database::Query &query, const std::vector<std::string> &modifiedColumns)
+{
+    if(!std::holds_alternative<Database::Query::Table>(query.source) || !query.predicate) {
+        return;
+    }
+
+    std::string tableName = std::get<Database::Query::Table>(query.source).name;
+    Table &table = mDatabase.findTable(tableName);
+
+    std::vector<std::unique_ptr<Expression>> conjuncts;
+    splitConjuncts(std::move(query.predicate), conjuncts);
+
+    std::vector<Term> terms;
+    for(unsigned int i=0; i<conjuncts.size(); i++) {
+        if(auto term = matchTerm(*conjuncts[i], i, table.schema())) {
+            terms.push_back(*term);
+        }
+    }
+
+    std::optional<Plan> bestPlan = choosePlan(table, terms, modifiedColumns);
+
+    std::vector<Term> genericTerms = terms;
+    for(Term &term : genericTerms) {
+        if(term.literal) {
+            term.value.reset();
+        }
+    }
+    std::optional<Plan> genericPlan = choosePlan(table, genericTerms, modifiedColumns);
+    auto samePlan = [](std::optional<Plan> &a, std::optional<Plan> &b) {
+        if(!a || !b) {
+            return !a && !b;
+        }
+        return a->indexName == b->indexName && a->equalTerms == b->equalTerms && a->lowerTerm == b->lowerTerm && a->upperTerm == b->upperTerm;
+    };
+    query.literalDependent = !samePlan(bestPlan, genericPlan);
+
+    std::vector<bool> used(conjuncts.size(), false);
+    if(bestPlan) {
+        Database::Query::Index source;
+        source.name = bestPlan->indexName;
+        source.tableName = tableName;
+
+        std::vector<std::shared_ptr<Expression>> equalValues;
+        for(unsigned int term : bestPlan->equalTerms) {
+            equalValues.push_back(takeValue(conjuncts[terms[term].conjunct]));
+            used[terms[term].conjunct] = true;
+        }
+
+        // NULL keys sort first and never satisfy a comparison, so a range
+        // with only an upper bound starts after them
+        if(bestPlan->lowerTerm || bestPlan->upperTerm || !equalValues.empty()) {
+            RowIterators::IndexIterator::Limit limit = {BTree::SearchComparison::GreaterThanEqual, BTree::SearchPosition::First, equalValues};
+            if(bestPlan->lowerTerm) {
+                Term &term = terms[*bestPlan->lowerTerm];
+                if(term.comparison == CompareExpression::GreaterThan) {
+                    limit.comparison = BTree::SearchComparison::GreaterThan;
+                }
+                limit.values.push_back(takeValue(conjuncts[term.conjunct]));
+                used[term.conjunct] = true;
+            } else if(bestPlan->upperTerm) {
+                limit.comparison = BTree::SearchComparison::GreaterThan;
+                limit.values.push_back(std::make_shared<ConstantExpression>(Value::null()));
+            }
+            source.startLimit = std::move(limit);
+        }
+
+        if(bestPlan->upperTerm || !equalValues.empty()) {
+            RowIterators::IndexIterator::Limit limit = {BTree::SearchComparison::LessThanEqual, BTree::SearchPosition::Last, equalValues};
+            if(bestPlan->upperTerm) {
+                Term &term = terms[*bestPlan->upperTerm];
+                if(term.comparison == CompareExpression::LessThan) {
+                    limit.comparison = BTree::SearchComparison::LessThan;
+                }
+                limit.values.push_back(takeValue(conjuncts[term.conjunct]));
+                used[term.conjunct] = true;
+            }
+            source.endLimit = std::move(limit);
+        }
+
+        query.source = std::move(source);
+    }
+
+    // Whatever the index does not cover is still checked against each row
+    for(unsigned int i=0; i<conjuncts.size(); i++) {
+        if(used[i]) {
+            continue;
+        }
+
+        if(query.predicate) {
+            query.predicate = std::make_unique<LogicalExpression>(LogicalExpression::And, std::move(query.predicate), std::move(conjuncts[i]));
+        } else {
+            query.predicate = std::move(conjuncts[i]);
+        }
+    }
+}
+
+std::optional<Optimizer::Plan> Optimizer::choosePlan(Table &table, std::vector<Term> &terms, const std::vector<std::string> &modifiedColumns)
+{
+    // A table scan reads every row once
+    double rows = table.statistics().valid() ? table.statistics().rowCount() : kDefaultRowCount;
+    std::optional<Plan> bestPlan;
+    double bestCost = rows;
+    for(auto &[name, index] : mDatabase.mIndices) {
+        if(&index->table() != &table) {
+            continue;
+        }
+
+        bool modified = std::any_of(index->keySchema().fields.begin(), index->keySchema().fields.end(), [&](auto &field) {
+            return std::find(modifiedColumns.begin(), modifiedColumns.end(), field.name) != modifiedColumns.end();
+        });
+        if(modified) {
+            continue;
+        }
+
+        std::optional<Plan> plan = planIndex(name, *index, terms, rows);
+        if(plan && plan->cost < bestCost) {
+            bestCost = plan->cost;
+            bestPlan = std::move(plan);
+        }
+    }
+
+    return bestPlan;
+}
+
+void Optimizer::splitConjuncts(std::unique_ptr<Expression> expression, std::vector<std::unique_ptr<Expression>> &conjuncts)
+{
+    LogicalExpression *logical = dynamic_cast<LogicalExpression*>(expression.get());
+    if(logical && logical->logicalType() == LogicalExpression::And) {
+        splitConjuncts(std::move(logical->leftOperand()), conjuncts);
+        splitConjuncts(std::move(logical->rightOperand()), conjuncts);
+    } else {
+        conjuncts.push_back(std::move(expression));
+    }
+}
+
+std::optional<Optimizer::Term> Optimizer::matchTerm(Expression &expression, unsigned int conjunct, Record::Schema &schema)
+{
+    CompareExpression *compare = dynamic_cast<CompareExpression*>(&expression);
+    if(!compare || compare->compareType() == CompareExpression::NotEqual) {
+        return std::nullopt;
+    }
+
+    auto isValue = [](Expression &operand) {
+        return dynamic_cast<ConstantExpression*>(&operand) || dynamic_cast<ParameterExpression*>(&operand);
+    };
+
+    Term term;
+    term.conjunct = conjunct;
+    term.comparison = compare->compareType();
+
+    FieldExpression *field = dynamic_cast<FieldExpression*>(compare->leftOperand().get());
+    Expression *value = compare->rightOperand().get();
+    if(!field || !isValue(*value)) {
+        field = dynamic_cast<FieldExpression*>(compare->rightOperand().get());
+        value = compare->leftOperand().get();
+        if(!field || !isValue(*value)) {
+            return std::nullopt;
+        }
+
+        switch(term.comparison) {
+            case CompareExpression::LessThan: term.comparison = CompareExpression::GreaterThan; break;
+            case CompareExpression::LessThanEqual: term.comparison = CompareExpression::GreaterThanEqual; break;
+            case CompareExpression::GreaterThanEqual: term.comparison = CompareExpression::LessThanEqual; break;
+            case CompareExpression::GreaterThan: term.comparison = CompareExpression::LessThan; break;
+            default: break;
+        }
+    }
+
+    // Keys are encoded by type, so a value of another type cannot be used
+    // as a limit.  Parameters written as ? are assumed to match their column.
+    int fieldIndex = schema.fieldIndex(field->name());
+    if(fieldIndex == -1) {
+        return std::nullopt;
+    }
+    ParameterExpression *parameter = dynamic_cast<ParameterExpression*>(value);
+    if((!parameter || parameter->typed()) && value->type() != schema.fields[fieldIndex].type) {
+        return std::nullopt;
+    }
+
+    term.column = field->name();
+    term.field = fieldIndex;
+    term.literal = parameter && parameter->typed();
+    if(!parameter || parameter->typed()) {
+        ValueContext context;
+        term.value = value->evaluate(context);
+    }
+    return term;
+}
+
+std::optional<Optimizer::Plan> Optimizer::planIndex(const std::string &name, Index &index, std::vector<Term> &terms, double rows)
+{
+    Plan plan;
+    plan.indexName = name;
+
+    Statistics &statistics = index.table().statistics();
+
+    double selectivity = 1.0;
+    for(auto &field : index.keySchema().fields) {
+        auto equal = std::find_if(terms.begin(), terms.end(), [&](Term &term) {
+            return term.column == field.name && term.comparison == CompareExpression::Equal;
+        });
+        if(equal != terms.end()) {
+            plan.equalTerms.push_back(equal - terms.begin());
+            selectivity *= statistics.valid() ? statistics.equalSelectivity(equal->field, equal->value) : kEqualitySelectivity;
+            continue;
+        }
+
+        for(unsigned int i=0; i<terms.size(); i++) {
+            if(terms[i].column != field.name) {
+                continue;
+            }
+
+            switch(terms[i].comparison) {
+                case CompareExpression::GreaterThan:
+                case CompareExpression::GreaterThanEqual:
+                    if(!plan.lowerTerm) plan.lowerTerm = i;
+                    break;
+                case CompareExpression::LessThan:
+                case CompareExpression::LessThanEqual:
+                    if(!plan.upperTerm) plan.upperTerm = i;
+                    break;
+                default:
+                    break;
+            }
+        }
+        selectivity *= rangeSelectivity(statistics, terms, plan);
+        break;
+    }
+
+    if(plan.equalTerms.empty() && !plan.lowerTerm && !plan.upperTerm) {
+        return std::nullopt;
+    }
+
+    plan.cost = kIndexLookupCost + rows * selectivity * kIndexRowCost;
+    return plan;
+}
+
+double Optimizer::rangeSelectivity(Statistics &statistics, std::vector<Term> &terms, Plan &plan)
+{
+    Term *lower = plan.lowerTerm ? &terms[*plan.lowerTerm] : nullptr;
+    Term *upper = plan.upperTerm ? &terms[*plan.upperTerm] : nullptr;
+    if(!lower && !upper) {
+        return 1.0;
+    }
+
+    if(statistics.valid() && (!lower || lower->value) && (!upper || upper->value)) {
+        unsigned int field = lower ? lower->field : upper->field;
+        std::optional<double> selectivity = statistics.rangeSelectivity(field, lower ? lower->value : std::optional<Value>(), upper ? upper->value : std::optional<Value>());
+        if(selectivity) {
+            return *selectivity;
+        }
+    }
+
+    double selectivity = 1.0;
+    if(lower) selectivity *= kRangeSelectivity;
+    if(upper) selectivity *= kRangeSelectivity;
+    return selectivity;
+}
+
+std::unique_ptr<Expression> Optimizer::takeValue(std::unique_ptr<Expression> &conjunct)
 {
-    
+    CompareExpression &compare = static_cast<CompareExpression&>(*conjunct);
+    if(dynamic_cast<FieldExpression*>(compare.leftOperand().get())) {
+        return std::move(compare.rightOperand());
+    } else {
+        return std::move(compare.leftOperand());
+    }
 }
\ No newline at end of file
@@ -3,13 +3,63 @@
 
 #include "Database.hpp"
 
+// Chooses how the rows of a query are read.  Comparisons in the predicate
+// between a column and a constant or parameter are matched against the key
+// columns of each index on the table: equalities on a prefix of the key,
+// optionally followed by a range on the next key column, become the limits
+// of an index scan.  The cheapest index is used if it is estimated to beat a
+// table scan, and the comparisons it does not cover are kept as the
+// predicate.
+//
+// The share of rows a comparison selects is estimated from the table's
+// statistics where it has them, and from fixed guesses otherwise.  Literals
+// turned into parameters for the plan cache are estimated by their values,
+// and the query is marked as depending on them if the plan differs from the
+// one chosen without knowing them.
 class Optimizer {
 public:
     Optimizer(Database &database);
 
-    void optimize(Database::Query &query);
+    // Indexes keyed on any of modifiedColumns are not used, since rows would
+    // move within the scan as they are updated
+    void optimize(Database::Query &query, const std::vector<std::string> &modifiedColumns = {});
 
 private:
+    // Costs are relative to reading one row in a table scan
+    static constexpr double kIndexRowCost = 3.0;
+    static constexpr double kIndexLookupCost = 4.0;
+
+    // Used for tables without statistics
+    static constexpr double kDefaultRowCount = 1000.0;
+    static constexpr double kEqualitySelectivity = 0.1;
+    static constexpr double kRangeSelectivity = 1.0 / 3.0;
+
+    // A comparison of a column against a value, with the column on the left.
+    // The value is known if it is a constant or stands in for a literal.
+    struct Term {
+        std::string column;
+        unsigned int field;
+        CompareExpression::CompareType comparison;
+        std::optional<Value> value;
+        bool literal;
+        unsigned int conjunct;
+    };
+
+    struct Plan {
+        std::string indexName;
+        double cost;
+        std::vector<unsigned int> equalTerms;
+        std::optional<unsigned int> lowerTerm;
+        std::optional<unsigned int> upperTerm;
+    };
+
+    std::optional<Plan> choosePlan(Table &table, std::vector<Term> &terms, const std::vector<std::string> &modifiedColumns);
+    void splitConjuncts(std::unique_ptr<Expression> expression, std::vector<std::unique_ptr<Expression>> &conjuncts);
+    std::optional<Term> matchTerm(Expression &expression, unsigned int conjunct, Record::Schema &schema);
+    std::optional<Plan> planIndex(const std::string &name, Index &index, std::vector<Term> &terms, double rows);
+    double rangeSelectivity(Statistics &statistics, std::vector<Term> &terms, Plan &plan);
+    std::unique_ptr<Expression> takeValue(std::unique_ptr<Expression> &conjunct);
+
     Database &mDatabase;
 };
 
@@ -1,9 +1,25 @@
 #include "Page.hpp"
 
 Page::Page(PageSet &pageSet, size_t size, Index index)
- : mPageSet(pageSet), mData(size)
+ : mPageSet(pageSet), mStorage(size)
 {
+    mData = mStorage.data();
+    mSize = size;
     mIndex = index;
+    mPinCount = 0;
+    mDirty = false;
+}
+
+// A page constructed over external memory does not own its data; the
+// caller must keep it valid for the lifetime of the page
+Page::Page(PageSet &pageSet, uint8_t *data, size_t size, Index index)
+ : mPageSet(pageSet)
+{
+    mData = data;
+    mSize = size;
+    mIndex = index;
+    mPinCount = 0;
+    mDirty = false;
 }
 
 PageSet &Page::pageSet() const
@@ -13,19 +29,49 @@ PageSet &Page::pageSet() const
 
 size_t Page::size() const
 {
-    return mData.size();
+    return mSize;
 }
 Page::Index Page::index() const
 {
     return mIndex;
 }
 
+void Page::setIndex(Index index)
+{
+    mIndex = index;
+}
+
 uint8_t *Page::data(size_t offset)
 {
-    return mData.data() + offset;
+    return mData + offset;
 }
 
 const uint8_t *Page::data(size_t offset) const
 {
-    return mData.data() + offset;
+    return mData + offset;
+}
+
+void Page::pin()
+{
+    mPinCount++;
+}
+
+void Page::unpin()
+{
+    mPinCount--;
+}
+
+unsigned int Page::pinCount() const
+{
+    return mPinCount;
+}
+
+bool Page::dirty() const
+{
+    return mDirty;
+}
+
+void Page::setDirty(bool dirty)
+{
+    mDirty = dirty;
 }
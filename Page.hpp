@@ -6,22 +6,36 @@
 class PageSet;
 class Page {
 public:
-    typedef size_t Index;
-    static const Index kInvalidIndex = SIZE_MAX;
+    // Fixed width, since page indexes are stored in pages
+    typedef uint64_t Index;
+    static const Index kInvalidIndex = UINT64_MAX;
 
     Page(PageSet &pageSet, size_t size, Index index);
+    Page(PageSet &pageSet, uint8_t *data, size_t size, Index index);
 
     PageSet &pageSet() const;
     size_t size() const;
     Index index() const;
+    void setIndex(Index index);
 
     uint8_t *data(size_t offset = 0);
     const uint8_t *data(size_t offset = 0) const;
 
+    void pin();
+    void unpin();
+    unsigned int pinCount() const;
+
+    bool dirty() const;
+    void setDirty(bool dirty);
+
 private:
     PageSet &mPageSet;
-    std::vector<uint8_t> mData;
+    std::vector<uint8_t> mStorage;
+    uint8_t *mData;
+    size_t mSize;
     Index mIndex;
+    unsigned int mPinCount;
+    bool mDirty;
 };
 
 #endif
\ No newline at end of file
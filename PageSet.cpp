@@ -1,19 +1,158 @@
 #include "PageSet.hpp"
 
-static const size_t kPageSize = 256;
+#include <algorithm>
 
-Page &PageSet::page(Page::Index index)
-{ 
-    return *mPages[index];
+bool PageSet::validPageSize(size_t pageSize)
+{
+    bool powerOfTwo = (pageSize & (pageSize - 1)) == 0;
+
+    return powerOfTwo && pageSize >= kMinPageSize && pageSize <= kMaxPageSize;
+}
+
+size_t PageSet::pageSize()
+{
+    return page(kHeaderIndex).size();
 }
 
 Page &PageSet::addPage()
 {
-    mPages.push_back(std::make_unique<Page>(*this, kPageSize, mPages.size()));
+    Page::Index freeIndex = header().freeListHead;
+    if(freeIndex != Page::kInvalidIndex) {
+        Page &freePage = page(freeIndex);
+        header().freeListHead = *reinterpret_cast<Page::Index*>(freePage.data());
+        header().numFreePages--;
+        page(kHeaderIndex).setDirty(true);
+
+        std::memset(freePage.data(), 0, freePage.size());
+        freePage.setDirty(true);
+        return freePage;
+    }
 
-    return *mPages.back();
+    Page::Index index = header().numPages;
+    header().numPages++;
+    page(kHeaderIndex).setDirty(true);
+
+    return appendPage(index);
 }
 
 void PageSet::deletePage(Page &page)
 {
+    // Free pages form a linked list through their first bytes, headed from
+    // the header page
+    *reinterpret_cast<Page::Index*>(page.data()) = header().freeListHead;
+    page.setDirty(true);
+
+    header().freeListHead = page.index();
+    header().numFreePages++;
+    this->page(kHeaderIndex).setDirty(true);
+}
+
+Page::Index PageSet::numPages()
+{
+    return header().numPages;
+}
+
+Page::Index PageSet::numFreePages()
+{
+    return header().numFreePages;
+}
+
+void PageSet::sortFreeList()
+{
+    std::vector<Page::Index> pages = freeList();
+    std::sort(pages.begin(), pages.end());
+    setFreeList(pages);
+}
+
+void PageSet::truncate()
+{
+    std::vector<Page::Index> pages = freeList();
+    std::sort(pages.begin(), pages.end());
+
+    Page::Index numPages = header().numPages;
+    while(!pages.empty() && pages.back() == numPages - 1) {
+        pages.pop_back();
+        numPages--;
+    }
+
+    setFreeList(pages);
+    header().numPages = numPages;
+    page(kHeaderIndex).setDirty(true);
+
+    truncatePages(numPages);
+}
+
+Page::Index PageSet::rootIndex()
+{
+    return header().rootIndex;
+}
+
+void PageSet::setRootIndex(Page::Index index)
+{
+    header().rootIndex = index;
+    page(kHeaderIndex).setDirty(true);
+}
+
+void PageSet::flush()
+{
+}
+
+uint64_t PageSet::commit()
+{
+    return 0;
+}
+
+void PageSet::sync(uint64_t)
+{
+}
+
+PageSet::Header &PageSet::header()
+{
+    return *reinterpret_cast<Header*>(page(kHeaderIndex).data());
+}
+
+void PageSet::initializeHeader()
+{
+    Header &head = header();
+
+    head.magic = kMagic;
+    head.pageSize = page(kHeaderIndex).size();
+    head.numPages = kHeaderIndex + 1;
+    head.rootIndex = Page::kInvalidIndex;
+    head.freeListHead = Page::kInvalidIndex;
+    head.numFreePages = 0;
+    page(kHeaderIndex).setDirty(true);
+}
+
+bool PageSet::validHeader()
+{
+    Header &head = header();
+
+    return head.magic == kMagic && head.pageSize == page(kHeaderIndex).size();
+}
+
+std::vector<Page::Index> PageSet::freeList()
+{
+    std::vector<Page::Index> pages;
+    for(Page::Index index = header().freeListHead; index != Page::kInvalidIndex; ) {
+        pages.push_back(index);
+        index = *reinterpret_cast<Page::Index*>(page(index).data());
+    }
+
+    return pages;
+}
+
+void PageSet::setFreeList(const std::vector<Page::Index> &pages)
+{
+    Page::Index next = Page::kInvalidIndex;
+    for(auto it = pages.rbegin(); it != pages.rend(); it++) {
+        Page &freePage = page(*it);
+        *reinterpret_cast<Page::Index*>(freePage.data()) = next;
+        freePage.setDirty(true);
+        next = *it;
+    }
+
+    header().freeListHead = next;
+    header().numFreePages = pages.size();
+    page(kHeaderIndex).setDirty(true);
 }
\ No newline at end of file
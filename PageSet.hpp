@@ -8,13 +8,60 @@
 
 class PageSet {
 public:
-    Page &page(Page::Index index);
+    static const size_t kDefaultPageSize = 4096;
+    static const size_t kMinPageSize = 512;
+    static const size_t kMaxPageSize = 65536;
+
+    static bool validPageSize(size_t pageSize);
+
+    virtual ~PageSet() = default;
+
+    virtual Page &page(Page::Index index) = 0;
+    size_t pageSize();
 
     Page &addPage();
     void deletePage(Page &page);
 
+    Page::Index numPages();
+    Page::Index numFreePages();
+    void sortFreeList();
+    void truncate();
+
+    Page::Index rootIndex();
+    void setRootIndex(Page::Index index);
+
+    virtual void flush();
+
+    // Ends the current set of changes, returning an id which can be passed to
+    // sync() to wait until they are durable.  The wait is separate so that it
+    // can happen outside of any locks held by the caller.
+    virtual uint64_t commit();
+    virtual void sync(uint64_t commitId);
+
+protected:
+    static const Page::Index kHeaderIndex = 0;
+    static const uint32_t kMagic = 0x42445046;
+
+    // Stored in the first page, so every field has a fixed width
+    struct Header {
+        uint32_t magic;
+        uint32_t pageSize;
+        uint64_t numPages;
+        uint64_t rootIndex;
+        uint64_t freeListHead;
+        uint64_t numFreePages;
+    };
+
+    Header &header();
+    void initializeHeader();
+    bool validHeader();
+
+    virtual Page &appendPage(Page::Index index) = 0;
+    virtual void truncatePages(Page::Index numPages) = 0;
+
 private:
-    std::vector<std::unique_ptr<Page>> mPages;
+    std::vector<Page::Index> freeList();
+    void setFreeList(const std::vector<Page::Index> &pages);
 };
 
 #endif
\ No newline at end of file
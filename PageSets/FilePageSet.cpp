@@ -0,0 +1,217 @@
+#include "PageSets/FilePageSet.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+namespace PageSets {
+    FilePageSet::FilePageSet(const std::string &filename, size_t poolSize, size_t pageSize)
+    : mFile(filename)
+    {
+        mPoolSize = (poolSize < kMinPoolSize) ? kMinPoolSize : poolSize;
+        mClockHand = 0;
+
+        bool exists = mFile.size() > 0;
+        if(exists) {
+            // An existing database keeps the page size it was created with
+            Header head = {};
+            mFile.read(0, &head, sizeof(head));
+            pageSize = head.pageSize;
+        }
+
+        if(!validPageSize(pageSize)) {
+            throw std::runtime_error("Invalid page size for database file " + filename);
+        }
+
+        mPageSize = pageSize;
+        mHeaderPage = std::make_unique<Page>(*this, mPageSize, Page::Index(kHeaderIndex));
+
+        if(exists) {
+            // Opening the log replays any commits which had not yet been
+            // checkpointed into the database file
+            mWal = std::make_unique<WriteAheadLog>(filename + "-wal", mFile, mPageSize);
+            readPage(*mHeaderPage);
+            if(!validHeader()) {
+                throw std::runtime_error("Invalid database file " + filename);
+            }
+        } else {
+            // The header of a new database is written in place, so that the
+            // page size can always be read from the database file
+            initializeHeader();
+            mFile.write(0, mHeaderPage->data(), mPageSize);
+            mFile.sync();
+            mHeaderPage->setDirty(false);
+
+            // A log left behind by an earlier database of the same name must
+            // not be replayed into this one
+            std::remove((filename + "-wal").c_str());
+            mWal = std::make_unique<WriteAheadLog>(filename + "-wal", mFile, mPageSize);
+        }
+    }
+
+    FilePageSet::~FilePageSet()
+    {
+        flush();
+    }
+
+    Page &FilePageSet::page(Page::Index index)
+    {
+        if(index == kHeaderIndex) {
+            return *mHeaderPage;
+        }
+
+        auto it = mFrameMap.find(index);
+        if(it != mFrameMap.end()) {
+            mStats.hits++;
+            mReferenced[it->second] = true;
+            return *mFrames[it->second];
+        }
+
+        mStats.misses++;
+        Page &page = allocateFrame(index);
+        readPage(page);
+
+        return page;
+    }
+
+    void FilePageSet::flush()
+    {
+        commit();
+        mWal->checkpoint();
+    }
+
+    uint64_t FilePageSet::commit()
+    {
+        std::vector<Page*> pages;
+        for(auto &frame : mFrames) {
+            if(frame->dirty()) {
+                pages.push_back(frame.get());
+            }
+        }
+
+        // Frames already written by eviction still need a commit frame after
+        // them, so fall back to logging the header page
+        if(mHeaderPage->dirty() || (pages.empty() && mWal->hasUncommittedFrames())) {
+            pages.push_back(mHeaderPage.get());
+        }
+
+        for(size_t i = 0; i < pages.size(); i++) {
+            writePage(*pages[i], (i == pages.size() - 1) ? numPages() : 0);
+        }
+
+        if(mWal->numFrames() >= kCheckpointFrames) {
+            mWal->checkpoint();
+        }
+
+        return mWal->commitLsn();
+    }
+
+    void FilePageSet::sync(uint64_t commitId)
+    {
+        mWal->sync(commitId);
+    }
+
+    size_t FilePageSet::poolSize()
+    {
+        return mPoolSize;
+    }
+
+    const FilePageSet::Stats &FilePageSet::stats()
+    {
+        return mStats;
+    }
+
+    WriteAheadLog &FilePageSet::wal()
+    {
+        return *mWal;
+    }
+
+    Page &FilePageSet::appendPage(Page::Index index)
+    {
+        Page &page = allocateFrame(index);
+        std::fill(page.data(), page.data() + page.size(), 0);
+        page.setDirty(true);
+
+        return page;
+    }
+
+    void FilePageSet::truncatePages(Page::Index numPages)
+    {
+        // Frames holding truncated pages are discarded without being written.
+        // The database file itself is shrunk at the next checkpoint.
+        for(size_t frame = 0; frame < mFrames.size(); frame++) {
+            Page &page = *mFrames[frame];
+            if(page.index() != Page::kInvalidIndex && page.index() >= numPages) {
+                mFrameMap.erase(page.index());
+                page.setIndex(Page::kInvalidIndex);
+                page.setDirty(false);
+                mReferenced[frame] = false;
+            }
+        }
+
+        mWal->discard(numPages);
+    }
+
+    Page &FilePageSet::allocateFrame(Page::Index index)
+    {
+        size_t frame;
+        if(mFrames.size() < mPoolSize) {
+            frame = mFrames.size();
+            mFrames.push_back(std::make_unique<Page>(*this, mPageSize, index));
+            mReferenced.push_back(true);
+        } else {
+            // Sweep the clock hand over the frames, giving referenced pages a
+            // second chance.  Two full sweeps without finding a victim means
+            // every frame is pinned.
+            size_t scanned = 0;
+            while(true) {
+                if(scanned == 2 * mFrames.size()) {
+                    throw std::runtime_error("Buffer pool exhausted: all pages are pinned");
+                }
+
+                Page &candidate = *mFrames[mClockHand];
+                if(candidate.pinCount() == 0) {
+                    if(!mReferenced[mClockHand]) {
+                        break;
+                    }
+                    mReferenced[mClockHand] = false;
+                }
+
+                mClockHand = (mClockHand + 1) % mFrames.size();
+                scanned++;
+            }
+
+            frame = mClockHand;
+            mClockHand = (mClockHand + 1) % mFrames.size();
+
+            Page &victim = *mFrames[frame];
+            if(victim.dirty()) {
+                writePage(victim);
+            }
+            mFrameMap.erase(victim.index());
+            mStats.evictions++;
+
+            victim.setIndex(index);
+            mReferenced[frame] = true;
+        }
+
+        mFrameMap[index] = frame;
+        return *mFrames[frame];
+    }
+
+    void FilePageSet::readPage(Page &page)
+    {
+        if(!mWal->readPage(page)) {
+            size_t count = mFile.read(uint64_t(page.index()) * page.size(), page.data(), page.size());
+            std::fill(page.data() + count, page.data() + page.size(), 0);
+        }
+        page.setDirty(false);
+    }
+
+    void FilePageSet::writePage(Page &page, Page::Index commitSize)
+    {
+        mWal->writeFrame(page, commitSize);
+        page.setDirty(false);
+        mStats.writes++;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef PAGESETS_FILEPAGESET_HPP
+#define PAGESETS_FILEPAGESET_HPP
+
+#include "PageSet.hpp"
+#include "File.hpp"
+#include "PageSets/WriteAheadLog.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+
+namespace PageSets {
+    // Pages live in a single database file and are cached in a fixed number of
+    // frames.  Pages pinned by a BTreePage are never evicted; the remaining
+    // frames are recycled using the CLOCK replacement policy.
+    //
+    // Modified pages are never written to the database file directly.  They go
+    // to a write-ahead log alongside it, either when evicted or at commit, and
+    // are copied into the database file by periodic checkpoints.
+    class FilePageSet : public PageSet {
+    public:
+        static const size_t kMinPoolSize = 16;
+        static const size_t kCheckpointFrames = 1000;
+
+        struct Stats {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t evictions = 0;
+            uint64_t writes = 0;
+        };
+
+        FilePageSet(const std::string &filename, size_t poolSize, size_t pageSize = kDefaultPageSize);
+        ~FilePageSet();
+
+        Page &page(Page::Index index) override;
+        void flush() override;
+
+        uint64_t commit() override;
+        void sync(uint64_t commitId) override;
+
+        size_t poolSize();
+        const Stats &stats();
+        WriteAheadLog &wal();
+
+    protected:
+        Page &appendPage(Page::Index index) override;
+        void truncatePages(Page::Index numPages) override;
+
+    private:
+        Page &allocateFrame(Page::Index index);
+        void readPage(Page &page);
+        void writePage(Page &page, Page::Index commitSize = 0);
+
+        File mFile;
+        std::unique_ptr<WriteAheadLog> mWal;
+        size_t mPageSize;
+        std::unique_ptr<Page> mHeaderPage;
+        size_t mPoolSize;
+        std::vector<std::unique_ptr<Page>> mFrames;
+        std::vector<bool> mReferenced;
+        std::unordered_map<Page::Index, size_t> mFrameMap;
+        size_t mClockHand;
+        Stats mStats;
+    };
+}
+
+#endif
\ No newline at end of file
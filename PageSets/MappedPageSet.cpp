@@ -0,0 +1,194 @@
+#include "PageSets/MappedPageSet.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace PageSets {
+    MappedPageSet::MappedPageSet(const std::string &filename, size_t pageSize)
+    : mFilename(filename)
+    {
+        bool exists = std::ifstream(filename).good();
+        Header head = {};
+        if(exists) {
+            // An existing database keeps the page size it was created with
+            std::ifstream(filename, std::ios::binary).read(reinterpret_cast<char*>(&head), sizeof(head));
+            if(head.magic != kMagic) {
+                throw std::runtime_error("Invalid database file " + filename);
+            }
+            pageSize = head.pageSize;
+        }
+
+        if(!validPageSize(pageSize)) {
+            throw std::runtime_error("Invalid page size for database file " + filename);
+        }
+
+        mPageSize = pageSize;
+
+#ifdef _WIN32
+        mFile = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if(mFile == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Unable to open database file " + filename);
+        }
+#else
+        mFile = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+        if(mFile == -1) {
+            throw std::runtime_error("Unable to open database file " + filename);
+        }
+#endif
+
+        if(exists) {
+            // Page views are created on first access, so opening does not
+            // depend on the size of the database
+            mapSegments((head.numPages + pagesPerSegment() - 1) / pagesPerSegment());
+            mPages.resize(head.numPages);
+            if(!validHeader()) {
+                throw std::runtime_error("Invalid database file " + filename);
+            }
+        } else {
+            appendPage(kHeaderIndex);
+            initializeHeader();
+            flush();
+        }
+    }
+
+    MappedPageSet::~MappedPageSet()
+    {
+        flush();
+        unmapSegments(0);
+        resizeFile(mPages.size() * mPageSize);
+
+#ifdef _WIN32
+        CloseHandle(mFile);
+#else
+        ::close(mFile);
+#endif
+    }
+
+    Page &MappedPageSet::page(Page::Index index)
+    {
+        std::unique_ptr<Page> &page = mPages[index];
+        if(!page) {
+            uint8_t *data = mSegments[index / pagesPerSegment()] + (index % pagesPerSegment()) * mPageSize;
+            page = std::make_unique<Page>(*this, data, mPageSize, index);
+        }
+
+        return *page;
+    }
+
+    void MappedPageSet::flush()
+    {
+        for(uint8_t *segment : mSegments) {
+#ifdef _WIN32
+            FlushViewOfFile(segment, kSegmentSize);
+#else
+            msync(segment, kSegmentSize, MS_SYNC);
+#endif
+        }
+
+#ifdef _WIN32
+        FlushFileBuffers(mFile);
+#endif
+
+        for(auto &page : mPages) {
+            if(page) {
+                page->setDirty(false);
+            }
+        }
+    }
+
+    Page &MappedPageSet::appendPage(Page::Index index)
+    {
+        if(index / pagesPerSegment() >= mSegments.size()) {
+            mapSegments(mSegments.size() + 1);
+        }
+
+        mPages.resize(index + 1);
+        Page &newPage = page(index);
+        std::fill(newPage.data(), newPage.data() + newPage.size(), 0);
+
+        return newPage;
+    }
+
+    void MappedPageSet::truncatePages(Page::Index numPages)
+    {
+        mPages.resize(numPages);
+
+        size_t numSegments = std::max<size_t>((numPages + pagesPerSegment() - 1) / pagesPerSegment(), 1);
+        unmapSegments(numSegments);
+        resizeFile(numSegments * kSegmentSize);
+    }
+
+    size_t MappedPageSet::pagesPerSegment()
+    {
+        return kSegmentSize / mPageSize;
+    }
+
+    void MappedPageSet::mapSegments(size_t numSegments)
+    {
+        if(numSegments <= mSegments.size()) {
+            return;
+        }
+
+        // The file always extends to the end of the last mapped segment, so
+        // that every mapped address is backed by the file
+        resizeFile(numSegments * kSegmentSize);
+
+        while(mSegments.size() < numSegments) {
+            uint64_t offset = uint64_t(mSegments.size()) * kSegmentSize;
+#ifdef _WIN32
+            uint64_t end = offset + kSegmentSize;
+            HANDLE mapping = CreateFileMappingA(mFile, NULL, PAGE_READWRITE, DWORD(end >> 32), DWORD(end), NULL);
+            void *segment = mapping ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, DWORD(offset >> 32), DWORD(offset), kSegmentSize) : NULL;
+            if(mapping) {
+                CloseHandle(mapping);
+            }
+            if(!segment) {
+                throw std::runtime_error("Unable to map database file " + mFilename);
+            }
+#else
+            void *segment = mmap(nullptr, kSegmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFile, off_t(offset));
+            if(segment == MAP_FAILED) {
+                throw std::runtime_error("Unable to map database file " + mFilename);
+            }
+#endif
+            mSegments.push_back(reinterpret_cast<uint8_t*>(segment));
+        }
+    }
+
+    void MappedPageSet::unmapSegments(size_t numSegments)
+    {
+        while(mSegments.size() > numSegments) {
+#ifdef _WIN32
+            UnmapViewOfFile(mSegments.back());
+#else
+            munmap(mSegments.back(), kSegmentSize);
+#endif
+            mSegments.pop_back();
+        }
+    }
+
+    void MappedPageSet::resizeFile(size_t size)
+    {
+#ifdef _WIN32
+        LARGE_INTEGER position;
+        position.QuadPart = size;
+        if(!SetFilePointerEx(mFile, position, NULL, FILE_BEGIN) || !SetEndOfFile(mFile)) {
+            throw std::runtime_error("Unable to resize database file " + mFilename);
+        }
+#else
+        if(ftruncate(mFile, off_t(size)) != 0) {
+            throw std::runtime_error("Unable to resize database file " + mFilename);
+        }
+#endif
+    }
+}
\ No newline at end of file
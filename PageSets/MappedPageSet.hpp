@@ -0,0 +1,47 @@
+#ifndef PAGESETS_MAPPEDPAGESET_HPP
+#define PAGESETS_MAPPEDPAGESET_HPP
+
+#include "PageSet.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace PageSets {
+    // Pages live in a single database file which is memory-mapped, so page
+    // data is read and written directly in the OS page cache.  The file is
+    // mapped in fixed-size segments; growing the file maps a new segment
+    // rather than remapping the existing ones, so page views stay valid.
+    class MappedPageSet : public PageSet {
+    public:
+        static const size_t kSegmentSize = 16 * 1024 * 1024;
+
+        MappedPageSet(const std::string &filename, size_t pageSize = kDefaultPageSize);
+        ~MappedPageSet();
+
+        Page &page(Page::Index index) override;
+        void flush() override;
+
+    protected:
+        Page &appendPage(Page::Index index) override;
+        void truncatePages(Page::Index numPages) override;
+
+    private:
+        size_t pagesPerSegment();
+        void mapSegments(size_t numSegments);
+        void unmapSegments(size_t numSegments);
+        void resizeFile(size_t size);
+
+        std::string mFilename;
+#ifdef _WIN32
+        void *mFile;
+#else
+        int mFile;
+#endif
+        size_t mPageSize;
+        std::vector<uint8_t*> mSegments;
+        std::vector<std::unique_ptr<Page>> mPages;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,33 @@
+#include "PageSets/MemoryPageSet.hpp"
+
+#include <stdexcept>
+
+namespace PageSets {
+    MemoryPageSet::MemoryPageSet(size_t pageSize)
+    {
+        if(!validPageSize(pageSize)) {
+            throw std::invalid_argument("Invalid page size");
+        }
+
+        mPageSize = pageSize;
+        appendPage(kHeaderIndex);
+        initializeHeader();
+    }
+
+    Page &MemoryPageSet::page(Page::Index index)
+    {
+        return *mPages[index];
+    }
+
+    Page &MemoryPageSet::appendPage(Page::Index index)
+    {
+        mPages.push_back(std::make_unique<Page>(*this, mPageSize, index));
+
+        return *mPages.back();
+    }
+
+    void MemoryPageSet::truncatePages(Page::Index numPages)
+    {
+        mPages.resize(numPages);
+    }
+}
\ No newline at end of file
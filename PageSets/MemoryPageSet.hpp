@@ -0,0 +1,26 @@
+#ifndef PAGESETS_MEMORYPAGESET_HPP
+#define PAGESETS_MEMORYPAGESET_HPP
+
+#include "PageSet.hpp"
+
+#include <vector>
+#include <memory>
+
+namespace PageSets {
+    class MemoryPageSet : public PageSet {
+    public:
+        MemoryPageSet(size_t pageSize = kDefaultPageSize);
+
+        Page &page(Page::Index index) override;
+
+    protected:
+        Page &appendPage(Page::Index index) override;
+        void truncatePages(Page::Index numPages) override;
+
+    private:
+        size_t mPageSize;
+        std::vector<std::unique_ptr<Page>> mPages;
+    };
+}
+
+#endif
\ No newline at end of file
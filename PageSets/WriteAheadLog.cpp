@@ -0,0 +1,242 @@
+#include "PageSets/WriteAheadLog.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace PageSets {
+    WriteAheadLog::WriteAheadLog(const std::string &filename, File &databaseFile, size_t pageSize)
+    : mFile(filename)
+    , mDatabaseFile(databaseFile)
+    {
+        mPageSize = pageSize;
+        mSalt = 0;
+        mEnd = sizeof(LogHeader);
+        mBaseLsn = 0;
+        mCommitSize = 0;
+        mSyncing = false;
+        mGroupCommit = true;
+        mCommitLsn = 0;
+        mSyncedLsn = 0;
+
+        LogHeader header = {};
+        if(mFile.read(0, &header, sizeof(header)) == sizeof(header) && header.magic == kMagic && header.pageSize == mPageSize) {
+            mSalt = header.salt;
+            recover();
+        }
+
+        reset();
+        mFile.sync();
+    }
+
+    void WriteAheadLog::writeFrame(Page &page, Page::Index commitSize)
+    {
+        FrameHeader header = {mSalt, 0, page.index(), commitSize};
+        header.checksum = checksum(header, page.data());
+
+        mFile.write(mEnd, &header, sizeof(header));
+        mFile.write(mEnd + sizeof(header), page.data(), mPageSize);
+        mFrameOffsets[page.index()] = mEnd + sizeof(header);
+        mEnd += sizeof(header) + mPageSize;
+        mStats.frames++;
+
+        if(commitSize != 0) {
+            mCommitSize = commitSize;
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            mCommitLsn = lsn();
+            mPendingCommits[mCommitLsn] = std::chrono::steady_clock::now();
+            mStats.commits++;
+        }
+    }
+
+    bool WriteAheadLog::readPage(Page &page)
+    {
+        auto it = mFrameOffsets.find(page.index());
+        if(it == mFrameOffsets.end()) {
+            return false;
+        }
+
+        mFile.read(it->second, page.data(), mPageSize);
+        return true;
+    }
+
+    void WriteAheadLog::discard(Page::Index numPages)
+    {
+        std::erase_if(mFrameOffsets, [&](auto &entry) { return entry.first >= numPages; });
+    }
+
+    WriteAheadLog::Lsn WriteAheadLog::lsn()
+    {
+        return mBaseLsn + mEnd;
+    }
+
+    WriteAheadLog::Lsn WriteAheadLog::commitLsn()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mCommitLsn;
+    }
+
+    bool WriteAheadLog::hasUncommittedFrames()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return lsn() != mCommitLsn && mEnd != sizeof(LogHeader);
+    }
+
+    size_t WriteAheadLog::numFrames()
+    {
+        return (mEnd - sizeof(LogHeader)) / (sizeof(FrameHeader) + mPageSize);
+    }
+
+    void WriteAheadLog::sync(Lsn lsn)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        if(!mGroupCommit) {
+            // Every commit pays for its own fsync, serialized behind the lock
+            auto it = mPendingCommits.find(lsn);
+            if(it != mPendingCommits.end()) {
+                mFile.sync();
+                mStats.syncs++;
+                mSyncedLsn = std::max(mSyncedLsn, lsn);
+
+                uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - it->second).count();
+                mStats.totalCommitNanoseconds += nanoseconds;
+                mStats.maxCommitNanoseconds = std::max(mStats.maxCommitNanoseconds, nanoseconds);
+                mPendingCommits.erase(it);
+            }
+            return;
+        }
+
+        while(mSyncedLsn < lsn) {
+            if(mSyncing) {
+                mSyncDone.wait(lock);
+                continue;
+            }
+
+            // Become the leader: one fsync covers every commit written so far,
+            // including those that arrive while it is in progress
+            mSyncing = true;
+            Lsn target = mCommitLsn;
+            lock.unlock();
+            mFile.sync();
+            lock.lock();
+            mSyncing = false;
+            mSyncedLsn = target;
+            mStats.syncs++;
+
+            auto now = std::chrono::steady_clock::now();
+            auto end = mPendingCommits.upper_bound(target);
+            for(auto it = mPendingCommits.begin(); it != end; it++) {
+                uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(now - it->second).count();
+                mStats.totalCommitNanoseconds += nanoseconds;
+                mStats.maxCommitNanoseconds = std::max(mStats.maxCommitNanoseconds, nanoseconds);
+            }
+            mPendingCommits.erase(mPendingCommits.begin(), end);
+
+            mSyncDone.notify_all();
+        }
+    }
+
+    void WriteAheadLog::checkpoint()
+    {
+        // Only committed frames may be copied into the database file, so this
+        // must not be called while a commit is partially written
+        sync(commitLsn());
+
+        copyFrames();
+        reset();
+        mStats.checkpoints++;
+    }
+
+    bool WriteAheadLog::groupCommit()
+    {
+        return mGroupCommit;
+    }
+
+    void WriteAheadLog::setGroupCommit(bool groupCommit)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mGroupCommit = groupCommit;
+    }
+
+    const WriteAheadLog::Stats &WriteAheadLog::stats()
+    {
+        return mStats;
+    }
+
+    uint32_t WriteAheadLog::checksum(const FrameHeader &header, const uint8_t *data)
+    {
+        // FNV-1a over the frame header fields and the page contents
+        uint32_t hash = 2166136261u;
+        auto add = [&](const void *bytes, size_t size) {
+            for(size_t i=0; i<size; i++) {
+                hash ^= reinterpret_cast<const uint8_t*>(bytes)[i];
+                hash *= 16777619u;
+            }
+        };
+
+        add(&header.salt, sizeof(header.salt));
+        add(&header.pageIndex, sizeof(header.pageIndex));
+        add(&header.commitSize, sizeof(header.commitSize));
+        add(data, mPageSize);
+
+        return hash;
+    }
+
+    void WriteAheadLog::recover()
+    {
+        // Scan forward until the first torn or stale frame.  Frames only take
+        // effect once a commit frame following them has been seen.
+        std::vector<uint8_t> data(mPageSize);
+        std::unordered_map<Page::Index, uint64_t> pending;
+        uint64_t offset = sizeof(LogHeader);
+        while(true) {
+            FrameHeader header;
+            if(mFile.read(offset, &header, sizeof(header)) < sizeof(header)) break;
+            if(mFile.read(offset + sizeof(header), data.data(), mPageSize) < mPageSize) break;
+            if(header.salt != mSalt || header.checksum != checksum(header, data.data())) break;
+
+            pending[header.pageIndex] = offset + sizeof(header);
+            offset += sizeof(header) + mPageSize;
+
+            if(header.commitSize != 0) {
+                for(auto &[index, frameOffset] : pending) {
+                    mFrameOffsets[index] = frameOffset;
+                }
+                pending.clear();
+                mCommitSize = header.commitSize;
+            }
+        }
+
+        copyFrames();
+    }
+
+    void WriteAheadLog::copyFrames()
+    {
+        std::vector<uint8_t> data(mPageSize);
+        for(auto &[index, offset] : mFrameOffsets) {
+            mFile.read(offset, data.data(), mPageSize);
+            mDatabaseFile.write(uint64_t(index) * mPageSize, data.data(), mPageSize);
+        }
+
+        if(mCommitSize != 0) {
+            mDatabaseFile.resize(uint64_t(mCommitSize) * mPageSize);
+        }
+        mDatabaseFile.sync();
+
+        mFrameOffsets.clear();
+    }
+
+    void WriteAheadLog::reset()
+    {
+        // A new salt invalidates any frames from before the reset which are
+        // still on disk
+        mBaseLsn += mEnd;
+        mSalt++;
+        mEnd = sizeof(LogHeader);
+
+        LogHeader header = {kMagic, uint32_t(mPageSize), mSalt, 0};
+        mFile.write(0, &header, sizeof(header));
+        mFile.resize(sizeof(header));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#ifndef PAGESETS_WRITEAHEADLOG_HPP
+#define PAGESETS_WRITEAHEADLOG_HPP
+
+#include "File.hpp"
+#include "Page.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace PageSets {
+    // Page-level write-ahead log for FilePageSet.  Modified pages are appended
+    // to the log as frames instead of being written in place; the last frame
+    // of a commit is marked with the page count of the database.  Frames are
+    // copied back into the database file by a checkpoint, and on open any
+    // committed frames left over from a crash are replayed.
+    //
+    // Durability is requested separately from writing the frames, so that
+    // commits from several threads which arrive while an fsync is in progress
+    // are made durable together by the next one.
+    class WriteAheadLog {
+    public:
+        typedef uint64_t Lsn;
+
+        struct Stats {
+            uint64_t commits = 0;
+            uint64_t frames = 0;
+            uint64_t syncs = 0;
+            uint64_t checkpoints = 0;
+            uint64_t totalCommitNanoseconds = 0;
+            uint64_t maxCommitNanoseconds = 0;
+        };
+
+        WriteAheadLog(const std::string &filename, File &databaseFile, size_t pageSize);
+
+        void writeFrame(Page &page, Page::Index commitSize);
+        bool readPage(Page &page);
+        void discard(Page::Index numPages);
+
+        Lsn lsn();
+        Lsn commitLsn();
+        bool hasUncommittedFrames();
+        size_t numFrames();
+
+        void sync(Lsn lsn);
+        void checkpoint();
+
+        bool groupCommit();
+        void setGroupCommit(bool groupCommit);
+
+        const Stats &stats();
+
+    private:
+        static const uint32_t kMagic = 0x4c415746;
+
+        struct LogHeader {
+            uint32_t magic;
+            uint32_t pageSize;
+            uint32_t salt;
+            uint32_t reserved;
+        };
+
+        struct FrameHeader {
+            uint32_t salt;
+            uint32_t checksum;
+            uint64_t pageIndex;
+            uint64_t commitSize;
+        };
+
+        uint32_t checksum(const FrameHeader &header, const uint8_t *data);
+        void recover();
+        void copyFrames();
+        void reset();
+
+        File mFile;
+        File &mDatabaseFile;
+        size_t mPageSize;
+        uint32_t mSalt;
+        uint64_t mEnd;
+        Lsn mBaseLsn;
+        Page::Index mCommitSize;
+        std::unordered_map<Page::Index, uint64_t> mFrameOffsets;
+
+        std::mutex mMutex;
+        std::condition_variable mSyncDone;
+        bool mSyncing;
+        bool mGroupCommit;
+        Lsn mCommitLsn;
+        Lsn mSyncedLsn;
+        std::map<Lsn, std::chrono::steady_clock::time_point> mPendingCommits;
+        Stats mStats;
+    };
+}
+
+#endif
\ No newline at end of file
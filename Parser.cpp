@@ -1,5 +1,6 @@
 #include "Parser.hpp"
 
+#include <charconv>
 #include <sstream>
 
 struct ParseError {
@@ -7,14 +8,16 @@ struct ParseError {
     unsigned int pos;
 };
 
-Parser::Parser(const std::string &queryString)
+Parser::Parser(const std::string &queryString, bool parameterizeLiterals)
 : mQueryString(queryString)
 {
+    mParameterizeLiterals = parameterizeLiterals;
 }
 
 std::unique_ptr<Database::Operation> Parser::parse()
 {
     mPos = 0;
+    mParameters.clear();
     skipWhitespace();
 
     try {
@@ -33,6 +36,97 @@ const std::string &Parser::errorMessage()
     return mErrorMessage;
 }
 
+const std::vector<ParameterExpression*> &Parser::parameters()
+{
+    return mParameters;
+}
+
+// Numbers with a decimal point are Doubles, and integers are Ints unless
+// they are too large for one.  Literals take the type of a column they are
+// compared with when the query is bound.
+static Value numberValue(const std::string &number)
+{
+    int64_t integer;
+    auto [ptr, ec] = std::from_chars(number.data(), number.data() + number.size(), integer);
+    if(ec != std::errc() || ptr != number.data() + number.size()) {
+        return Value(std::atof(number.c_str()));
+    }
+
+    if(integer >= INT32_MIN && integer <= INT32_MAX) {
+        return Value(int(integer));
+    }
+    return Value(integer);
+}
+
+// Replaces each literal in a query with ?, collecting the literals in order.
+// The literal types are appended to the result, so that queries which only
+// differ in their literal values normalize to the same string.  Returns
+// nothing for queries which are not worth caching.
+std::optional<std::string> Parser::normalize(const std::string &queryString, std::vector<Value> &literals)
+{
+    std::string result;
+    std::string types;
+    unsigned int pos = 0;
+    while(pos < queryString.size()) {
+        char c = queryString[pos];
+        if(c == '\"') {
+            size_t end = queryString.find('\"', pos + 1);
+            if(end == std::string::npos) {
+                return std::nullopt;
+            }
+            literals.push_back(Value(queryString.substr(pos + 1, end - pos - 1)));
+            types.push_back('s');
+            result.push_back('?');
+            pos = end + 1;
+        } else if(std::isdigit(c) || c == '.') {
+            unsigned int end = pos;
+            while(end < queryString.size() && (std::isdigit(queryString[end]) || queryString[end] == '.')) {
+                end++;
+            }
+            Value number = numberValue(queryString.substr(pos, end - pos));
+            switch(number.type()) {
+                case Value::Type::Int: types.push_back('i'); break;
+                case Value::Type::BigInt: types.push_back('l'); break;
+                default: types.push_back('d'); break;
+            }
+            literals.push_back(std::move(number));
+            result.push_back('?');
+            pos = end;
+        } else if(std::isalpha(c)) {
+            unsigned int end = pos;
+            while(end < queryString.size() && std::isalnum(queryString[end])) {
+                end++;
+            }
+            std::string word = queryString.substr(pos, end - pos);
+            if(word == "true" || word == "false") {
+                literals.push_back(Value(word == "true"));
+                types.push_back('b');
+                result.push_back('?');
+            } else {
+                result += word;
+            }
+            pos = end;
+        } else if(c == ' ' || c == '\t') {
+            if(!result.empty() && result.back() != ' ') {
+                result.push_back(' ');
+            }
+            pos++;
+        } else if(c == '?') {
+            return std::nullopt;
+        } else {
+            result.push_back(c);
+            pos++;
+        }
+    }
+
+    // Only statements whose literals all become parameters can be cached
+    if(!result.starts_with("SELECT") && !result.starts_with("INSERT") && !result.starts_with("UPDATE") && !result.starts_with("DELETE")) {
+        return std::nullopt;
+    }
+
+    return result + "|" + types;
+}
+
 bool Parser::isEnd()
 {
     return mPos >= mQueryString.size();
@@ -121,6 +215,14 @@ Value::Type Parser::expectType()
         result = Value::Type::Boolean;
     } else if(matchLiteral("FLOAT")) {
         result = Value::Type::Float;
+    } else if(matchLiteral("BIGINT")) {
+        result = Value::Type::BigInt;
+    } else if(matchLiteral("DOUBLE")) {
+        result = Value::Type::Double;
+    } else if(matchLiteral("TIMESTAMP")) {
+        result = Value::Type::Timestamp;
+    } else if(matchLiteral("DECIMAL")) {
+        result = Value::Type::Decimal;
     } else if(matchLiteral("VARCHAR") || matchLiteral("STRING")) {
         result = Value::Type::String;
     } else {
@@ -150,25 +252,15 @@ std::optional<Value> Parser::matchValue()
         skipWhitespace();
         return Value(substr);
     } else if(std::isdigit(mQueryString[mPos]) || mQueryString[mPos] == '.') {
-        bool isFloat = false;
         int pos = mPos;
-        while(pos < mQueryString.size()) {
-            if(mQueryString[pos] == '.') {
-                isFloat = true;
-            } else if(!std::isdigit(mQueryString[pos])) {
-                break;
-            }
+        while(pos < mQueryString.size() && (std::isdigit(mQueryString[pos]) || mQueryString[pos] == '.')) {
             pos++;
         }
 
         std::string substr = mQueryString.substr(mPos, pos - mPos);
         mPos = pos;
         skipWhitespace();
-        if(isFloat) {
-            return Value((float)std::atof(substr.c_str()));
-        } else {
-            return Value(std::atoi(substr.c_str()));
-        }
+        return numberValue(substr);
     } else if(matchLiteral("true")) {
         return Value(true);
     } else if(matchLiteral("false")) {
@@ -206,6 +298,35 @@ std::unique_ptr<Database::Operation> Parser::parseOperation()
         return parseDelete();
     } else if(matchLiteral("UPDATE")) {
         return parseUpdate();
+    } else if(matchLiteral("COPY") || matchLiteral("LOAD")) {
+        return parseCopy();
+    } else if(matchLiteral("VACUUM")) {
+        return std::make_unique<Database::Operation>(Database::Operation::Vacuum());
+    } else if(matchLiteral("EXPLAIN")) {
+        Database::Operation::Explain explain;
+        explain.analyze = matchLiteral("ANALYZE");
+        if(matchLiteral("SELECT")) {
+            explain.operation = parseSelect();
+        } else if(matchLiteral("UPDATE")) {
+            explain.operation = parseUpdate();
+        } else if(matchLiteral("DELETE")) {
+            explain.operation = parseDelete();
+        } else {
+            throwExpected("SELECT | UPDATE | DELETE");
+        }
+        return std::make_unique<Database::Operation>(std::move(explain));
+    } else if(matchLiteral("ANALYZE")) {
+        Database::Operation::Analyze analyze;
+        analyze.tableName = matchIdentifier().value_or("");
+        return std::make_unique<Database::Operation>(std::move(analyze));
+    } else if(matchLiteral("SHOW")) {
+        if(matchLiteral("SPACE")) {
+            return std::make_unique<Database::Operation>(Database::Operation::ShowSpace());
+        } else if(matchLiteral("CACHE")) {
+            return std::make_unique<Database::Operation>(Database::Operation::ShowCache());
+        }
+
+        throwExpected("SPACE | CACHE");
     }
 
     throwExpected("<query>");
@@ -226,6 +347,7 @@ std::unique_ptr<Database::Operation> Parser::parseCreateTable()
             continue;
         }
     }
+    createTable.columnar = matchLiteral("COLUMNAR");
 
     return std::make_unique<Database::Operation>(std::move(createTable));
 }
@@ -259,15 +381,28 @@ std::unique_ptr<Database::Operation> Parser::parseInsert()
     insert.tableName = expectIdentifier();
     expectLiteral("VALUES");
 
-    expectLiteral("(");
-    while(!matchLiteral(")")) {
-        Value value = expectValue();
-        insert.values.push_back(value);
+    do {
+        std::vector<Value> values;
+        expectLiteral("(");
+        while(!matchLiteral(")")) {
+            if(matchLiteral("?")) {
+                insert.parameters.push_back({(unsigned int)insert.rows.size(), (unsigned int)values.size()});
+                values.push_back(Value());
+            } else if(matchLiteral("NULL")) {
+                values.push_back(Value::null());
+            } else {
+                if(mParameterizeLiterals) {
+                    insert.parameters.push_back({(unsigned int)insert.rows.size(), (unsigned int)values.size()});
+                }
+                values.push_back(expectValue());
+            }
 
-        if(matchLiteral(",")) {
-            continue;
+            if(matchLiteral(",")) {
+                continue;
+            }
         }
-    }
+        insert.rows.push_back(std::move(values));
+    } while(matchLiteral(","));
 
     return std::make_unique<Database::Operation>(std::move(insert));
 }
@@ -400,6 +535,31 @@ std::unique_ptr<Database::Operation> Parser::parseUpdate()
     return std::make_unique<Database::Operation>(std::move(update));
 }
 
+std::unique_ptr<Database::Operation> Parser::parseCopy()
+{
+    Database::Operation::Copy copy;
+
+    copy.tableName = expectIdentifier();
+    expectLiteral("FROM");
+
+    Value fileName = expectValue();
+    if(fileName.type() != Value::Type::String) {
+        throwExpected("<filename>");
+    }
+    copy.fileName = fileName.stringValue();
+
+    copy.fillFactor = BTree::kDefaultFillFactor;
+    if(matchLiteral("FILLFACTOR")) {
+        Value fillFactor = expectValue();
+        if(fillFactor.type() != Value::Type::Int || fillFactor.intValue() < 50 || fillFactor.intValue() > 100) {
+            throwExpected("<fill factor between 50 and 100>");
+        }
+        copy.fillFactor = fillFactor.intValue() / 100.0;
+    }
+
+    return std::make_unique<Database::Operation>(std::move(copy));
+}
+
 std::unique_ptr<Expression> Parser::expectExpression()
 {
     return parseAndExpression();
@@ -448,6 +608,10 @@ std::unique_ptr<Expression> Parser::parseCompareExpression()
     } else if(matchLiteral(">")) {
         auto rhs = parseAddSubExpression();
         result = std::make_unique<CompareExpression>(CompareExpression::GreaterThan, std::move(result), std::move(rhs));
+    } else if(matchLiteral("IS")) {
+        bool negated = matchLiteral("NOT");
+        expectLiteral("NULL");
+        result = std::make_unique<IsNullExpression>(std::move(result), negated);
     }
 
     return result;
@@ -508,7 +672,19 @@ std::unique_ptr<Expression> Parser::parseBaseExpression()
         auto exp = expectExpression();
         expectLiteral(")");
         return exp;
+    } else if(matchLiteral("?")) {
+        auto parameter = std::make_unique<ParameterExpression>((unsigned int)mParameters.size());
+        mParameters.push_back(parameter.get());
+        return parameter;
+    } else if(matchLiteral("NULL")) {
+        // NULL is left in normalized queries, so it is never a parameter
+        return std::make_unique<ConstantExpression>(Value::null());
     } else if(auto value = matchValue()) {
+        if(mParameterizeLiterals) {
+            auto parameter = std::make_unique<ParameterExpression>((unsigned int)mParameters.size(), *value);
+            mParameters.push_back(parameter.get());
+            return parameter;
+        }
         return std::make_unique<ConstantExpression>(*value);
     } else if(auto id = matchIdentifier()) {
         return std::make_unique<FieldExpression>(*id);
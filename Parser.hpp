@@ -14,10 +14,13 @@
 
 class Parser {
 public:
-    Parser(const std::string &queryString);
+    Parser(const std::string &queryString, bool parameterizeLiterals = false);
 
     std::unique_ptr<Database::Operation> parse();
     const std::string &errorMessage();
+    const std::vector<ParameterExpression*> &parameters();
+
+    static std::optional<std::string> normalize(const std::string &queryString, std::vector<Value> &literals);
 
 private:
     void skipWhitespace();
@@ -40,6 +43,7 @@ private:
     std::unique_ptr<Database::Operation> parseSelect();
     std::unique_ptr<Database::Operation> parseDelete();
     std::unique_ptr<Database::Operation> parseUpdate();
+    std::unique_ptr<Database::Operation> parseCopy();
 
     std::unique_ptr<Expression> expectExpression();
     std::unique_ptr<Expression> parseOrExpression();
@@ -53,6 +57,8 @@ private:
     std::string mQueryString;
     std::string mErrorMessage;
     unsigned int mPos;
+    bool mParameterizeLiterals;
+    std::vector<ParameterExpression*> mParameters;
 };
 
 #endif
\ No newline at end of file
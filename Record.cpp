@@ -1,8 +1,18 @@
 #include "Record.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 namespace Record {
+    // Records with a NULL field have a bitmap of their NULL fields between
+    // the offsets and the data, and none otherwise.  The first offset tells
+    // the two apart.
+    static unsigned int nullBitmapSize(unsigned int fields)
+    {
+        return (fields + 7) / 8;
+    }
+
     Writer::Writer(const Schema &schema)
     : mSchema(schema)
     {
@@ -22,7 +32,13 @@ namespace Record {
     unsigned int Writer::dataSize()
     {
         unsigned int size = mSchema.fields.size() * sizeof(uint16_t);
+        bool nulls = false;
         for(unsigned int i=0; i<mSchema.fields.size(); i++) {
+            if(mValues[i].isNull()) {
+                nulls = true;
+                continue;
+            }
+
             const Schema::Field &field = mSchema.fields[i];
             switch(field.type) {
                 case Value::Type::Int:
@@ -37,20 +53,40 @@ namespace Record {
                 case Value::Type::Boolean:
                     size += sizeof(int);
                     break;
+                case Value::Type::BigInt:
+                case Value::Type::Double:
+                case Value::Type::Timestamp:
+                case Value::Type::Decimal:
+                    size += sizeof(int64_t);
+                    break;
+                case Value::Type::Null:
+                    break;
             }
         }
 
+        if(nulls) {
+            size += nullBitmapSize(mSchema.fields.size());
+        }
         return size;
     }
 
     void Writer::write(void *data)
     {
         uint16_t dataOffset = mSchema.fields.size() * sizeof(uint16_t);
+        bool nulls = std::ranges::any_of(mValues, [](const Value &value) { return value.isNull(); });
+        uint8_t *nullBitmap = reinterpret_cast<uint8_t*>(data) + dataOffset;
+        if(nulls) {
+            dataOffset += nullBitmapSize(mSchema.fields.size());
+        }
 
+        // NULL fields take no space, so their offset is that of the next
         uint8_t *current = reinterpret_cast<uint8_t*>(data);
         for(unsigned int i=0; i<mSchema.fields.size(); i++) {
             *reinterpret_cast<uint16_t*>(current) = dataOffset;
             current += sizeof(uint16_t);
+            if(mValues[i].isNull()) {
+                continue;
+            }
 
             const Schema::Field &field = mSchema.fields[i];
             switch(field.type) {
@@ -65,10 +101,33 @@ namespace Record {
                     break;
                 case Value::Type::Boolean:
                     dataOffset += sizeof(int);
+                    break;
+                case Value::Type::BigInt:
+                case Value::Type::Double:
+                case Value::Type::Timestamp:
+                case Value::Type::Decimal:
+                    dataOffset += sizeof(int64_t);
+                    break;
+                case Value::Type::Null:
+                    break;
+            }
+        }
+
+        if(nulls) {
+            std::memset(nullBitmap, 0, nullBitmapSize(mSchema.fields.size()));
+            for(unsigned int i=0; i<mSchema.fields.size(); i++) {
+                if(mValues[i].isNull()) {
+                    nullBitmap[i / 8] |= 1 << (i % 8);
+                }
             }
+            current += nullBitmapSize(mSchema.fields.size());
         }
 
         for(unsigned int i=0; i<mSchema.fields.size(); i++) {
+            if(mValues[i].isNull()) {
+                continue;
+            }
+
             const Schema::Field &field = mSchema.fields[i];
             switch(field.type) {
                 case Value::Type::Int:
@@ -80,13 +139,36 @@ namespace Record {
                     current += sizeof(float);
                     break;
                 case Value::Type::String:
-                    strcpy((char*)current, mValues[i].stringValue().data());
-                    current += mValues[i].stringValue().size() + 1;
+                {
+                    std::string_view string = mValues[i].stringValue();
+                    std::memcpy(current, string.data(), string.size());
+                    current[string.size()] = '\0';
+                    current += string.size() + 1;
                     break;
+                }
                 case Value::Type::Boolean:
                     *reinterpret_cast<int*>(current) = mValues[i].booleanValue() ? 1 : 0;
                     current += sizeof(int);
                     break;
+                case Value::Type::BigInt:
+                case Value::Type::Timestamp:
+                case Value::Type::Decimal:
+                {
+                    // Eight-byte fields are not necessarily aligned
+                    int64_t value = mValues[i].integerValue(mSchema.fields[i].type);
+                    std::memcpy(current, &value, sizeof(value));
+                    current += sizeof(value);
+                    break;
+                }
+                case Value::Type::Double:
+                {
+                    double value = mValues[i].doubleValue();
+                    std::memcpy(current, &value, sizeof(value));
+                    current += sizeof(value);
+                    break;
+                }
+                case Value::Type::Null:
+                    break;
             }
         }
     }
@@ -99,31 +181,347 @@ namespace Record {
 
     Value Reader::readField(unsigned int index)
     {
-        Value value;
+        return readFieldRef(index).value();
+    }
+
+    bool Reader::isNull(unsigned int index)
+    {
+        const uint16_t *offsets = reinterpret_cast<const uint16_t*>(mData);
+        unsigned int bitmapOffset = mSchema.fields.size() * sizeof(uint16_t);
+        if(offsets[0] == bitmapOffset) {
+            return false;
+        }
+        return (mData[bitmapOffset + index / 8] >> (index % 8)) & 1;
+    }
+
+    ValueRef Reader::readFieldRef(unsigned int index)
+    {
+        if(isNull(index)) {
+            return ValueRef::null();
+        }
 
         const uint16_t *offsets = reinterpret_cast<const uint16_t*>(mData);
         switch(mSchema.fields[index].type) {
             case Value::Type::Int:
-                value.setValue(*reinterpret_cast<const int*>(mData + offsets[index]));
+                return ValueRef(*reinterpret_cast<const int*>(mData + offsets[index]));
+
+            case Value::Type::Float:
+                return ValueRef(*reinterpret_cast<const float*>(mData + offsets[index]));
+
+            case Value::Type::String:
+                return ValueRef(std::string_view(reinterpret_cast<const char*>(mData + offsets[index])));
+
+            case Value::Type::Boolean:
+                return ValueRef(*reinterpret_cast<const int*>(mData + offsets[index]) == 1);
+
+            case Value::Type::BigInt:
+            case Value::Type::Timestamp:
+            case Value::Type::Decimal:
+            {
+                int64_t value;
+                std::memcpy(&value, mData + offsets[index], sizeof(value));
+                return ValueRef(mSchema.fields[index].type, value);
+            }
+
+            case Value::Type::Double:
+            {
+                double value;
+                std::memcpy(&value, mData + offsets[index], sizeof(value));
+                return ValueRef(value);
+            }
+
+            case Value::Type::Null:
                 break;
+        }
+
+        return ValueRef();
+    }
+
+    const uint8_t *Reader::fieldData(unsigned int index)
+    {
+        const uint16_t *offsets = reinterpret_cast<const uint16_t*>(mData);
+        return mData + offsets[index];
+    }
+
+    void Reader::print()
+    {
+        for(unsigned int i=0; i<mSchema.fields.size(); i++) {
+            readFieldRef(i).print();
+            std::cout << " ";
+        }
+    }
+
+    // Each field starts with a byte which is 0 for NULL, so that NULL sorts
+    // first and is followed by nothing, and 1 otherwise.  Integers are stored
+    // big-endian with the sign bit flipped, so that negative values sort
+    // below positive ones.  Floats and doubles additionally have all bits
+    // flipped when negative, which reverses their order.  Strings are
+    // terminated by 0x00 0x00, with any 0x00 inside them escaped as 0x00 0xff.
+    static const uint8_t kKeyNull = 0;
+    static const uint8_t kKeyPresent = 1;
+    static const uint64_t kSignBit64 = uint64_t(1) << 63;
+
+    static void writeUint32(uint8_t *data, uint32_t value)
+    {
+        data[0] = uint8_t(value >> 24);
+        data[1] = uint8_t(value >> 16);
+        data[2] = uint8_t(value >> 8);
+        data[3] = uint8_t(value);
+    }
+
+    static uint32_t readUint32(const uint8_t *data)
+    {
+        return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | uint32_t(data[3]);
+    }
+
+    static void writeUint64(uint8_t *data, uint64_t value)
+    {
+        writeUint32(data, uint32_t(value >> 32));
+        writeUint32(data + 4, uint32_t(value));
+    }
+
+    static uint64_t readUint64(const uint8_t *data)
+    {
+        return (uint64_t(readUint32(data)) << 32) | readUint32(data + 4);
+    }
 
+    static uint32_t encodeFloat(float value)
+    {
+        if(value == 0) {
+            value = 0;
+        }
+
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+    }
+
+    static float decodeFloat(uint32_t bits)
+    {
+        bits = (bits & 0x80000000) ? (bits & ~0x80000000) : ~bits;
+
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    static uint64_t encodeDouble(double value)
+    {
+        if(value == 0) {
+            value = 0;
+        }
+
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return (bits & kSignBit64) ? ~bits : (bits | kSignBit64);
+    }
+
+    static double decodeDouble(uint64_t bits)
+    {
+        bits = (bits & kSignBit64) ? (bits & ~kSignBit64) : ~bits;
+
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    static unsigned int keyValueSize(Value::Type type, const uint8_t *data)
+    {
+        switch(type) {
+            case Value::Type::Int:
             case Value::Type::Float:
-                value.setValue(*reinterpret_cast<const float*>(mData + offsets[index]));
+                return sizeof(uint32_t);
+
+            case Value::Type::String:
+            {
+                unsigned int size = 0;
+                while(data[size] != 0 || data[size + 1] != 0) {
+                    size += (data[size] == 0) ? 2 : 1;
+                }
+                return size + 2;
+            }
+
+            case Value::Type::Boolean:
+                return 1;
+
+            case Value::Type::BigInt:
+            case Value::Type::Double:
+            case Value::Type::Timestamp:
+            case Value::Type::Decimal:
+                return sizeof(uint64_t);
+
+            case Value::Type::Null:
+                break;
+        }
+
+        return 0;
+    }
+
+    static unsigned int keyFieldSize(Value::Type type, const uint8_t *data)
+    {
+        if(data[0] == kKeyNull) {
+            return 1;
+        }
+        return 1 + keyValueSize(type, data + 1);
+    }
+
+    KeyWriter::KeyWriter(const Schema &schema)
+    : mSchema(schema)
+    {
+        mValues.resize(mSchema.fields.size());
+    }
+
+    void KeyWriter::setField(unsigned int index, const Value &value)
+    {
+        mValues[index] = value;
+    }
+
+    Value &KeyWriter::field(unsigned int index)
+    {
+        return mValues[index];
+    }
+
+    unsigned int KeyWriter::dataSize()
+    {
+        unsigned int size = mSchema.fields.size();
+        for(unsigned int i=0; i<mSchema.fields.size(); i++) {
+            if(mValues[i].isNull()) {
+                continue;
+            }
+
+            switch(mSchema.fields[i].type) {
+                case Value::Type::Int:
+                case Value::Type::Float:
+                    size += sizeof(uint32_t);
+                    break;
+                case Value::Type::String:
+                    size += mValues[i].stringValue().size() + std::ranges::count(mValues[i].stringValue(), '\0') + 2;
+                    break;
+                case Value::Type::Boolean:
+                    size += 1;
+                    break;
+                case Value::Type::BigInt:
+                case Value::Type::Double:
+                case Value::Type::Timestamp:
+                case Value::Type::Decimal:
+                    size += sizeof(uint64_t);
+                    break;
+                case Value::Type::Null:
+                    break;
+            }
+        }
+
+        return size;
+    }
+
+    void KeyWriter::write(void *data)
+    {
+        uint8_t *current = reinterpret_cast<uint8_t*>(data);
+        for(unsigned int i=0; i<mSchema.fields.size(); i++) {
+            if(mValues[i].isNull()) {
+                *current++ = kKeyNull;
+                continue;
+            }
+            *current++ = kKeyPresent;
+
+            switch(mSchema.fields[i].type) {
+                case Value::Type::Int:
+                    writeUint32(current, uint32_t(mValues[i].intValue()) ^ 0x80000000);
+                    current += sizeof(uint32_t);
+                    break;
+                case Value::Type::Float:
+                    writeUint32(current, encodeFloat(mValues[i].floatValue()));
+                    current += sizeof(uint32_t);
+                    break;
+                case Value::Type::String:
+                    for(char c : mValues[i].stringValue()) {
+                        *current++ = uint8_t(c);
+                        if(c == 0) {
+                            *current++ = 0xff;
+                        }
+                    }
+                    *current++ = 0;
+                    *current++ = 0;
+                    break;
+                case Value::Type::Boolean:
+                    *current++ = mValues[i].booleanValue() ? 1 : 0;
+                    break;
+                case Value::Type::BigInt:
+                case Value::Type::Timestamp:
+                case Value::Type::Decimal:
+                    writeUint64(current, uint64_t(mValues[i].integerValue(mSchema.fields[i].type)) ^ kSignBit64);
+                    current += sizeof(uint64_t);
+                    break;
+                case Value::Type::Double:
+                    writeUint64(current, encodeDouble(mValues[i].doubleValue()));
+                    current += sizeof(uint64_t);
+                    break;
+                case Value::Type::Null:
+                    break;
+            }
+        }
+    }
+
+    KeyReader::KeyReader(const Schema &schema, const void *data)
+    : mSchema(schema)
+    {
+        mData = reinterpret_cast<const uint8_t*>(data);
+    }
+
+    Value KeyReader::readField(unsigned int index)
+    {
+        const uint8_t *current = mData;
+        for(unsigned int i=0; i<index; i++) {
+            current += keyFieldSize(mSchema.fields[i].type, current);
+        }
+
+        if(*current++ == kKeyNull) {
+            return Value::null();
+        }
+
+        Value value;
+        switch(mSchema.fields[index].type) {
+            case Value::Type::Int:
+                value.setValue(int(readUint32(current) ^ 0x80000000));
+                break;
+
+            case Value::Type::Float:
+                value.setValue(decodeFloat(readUint32(current)));
                 break;
 
             case Value::Type::String:
-                value.setValue(std::string(reinterpret_cast<const char*>(mData + offsets[index])));
+            {
+                std::string string;
+                while(current[0] != 0 || current[1] != 0) {
+                    string.push_back(char(current[0]));
+                    current += (current[0] == 0) ? 2 : 1;
+                }
+                value.setValue(string);
                 break;
+            }
 
             case Value::Type::Boolean:
-                value.setValue(*reinterpret_cast<const int*>(mData + offsets[index]) == 1);
+                value.setValue(current[0] == 1);
+                break;
+
+            case Value::Type::BigInt:
+            case Value::Type::Timestamp:
+            case Value::Type::Decimal:
+                value.setValue(mSchema.fields[index].type, int64_t(readUint64(current) ^ kSignBit64));
+                break;
+
+            case Value::Type::Double:
+                value.setValue(decodeDouble(readUint64(current)));
+                break;
+
+            case Value::Type::Null:
                 break;
         }
 
         return value;
     }
 
-    void Reader::print()
+    void KeyReader::print()
     {
         for(unsigned int i=0; i<mSchema.fields.size(); i++) {
             Value value = readField(i);
@@ -44,6 +44,49 @@ namespace Record {
 
         Value readField(unsigned int index);
 
+        // Tests a field for NULL without reading it
+        bool isNull(unsigned int index);
+
+        // Reads a field without copying it; a string refers to the record
+        ValueRef readFieldRef(unsigned int index);
+
+        // Where a field is stored in the record, in the format written by
+        // Writer.  A NULL field has no data.
+        const uint8_t *fieldData(unsigned int index);
+
+        void print();
+
+    private:
+        const Schema &mSchema;
+        const uint8_t *mData;
+    };
+
+    // Writes a record in an order-preserving binary encoding, used for index
+    // keys: comparing two encoded records with memcmp orders them the same
+    // way as comparing their fields in turn.  Fields are self-delimiting, so
+    // the encoding of the first N fields of a record is a prefix of the
+    // encoding of the whole record.
+    class KeyWriter {
+    public:
+        KeyWriter(const Schema &schema);
+
+        void setField(unsigned int index, const Value &value);
+        Value &field(unsigned int index);
+
+        unsigned int dataSize();
+        void write(void *data);
+
+    private:
+        const Schema &mSchema;
+        std::vector<Value> mValues;
+    };
+
+    class KeyReader {
+    public:
+        KeyReader(const Schema &schema, const void *data);
+
+        Value readField(unsigned int index);
+
         void print();
 
     private:
@@ -0,0 +1,322 @@
+#include "RowBatch.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+bool RowBatch::Column::isNull(unsigned int row)
+{
+    return type == Value::Type::Null || (row / 64 < nulls.size() && ((nulls[row / 64] >> (row % 64)) & 1));
+}
+
+void RowBatch::Column::setNull(unsigned int row)
+{
+    if(nulls.size() <= row / 64) {
+        nulls.resize(row / 64 + 1, 0);
+    }
+    nulls[row / 64] |= uint64_t(1) << (row % 64);
+}
+
+unsigned int RowBatch::Column::size()
+{
+    switch(type) {
+        case Value::Type::Int: return ints.size();
+        case Value::Type::Float: return floats.size();
+        case Value::Type::String: return strings.size();
+        case Value::Type::Boolean: return booleans.size();
+        case Value::Type::BigInt:
+        case Value::Type::Timestamp:
+        case Value::Type::Decimal: return integers.size();
+        case Value::Type::Double: return doubles.size();
+        case Value::Type::Null: return 0;
+    }
+    return 0;
+}
+
+void RowBatch::Column::clear()
+{
+    ints.clear();
+    floats.clear();
+    strings.clear();
+    booleans.clear();
+    integers.clear();
+    doubles.clear();
+    nulls.clear();
+}
+
+void RowBatch::Column::append(Value &value)
+{
+    if(value.isNull()) {
+        appendNull();
+        return;
+    }
+
+    switch(type) {
+        case Value::Type::Int: ints.push_back(value.intValue()); break;
+        case Value::Type::Float: floats.push_back(value.floatValue()); break;
+        case Value::Type::String: strings.emplace_back(value.stringValue()); break;
+        case Value::Type::Boolean: booleans.push_back(value.booleanValue()); break;
+        case Value::Type::BigInt:
+        case Value::Type::Timestamp:
+        case Value::Type::Decimal: integers.push_back(value.integerValue(type)); break;
+        case Value::Type::Double: doubles.push_back(value.doubleValue()); break;
+        case Value::Type::Null: break;
+    }
+}
+
+void RowBatch::Column::appendNull()
+{
+    unsigned int row = size();
+    switch(type) {
+        case Value::Type::Int: ints.push_back(0); break;
+        case Value::Type::Float: floats.push_back(0); break;
+        case Value::Type::String: strings.emplace_back(); break;
+        case Value::Type::Boolean: booleans.push_back(0); break;
+        case Value::Type::BigInt:
+        case Value::Type::Timestamp:
+        case Value::Type::Decimal: integers.push_back(0); break;
+        case Value::Type::Double: doubles.push_back(0); break;
+        case Value::Type::Null: return;
+    }
+    setNull(row);
+}
+
+Value RowBatch::Column::value(unsigned int row)
+{
+    if(isNull(row)) {
+        return Value::null();
+    }
+
+    switch(type) {
+        case Value::Type::Int: return Value(ints[row]);
+        case Value::Type::Float: return Value(floats[row]);
+        case Value::Type::String: return Value(strings[row]);
+        case Value::Type::Boolean: return Value(booleans[row] != 0);
+        case Value::Type::BigInt:
+        case Value::Type::Timestamp:
+        case Value::Type::Decimal: return Value(type, integers[row]);
+        case Value::Type::Double: return Value(doubles[row]);
+        case Value::Type::Null: break;
+    }
+    return Value();
+}
+
+ValueRef RowBatch::Column::valueRef(unsigned int row)
+{
+    if(isNull(row)) {
+        return ValueRef::null();
+    }
+
+    switch(type) {
+        case Value::Type::Int: return ValueRef(ints[row]);
+        case Value::Type::Float: return ValueRef(floats[row]);
+        case Value::Type::String: return ValueRef(std::string_view(strings[row]));
+        case Value::Type::Boolean: return ValueRef(booleans[row] != 0);
+        case Value::Type::BigInt:
+        case Value::Type::Timestamp:
+        case Value::Type::Decimal: return ValueRef(type, integers[row]);
+        case Value::Type::Double: return ValueRef(doubles[row]);
+        case Value::Type::Null: break;
+    }
+    return ValueRef();
+}
+
+RowBatch::RowBatch()
+{
+    mSize = 0;
+}
+
+void RowBatch::reset(const Record::Schema &schema)
+{
+    // The vectors keep their capacity, so a batch reused for every call to
+    // nextBatch() stops allocating once it has been filled
+    mSize = 0;
+    mColumns.resize(schema.fields.size());
+    for(unsigned int i=0; i<mColumns.size(); i++) {
+        mColumns[i].type = schema.fields[i].type;
+        mColumns[i].clear();
+    }
+}
+
+void RowBatch::setFields(std::vector<bool> fields)
+{
+    mFields = std::move(fields);
+}
+
+void RowBatch::addFields(const std::vector<bool> &fields)
+{
+    if(mFields.empty()) {
+        return;
+    }
+
+    mFields.resize(std::max(mFields.size(), fields.size()), false);
+    for(unsigned int i=0; i<fields.size(); i++) {
+        if(fields[i]) {
+            mFields[i] = true;
+        }
+    }
+}
+
+bool RowBatch::wanted(unsigned int index)
+{
+    return mFields.empty() || (index < mFields.size() && mFields[index]);
+}
+
+unsigned int RowBatch::size()
+{
+    return mSize;
+}
+
+unsigned int RowBatch::numColumns()
+{
+    return mColumns.size();
+}
+
+RowBatch::Column &RowBatch::column(unsigned int index)
+{
+    return mColumns[index];
+}
+
+void RowBatch::append(Record::Reader &reader)
+{
+    for(unsigned int i=0; i<mColumns.size(); i++) {
+        if(!wanted(i)) {
+            continue;
+        }
+
+        Column &column = mColumns[i];
+        if(reader.isNull(i)) {
+            column.appendNull();
+            continue;
+        }
+
+        const uint8_t *data = reader.fieldData(i);
+        switch(column.type) {
+            case Value::Type::Int: {
+                int value;
+                std::memcpy(&value, data, sizeof(value));
+                column.ints.push_back(value);
+                break;
+            }
+            case Value::Type::Float: {
+                float value;
+                std::memcpy(&value, data, sizeof(value));
+                column.floats.push_back(value);
+                break;
+            }
+            case Value::Type::String:
+                column.strings.emplace_back(reinterpret_cast<const char*>(data));
+                break;
+            case Value::Type::Boolean: {
+                int value;
+                std::memcpy(&value, data, sizeof(value));
+                column.booleans.push_back(value == 1);
+                break;
+            }
+            case Value::Type::BigInt:
+            case Value::Type::Timestamp:
+            case Value::Type::Decimal: {
+                int64_t value;
+                std::memcpy(&value, data, sizeof(value));
+                column.integers.push_back(value);
+                break;
+            }
+            case Value::Type::Double: {
+                double value;
+                std::memcpy(&value, data, sizeof(value));
+                column.doubles.push_back(value);
+                break;
+            }
+            case Value::Type::Null:
+                break;
+        }
+    }
+    mSize++;
+}
+
+void RowBatch::addRows(unsigned int count)
+{
+    mSize += count;
+}
+
+template<typename T> static void compact(std::vector<T> &values, const std::vector<uint64_t> &selection)
+{
+    // Columns which were not filled are left empty
+    if(values.empty()) {
+        return;
+    }
+
+    size_t kept = 0;
+    for(size_t word=0; word<selection.size(); word++) {
+        for(uint64_t bits = selection[word]; bits != 0; bits &= bits - 1) {
+            size_t row = word * 64 + std::countr_zero(bits);
+            if(row >= values.size()) {
+                break;
+            }
+            if(kept != row) {
+                values[kept] = std::move(values[row]);
+            }
+            kept++;
+        }
+    }
+    values.resize(kept);
+}
+
+// Null bitmaps are compacted bit by bit in place, and trimmed of the bits
+// past the last row kept
+static void compactBits(std::vector<uint64_t> &bits, const std::vector<uint64_t> &selection)
+{
+    if(bits.empty()) {
+        return;
+    }
+
+    size_t kept = 0;
+    for(size_t word=0; word<selection.size(); word++) {
+        for(uint64_t selected = selection[word]; selected != 0; selected &= selected - 1) {
+            size_t row = word * 64 + std::countr_zero(selected);
+            if(row >= bits.size() * 64) {
+                break;
+            }
+            uint64_t bit = (bits[row / 64] >> (row % 64)) & 1;
+            uint64_t mask = uint64_t(1) << (kept % 64);
+            bits[kept / 64] = (bits[kept / 64] & ~mask) | (bit << (kept % 64));
+            kept++;
+        }
+    }
+
+    bits.resize((kept + 63) / 64);
+    if(kept % 64 != 0) {
+        bits.back() &= (uint64_t(1) << (kept % 64)) - 1;
+    }
+}
+
+void RowBatch::filter(const std::vector<uint64_t> &selection)
+{
+    unsigned int kept = 0;
+    for(size_t word=0; word<selection.size(); word++) {
+        uint64_t bits = selection[word];
+        if(mSize - word * 64 < 64) {
+            bits &= (uint64_t(1) << (mSize - word * 64)) - 1;
+        }
+        kept += std::popcount(bits);
+    }
+    if(kept == mSize) {
+        return;
+    }
+
+    for(Column &column : mColumns) {
+        switch(column.type) {
+            case Value::Type::Int: compact(column.ints, selection); break;
+            case Value::Type::Float: compact(column.floats, selection); break;
+            case Value::Type::String: compact(column.strings, selection); break;
+            case Value::Type::Boolean: compact(column.booleans, selection); break;
+            case Value::Type::BigInt:
+            case Value::Type::Timestamp:
+            case Value::Type::Decimal: compact(column.integers, selection); break;
+            case Value::Type::Double: compact(column.doubles, selection); break;
+            case Value::Type::Null: break;
+        }
+        compactBits(column.nulls, selection);
+    }
+    mSize = kept;
+}
\ No newline at end of file
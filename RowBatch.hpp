@@ -0,0 +1,79 @@
+#ifndef ROWBATCH_HPP
+#define ROWBATCH_HPP
+
+#include "Record.hpp"
+#include "Value.hpp"
+
+#include <string>
+#include <vector>
+
+// A block of rows stored column by column, passed between iterators by
+// RowIterator::nextBatch().  Each column keeps its values unboxed, in the
+// vector matching its type.  A NULL row holds some value there, which is
+// never read, and has its bit set in the column's null bitmap.
+class RowBatch {
+public:
+    static const unsigned int kCapacity = 2048;
+
+    struct Column {
+        Value::Type type;
+        std::vector<int> ints;
+        std::vector<float> floats;
+        std::vector<std::string> strings;
+        std::vector<uint8_t> booleans;
+
+        // BigInt, Timestamp and Decimal columns all keep their 64-bit values
+        // in integers
+        std::vector<int64_t> integers;
+        std::vector<double> doubles;
+
+        // Bit i is set if row i is NULL.  The bitmap may be shorter than the
+        // column, and is empty while no row is NULL.  A column of type Null
+        // holds no values, and every row of it is NULL.
+        std::vector<uint64_t> nulls;
+
+        bool isNull(unsigned int row);
+        void setNull(unsigned int row);
+
+        // The number of values held, which is none for a column of type Null
+        unsigned int size();
+
+        void clear();
+        void append(Value &value);
+        void appendNull();
+        Value value(unsigned int row);
+        ValueRef valueRef(unsigned int row);
+    };
+
+    RowBatch();
+
+    // Empties the batch and gives it one column for each field of schema
+    void reset(const Record::Schema &schema);
+
+    // Limits the columns a producer has to fill to those set in fields; the
+    // others may be left empty.  Every column is filled while fields is
+    // empty.  The limit is kept by reset().
+    void setFields(std::vector<bool> fields);
+    void addFields(const std::vector<bool> &fields);
+    bool wanted(unsigned int index);
+
+    unsigned int size();
+    unsigned int numColumns();
+    Column &column(unsigned int index);
+
+    // Rows are added either by decoding a record, or by appending values to
+    // every column and then counting them with addRows()
+    void append(Record::Reader &reader);
+    void addRows(unsigned int count);
+
+    // Keeps only the rows whose bit is set in selection, which holds 64 rows
+    // to a word, in order
+    void filter(const std::vector<uint64_t> &selection);
+
+private:
+    unsigned int mSize;
+    std::vector<Column> mColumns;
+    std::vector<bool> mFields;
+};
+
+#endif
\ No newline at end of file
@@ -8,13 +8,63 @@ public:
         return mIterator.getField(field);
     }
 
+    ValueRef fieldRef(unsigned int field, Value &storage) override {
+        return mIterator.getFieldRef(field, storage);
+    }
+
 private:
     RowIterator &mIterator;
 };
 
+ValueRef RowIterator::getFieldRef(unsigned int index, Value &storage)
+{
+    storage = getField(index);
+    return ValueRef(storage);
+}
+
+bool RowIterator::nextBatch(RowBatch &batch)
+{
+    batch.reset(schema());
+    while(valid() && batch.size() < RowBatch::kCapacity) {
+        for(unsigned int i=0; i<batch.numColumns(); i++) {
+            if(batch.wanted(i)) {
+                Value value = getField(i);
+                batch.column(i).append(value);
+            }
+        }
+        batch.addRows(1);
+        next();
+    }
+
+    return batch.size() > 0;
+}
+
 Value RowIterator::evaluateExpression(Expression &expression, RowIterator &iterator)
 {
     IteratorEvaluateContext context(iterator);
 
     return expression.evaluate(context);
+}
+
+Value RowIterator::evaluateExpression(CompiledExpression &expression, RowIterator &iterator)
+{
+    IteratorEvaluateContext context(iterator);
+
+    return expression.evaluate(context);
+}
+
+Value RowIterator::evaluateExpression(const ModifyEntry &entry, RowIterator &iterator)
+{
+    if(entry.compiled) {
+        return evaluateExpression(*entry.compiled, iterator);
+    } else {
+        return evaluateExpression(*entry.expression, iterator);
+    }
+}
+
+bool RowIterator::evaluatePredicate(CompiledExpression &expression, RowIterator &iterator)
+{
+    IteratorEvaluateContext context(iterator);
+
+    return expression.evaluateBoolean(context);
 }
\ No newline at end of file
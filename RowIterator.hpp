@@ -2,8 +2,10 @@
 #define ROWITERATOR_HPP
 
 #include "Record.hpp"
+#include "RowBatch.hpp"
 #include "Value.hpp"
 #include "Expression.hpp"
+#include "CompiledExpression.hpp"
 
 #include <memory>
 
@@ -18,16 +20,34 @@ public:
     virtual void next() = 0;
     virtual bool remove() = 0;
 
+    // The compiled expression is used if it is set, and must have been
+    // compiled for the current parameters
     struct ModifyEntry {
         unsigned int field;
         std::unique_ptr<Expression> expression;
+        std::unique_ptr<CompiledExpression> compiled;
     };
     virtual bool modify(const std::vector<ModifyEntry> &entries) = 0;
 
     virtual Value getField(unsigned int index) = 0;
 
+    // Reads a field without copying it where the iterator can refer to where
+    // the row is held, and otherwise reads it into storage.  The result is
+    // valid until the iterator moves, storage changes, or a page of another
+    // table is read.  By default the field is read through getField().
+    virtual ValueRef getFieldRef(unsigned int index, Value &storage);
+
+    // Fills batch with up to RowBatch::kCapacity rows, starting at the
+    // current row, and moves past them.  Returns false once no rows are
+    // left.  Only the columns the batch wants need to be filled.  By default
+    // the rows are read one at a time through getField().
+    virtual bool nextBatch(RowBatch &batch);
+
 protected:
     static Value evaluateExpression(Expression &expression, RowIterator &iterator);
+    static Value evaluateExpression(CompiledExpression &expression, RowIterator &iterator);
+    static Value evaluateExpression(const ModifyEntry &entry, RowIterator &iterator);
+    static bool evaluatePredicate(CompiledExpression &expression, RowIterator &iterator);
 };
 
 #endif
\ No newline at end of file
@@ -5,6 +5,21 @@
 #include <algorithm>
 
 namespace RowIterators {
+    // Averages of 32-bit numbers are Floats, and of 64-bit ones Doubles,
+    // except that Decimals stay exact
+    static Value::Type averageType(Value::Type type)
+    {
+        switch(type) {
+            case Value::Type::BigInt:
+            case Value::Type::Double:
+                return Value::Type::Double;
+            case Value::Type::Decimal:
+                return Value::Type::Decimal;
+            default:
+                return Value::Type::Float;
+        }
+    }
+
     AggregateIterator::AggregateIterator(std::unique_ptr<RowIterator> inputIterator, Operation operation, unsigned int field, unsigned int groupField)
     : mInputIterator(std::move(inputIterator))
     {
@@ -21,7 +36,7 @@ namespace RowIterators {
                 mSchema.fields.push_back({mInputIterator->schema().fields[mField].type, "min"});
                 break;
             case Average:
-                mSchema.fields.push_back({Value::Type::Float, "average"});
+                mSchema.fields.push_back({averageType(mInputIterator->schema().fields[mField].type), "average"});
                 break;
             case Sum:
                 mSchema.fields.push_back({mInputIterator->schema().fields[mField].type, "sum"});
@@ -33,6 +48,16 @@ namespace RowIterators {
                 mSchema.fields.push_back({Value::Type::Int, "count"});
                 break;
         }
+
+        // Only the aggregated and grouped columns are read from the input
+        std::vector<bool> inputFields(mInputIterator->schema().fields.size(), false);
+        if(mOperation != Count) {
+            inputFields[mField] = true;
+        }
+        if(mGroupField != kFieldNone) {
+            inputFields[mGroupField] = true;
+        }
+        mBatch.setFields(std::move(inputFields));
     }
 
     Record::Schema &AggregateIterator::schema()
@@ -43,6 +68,8 @@ namespace RowIterators {
     void AggregateIterator::start()
     {
         mInputIterator->start();
+        mBatch.reset(mInputIterator->schema());
+        mBatchRow = 0;
         update();
     }
 
@@ -81,66 +108,96 @@ namespace RowIterators {
         }
     }
 
+    bool AggregateIterator::nextBatch(RowBatch &batch)
+    {
+        batch.reset(mSchema);
+        while(mValid && batch.size() < RowBatch::kCapacity) {
+            if(mGroupField != kFieldNone) {
+                batch.column(0).append(mGroupValue);
+            }
+            batch.column(batch.numColumns() - 1).append(mValue);
+            batch.addRows(1);
+            update();
+        }
+
+        return batch.size() > 0;
+    }
+
+    bool AggregateIterator::fetchInput()
+    {
+        if(mBatchRow < mBatch.size()) {
+            return true;
+        }
+
+        mBatchRow = 0;
+        return mInputIterator->nextBatch(mBatch);
+    }
+
     void AggregateIterator::update()
     {
-        if(!mInputIterator->valid()) {
+        if(!fetchInput()) {
             mValid = false;
             return;
         }
 
+        // NULLs are counted by Count, which counts rows, but are otherwise
+        // skipped; an aggregate of nothing but NULLs is NULL
         int count = 0;
+        int valueCount = 0;
         Value value;
-        if(mInputIterator->valid() && mGroupField != kFieldNone) {
-            mGroupValue = mInputIterator->getField(mGroupField);
+        if(mGroupField != kFieldNone) {
+            mGroupValue = mBatch.column(mGroupField).value(mBatchRow);
         }
-        while(mInputIterator->valid()) {
+        while(fetchInput()) {
+            // Find where the group ends within this batch
+            unsigned int end = mBatch.size();
             if(mGroupField != kFieldNone) {
-                Value groupValue = mInputIterator->getField(mGroupField);
-                if(groupValue != mGroupValue) {
-                    break;
-                }
+                end = groupEnd(mBatch.column(mGroupField), mBatchRow);
             }
 
-            if(mOperation != Operation::Count) {
-                Value newValue = mInputIterator->getField(mField);
-                switch(mOperation) {
-                    case Min:
-                        if(count == 0 || newValue < value) value = newValue;
-                        break;
-                    case Average:
-                    case Sum:
-                        if(count == 0) value = newValue; else value = value + newValue;
-                        break;
-                    case Max:
-                        if(count == 0 || newValue > value) value = newValue;
-                        break;
-                }
+            if(mOperation != Operation::Count && end > mBatchRow) {
+                valueCount += accumulate(mBatch.column(mField), mBatchRow, end, valueCount, value);
             }
 
-            count++;
-            mInputIterator->next();
+            count += end - mBatchRow;
+            mBatchRow = end;
+            if(end < mBatch.size()) {
+                break;
+            }
         }
 
         switch(mOperation) {
             case Min:
             case Max:
             case Sum:
-                mValue = value;
+                mValue = (valueCount > 0) ? value : Value::null();
                 break;
             case Average:
-            {
-                float sum = 0;
+                if(valueCount == 0) {
+                    mValue = Value::null();
+                    break;
+                }
                 switch(mInputIterator->schema().fields[mField].type) {
                     case Value::Type::Int:
-                        sum = (float)value.intValue();
+                        mValue = Value((float)value.intValue() / valueCount);
                         break;
                     case Value::Type::Float:
-                        sum = value.floatValue();
+                        mValue = Value(value.floatValue() / valueCount);
+                        break;
+                    case Value::Type::BigInt:
+                        mValue = Value((double)value.bigIntValue() / valueCount);
+                        break;
+                    case Value::Type::Double:
+                        mValue = Value(value.doubleValue() / valueCount);
+                        break;
+                    case Value::Type::Decimal:
+                        mValue = value / Value(Value::Type::Decimal, valueCount * Value::kDecimalScale);
+                        break;
+                    default:
+                        mValue = Value(0.0f);
                         break;
                 }
-                mValue = Value(sum / count);
                 break;
-            }
             case Count:
                 mValue = Value(count);
                 break;
@@ -148,4 +205,142 @@ namespace RowIterators {
 
         mValid = true;
     }
+
+    // Finds the first row at or after begin which holds another value
+    template<typename T, typename V> static unsigned int runEnd(const std::vector<T> &values, unsigned int begin, const V &value)
+    {
+        unsigned int end = begin;
+        while(end < values.size() && values[end] == value) {
+            end++;
+        }
+        return end;
+    }
+
+    // NULLs form a group of their own.  Their rows hold default values, so a
+    // run of values also ends at the first NULL.
+    unsigned int AggregateIterator::groupEnd(RowBatch::Column &column, unsigned int begin)
+    {
+        unsigned int end = begin;
+        if(mGroupValue.isNull()) {
+            while(end < mBatch.size() && column.isNull(end)) {
+                end++;
+            }
+            return end;
+        }
+
+        switch(column.type) {
+            case Value::Type::Int: end = runEnd(column.ints, begin, mGroupValue.intValue()); break;
+            case Value::Type::Float: end = runEnd(column.floats, begin, mGroupValue.floatValue()); break;
+            case Value::Type::String: end = runEnd(column.strings, begin, mGroupValue.stringValue()); break;
+            case Value::Type::Boolean: end = runEnd(column.booleans, begin, uint8_t(mGroupValue.booleanValue())); break;
+            case Value::Type::BigInt:
+            case Value::Type::Timestamp:
+            case Value::Type::Decimal: end = runEnd(column.integers, begin, mGroupValue.integerValue(column.type)); break;
+            case Value::Type::Double: end = runEnd(column.doubles, begin, mGroupValue.doubleValue()); break;
+            case Value::Type::Null: break;
+        }
+
+        if(!column.nulls.empty()) {
+            for(unsigned int i=begin; i<end; i++) {
+                if(column.isNull(i)) {
+                    return i;
+                }
+            }
+        }
+        return end;
+    }
+
+    // Folds values[begin, end) into result, which is replaced by the first
+    // of them if first is set
+    template<typename T> static T fold(AggregateIterator::Operation operation, const std::vector<T> &values, unsigned int begin, unsigned int end, T result, bool first)
+    {
+        unsigned int i = begin;
+        if(first) {
+            result = values[i++];
+        }
+
+        switch(operation) {
+            case AggregateIterator::Min:
+                for(; i<end; i++) result = std::min(result, values[i]);
+                break;
+            case AggregateIterator::Average:
+            case AggregateIterator::Sum:
+                for(; i<end; i++) result += values[i];
+                break;
+            case AggregateIterator::Max:
+                for(; i<end; i++) result = std::max(result, values[i]);
+                break;
+            default:
+                break;
+        }
+
+        return result;
+    }
+
+    unsigned int AggregateIterator::accumulate(RowBatch::Column &column, unsigned int begin, unsigned int end, int count, Value &value)
+    {
+        if(column.nulls.empty()) {
+            foldRun(column, begin, end, count, value);
+            return end - begin;
+        }
+
+        // Runs of rows between NULLs are folded as they would be without them
+        unsigned int folded = 0;
+        unsigned int i = begin;
+        while(i < end) {
+            if(column.isNull(i)) {
+                i++;
+                continue;
+            }
+
+            unsigned int runEnd = i + 1;
+            while(runEnd < end && !column.isNull(runEnd)) {
+                runEnd++;
+            }
+            foldRun(column, i, runEnd, count + folded, value);
+            folded += runEnd - i;
+            i = runEnd;
+        }
+        return folded;
+    }
+
+    void AggregateIterator::foldRun(RowBatch::Column &column, unsigned int begin, unsigned int end, int count, Value &value)
+    {
+        switch(column.type) {
+            case Value::Type::Int:
+                value = Value(fold(mOperation, column.ints, begin, end, count == 0 ? 0 : value.intValue(), count == 0));
+                return;
+            case Value::Type::Float:
+                value = Value(fold(mOperation, column.floats, begin, end, count == 0 ? 0.0f : value.floatValue(), count == 0));
+                return;
+            case Value::Type::BigInt:
+            case Value::Type::Timestamp:
+            case Value::Type::Decimal:
+                value = Value(column.type, fold(mOperation, column.integers, begin, end, count == 0 ? int64_t(0) : value.integerValue(column.type), count == 0));
+                return;
+            case Value::Type::Double:
+                value = Value(fold(mOperation, column.doubles, begin, end, count == 0 ? 0.0 : value.doubleValue(), count == 0));
+                return;
+            default:
+                break;
+        }
+
+        for(unsigned int i=begin; i<end; i++, count++) {
+            Value newValue = column.value(i);
+            switch(mOperation) {
+                case Min:
+                    if(count == 0 || newValue < value) value = newValue;
+                    break;
+                case Average:
+                case Sum:
+                    if(count == 0) value = newValue; else value = value + newValue;
+                    break;
+                case Max:
+                    if(count == 0 || newValue > value) value = newValue;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
 }
\ No newline at end of file
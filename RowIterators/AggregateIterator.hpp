@@ -30,9 +30,16 @@ namespace RowIterators {
         bool modify(const std::vector<ModifyEntry> &entries) override;
 
         Value getField(unsigned int index) override;
+        bool nextBatch(RowBatch &batch) override;
 
     private:
+        bool fetchInput();
         void update();
+        unsigned int groupEnd(RowBatch::Column &column, unsigned int begin);
+        // Folds the rows [begin, end) of column into value, which already
+        // holds count values, and returns how many were not NULL
+        unsigned int accumulate(RowBatch::Column &column, unsigned int begin, unsigned int end, int count, Value &value);
+        void foldRun(RowBatch::Column &column, unsigned int begin, unsigned int end, int count, Value &value);
 
         std::unique_ptr<RowIterator> mInputIterator;
         Operation mOperation;
@@ -43,6 +50,10 @@ namespace RowIterators {
         Value mGroupValue;
         bool mValid;
         Value mValue;
+
+        // The input is read a batch at a time
+        RowBatch mBatch;
+        unsigned int mBatchRow;
     };
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include "RowIterators/ColumnScanIterator.hpp"
+
+namespace RowIterators {
+    ColumnScanIterator::ColumnScanIterator(ColumnStore &columnStore)
+    : mColumnStore(columnStore)
+    {
+        mPosition = 0;
+        mValid = false;
+    }
+
+    Record::Schema &ColumnScanIterator::schema()
+    {
+        return mColumnStore.table().schema();
+    }
+
+    void ColumnScanIterator::start()
+    {
+        mValid = mColumnStore.firstGroup(mGroup);
+        mPosition = 0;
+        skipRemoved();
+    }
+
+    bool ColumnScanIterator::valid()
+    {
+        return mValid;
+    }
+
+    void ColumnScanIterator::next()
+    {
+        mPosition++;
+        skipRemoved();
+    }
+
+    bool ColumnScanIterator::remove()
+    {
+        Table::RowId rowId = mGroup.firstRowId + mPosition;
+        mColumnStore.table().removeRow(rowId, {});
+
+        // Removing the last row of a group releases it
+        if(mColumnStore.reloadGroup(mGroup)) {
+            mPosition++;
+        } else {
+            mValid = mColumnStore.nextGroup(mGroup);
+            mPosition = 0;
+        }
+        skipRemoved();
+
+        return true;
+    }
+
+    bool ColumnScanIterator::modify(const std::vector<ModifyEntry> &entries)
+    {
+        Table &table = mColumnStore.table();
+        Record::Writer writer(table.schema());
+        for(int i=0; i<table.schema().fields.size(); i++) {
+            writer.setField(i, getField(i));
+        }
+
+        for(const auto &entry : entries) {
+            Value value = evaluateExpression(entry, *this);
+            writer.setField(entry.field, value);
+        }
+
+        table.modifyRow(mGroup.firstRowId + mPosition, writer);
+
+        return true;
+    }
+
+    Value ColumnScanIterator::getField(unsigned int index)
+    {
+        return mColumnStore.readValue(mGroup, index, mPosition).value();
+    }
+
+    ValueRef ColumnScanIterator::getFieldRef(unsigned int index, Value &)
+    {
+        return mColumnStore.readValue(mGroup, index, mPosition);
+    }
+
+    bool ColumnScanIterator::nextBatch(RowBatch &batch)
+    {
+        batch.reset(schema());
+
+        while(mValid && batch.size() < RowBatch::kCapacity) {
+            mPositions.clear();
+            size_t limit = RowBatch::kCapacity - batch.size();
+            for(; mPosition < mGroup.count && mPositions.size() < limit; mPosition++) {
+                if(!mGroup.removed(mPosition)) {
+                    mPositions.push_back(mPosition);
+                }
+            }
+
+            for(unsigned int i=0; i<batch.numColumns(); i++) {
+                if(batch.wanted(i)) {
+                    mColumnStore.readColumn(mGroup, i, mPositions, batch.column(i));
+                }
+            }
+            batch.addRows(mPositions.size());
+
+            skipRemoved();
+        }
+
+        return batch.size() > 0;
+    }
+
+    void ColumnScanIterator::skipRemoved()
+    {
+        while(mValid) {
+            while(mPosition < mGroup.count && mGroup.removed(mPosition)) {
+                mPosition++;
+            }
+            if(mPosition < mGroup.count) {
+                return;
+            }
+
+            mValid = mColumnStore.nextGroup(mGroup);
+            mPosition = 0;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef ROWITERATORS_COLUMNSCANITERATOR_HPP
+#define ROWITERATORS_COLUMNSCANITERATOR_HPP
+
+#include "RowIterator.hpp"
+#include "ColumnStore.hpp"
+
+namespace RowIterators {
+    // Scans a table through its column store.  Batches are filled with only
+    // the columns they want, each copied from its page in one piece.
+    class ColumnScanIterator : public RowIterator {
+    public:
+        ColumnScanIterator(ColumnStore &columnStore);
+
+        Record::Schema &schema() override;
+
+        void start() override;
+        bool valid() override;
+        void next() override;
+        bool remove() override;
+        bool modify(const std::vector<ModifyEntry> &entries) override;
+
+        Value getField(unsigned int index) override;
+        ValueRef getFieldRef(unsigned int index, Value &storage) override;
+        bool nextBatch(RowBatch &batch) override;
+
+    private:
+        void skipRemoved();
+
+        ColumnStore &mColumnStore;
+        ColumnStore::Group mGroup;
+        unsigned int mPosition;
+        bool mValid;
+        std::vector<unsigned int> mPositions;
+    };
+}
+#endif
\ No newline at end of file
@@ -54,7 +54,12 @@ namespace RowIterators {
         if(index < mInputIterator->schema().fields.size()) {
             return mInputIterator->getField(index);
         } else {
+            // A row with no foreign row, as when its key is NULL, is joined
+            // to NULLs
             void *data = mForeignTable.data(mTablePointer);
+            if(!data) {
+                return Value::null();
+            }
             Record::Reader reader(mForeignTable.schema(), data);
             return reader.readField(index - mInputIterator->schema().fields.size());
         }
@@ -64,6 +69,10 @@ namespace RowIterators {
     {
         if(mInputIterator->valid()) {
             Value foreignKey = mInputIterator->getField(mForeignKeyIndex);
+            if(foreignKey.isNull()) {
+                mTablePointer = {Page::kInvalidIndex, 0};
+                return;
+            }
             Table::RowId rowId = foreignKey.intValue();
 
             mTablePointer = mForeignTable.lookup(rowId);
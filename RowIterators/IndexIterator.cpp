@@ -3,7 +3,7 @@
 #include "Table.hpp"
 
 namespace RowIterators {
-    IndexIterator::IndexIterator(Index &index, std::optional<Index::Limit> startLimit, std::optional<Index::Limit> endLimit)
+    IndexIterator::IndexIterator(Index &index, std::optional<Limit> startLimit, std::optional<Limit> endLimit)
     : mIndex(index)
     , mStartLimit(std::move(startLimit))
     , mEndLimit(std::move(endLimit))
@@ -17,8 +17,31 @@ namespace RowIterators {
 
     void IndexIterator::start()
     {
-        mStartPointer = mStartLimit ? mIndex.lookup(*mStartLimit) : mIndex.first();
-        mEndPointer = mEndLimit ? mIndex.lookup(*mEndLimit) : mIndex.last();
+        // A parameter given NULL matches no key
+        std::optional<Index::Limit> startLimit = mStartLimit ? evaluateLimit(*mStartLimit) : std::nullopt;
+        std::optional<Index::Limit> endLimit = mEndLimit ? evaluateLimit(*mEndLimit) : std::nullopt;
+        if((mStartLimit && !startLimit) || (mEndLimit && !endLimit)) {
+            mIndexPointer = {Page::kInvalidIndex, 0};
+            return;
+        }
+
+        if(startLimit) {
+            mStartPointer = mIndex.lookup(*startLimit);
+        } else {
+            mStartPointer = mIndex.first();
+        }
+
+        if(endLimit) {
+            mEndPointer = mIndex.lookup(*endLimit);
+        } else {
+            mEndPointer = mIndex.last();
+        }
+
+        // The range is empty if either end is missing or they have crossed
+        if(!mStartPointer.valid() || !mEndPointer.valid() || mIndex.compare(mStartPointer, mEndPointer) > 0) {
+            mIndexPointer = {Page::kInvalidIndex, 0};
+            return;
+        }
 
         mIndexPointer = mStartPointer;
         updateTablePointer();
@@ -41,8 +64,15 @@ namespace RowIterators {
 
     bool IndexIterator::remove()
     {
+        // Removing the last entry of the range ends the scan, since the
+        // entry which takes its place lies beyond the range
+        bool last = (mIndexPointer == mEndPointer);
+
         Index::Pointer* pointers[] = {&mIndexPointer, &mStartPointer, &mEndPointer};
         mIndex.table().removeRow(mRowId, pointers);
+        if(last) {
+            mIndexPointer = {Page::kInvalidIndex, 0};
+        }
         updateTablePointer();
 
         return true;
@@ -50,7 +80,21 @@ namespace RowIterators {
 
     bool IndexIterator::modify(const std::vector<ModifyEntry> &entries)
     {
-        return false;
+        // The entries must not change the keys of this index, or the row
+        // would move within the range being scanned
+        Record::Writer writer(schema());
+        for(int i=0; i<schema().fields.size(); i++) {
+            writer.setField(i, getField(i));
+        }
+
+        for(const auto &entry : entries) {
+            Value value = evaluateExpression(entry, *this);
+            writer.setField(entry.field, value);
+        }
+
+        mIndex.table().modifyRow(mTablePointer, writer);
+
+        return true;
     }
 
     Value IndexIterator::getField(unsigned int index)
@@ -61,6 +105,28 @@ namespace RowIterators {
         return reader.readField(index);
     }
 
+    ValueRef IndexIterator::getFieldRef(unsigned int index, Value &)
+    {
+        Record::Reader reader(mIndex.table().schema(), mIndex.table().data(mTablePointer));
+
+        return reader.readFieldRef(index);
+    }
+
+    std::optional<Index::Limit> IndexIterator::evaluateLimit(Limit &limit)
+    {
+        Index::Limit result;
+        result.comparison = limit.comparison;
+        result.position = limit.position;
+        for(auto &value : limit.values) {
+            result.values.push_back(evaluateExpression(*value, *this));
+            if(result.values.back().isNull() && dynamic_cast<ParameterExpression*>(value.get())) {
+                return std::nullopt;
+            }
+        }
+
+        return result;
+    }
+
     void IndexIterator::updateTablePointer()
     {
         if(mIndexPointer.valid()) {
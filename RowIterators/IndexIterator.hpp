@@ -9,7 +9,17 @@
 namespace RowIterators {
     class IndexIterator : public RowIterator {
     public:
-        IndexIterator(Index &index, std::optional<Index::Limit> startLimit, std::optional<Index::Limit> endLimit);
+        // Bound on the scanned range of keys.  The values may contain
+        // parameters, so they are evaluated each time the iterator starts.
+        // Both limits of a range share the values of its leading fields.  A
+        // NULL constant stands for the NULL keys, which sort first.
+        struct Limit {
+            BTree::SearchComparison comparison;
+            BTree::SearchPosition position;
+            std::vector<std::shared_ptr<Expression>> values;
+        };
+
+        IndexIterator(Index &index, std::optional<Limit> startLimit, std::optional<Limit> endLimit);
 
         Record::Schema &schema() override;
 
@@ -20,8 +30,11 @@ namespace RowIterators {
         bool modify(const std::vector<ModifyEntry> &entries) override;
 
         Value getField(unsigned int index) override;
+        ValueRef getFieldRef(unsigned int index, Value &storage) override;
 
     private:
+        // Returns nothing if a parameter is NULL
+        std::optional<Index::Limit> evaluateLimit(Limit &limit);
         void updateTablePointer();
     
         Index &mIndex;
@@ -31,8 +44,8 @@ namespace RowIterators {
 
         Index::Pointer mStartPointer;
         Index::Pointer mEndPointer;
-        std::optional<Index::Limit> mStartLimit;
-        std::optional<Index::Limit> mEndLimit;
+        std::optional<Limit> mStartLimit;
+        std::optional<Limit> mEndLimit;
     };
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "RowIterators/ProfileIterator.hpp"
+
+#include <chrono>
+
+namespace RowIterators {
+    // Adds the time from its construction to its destruction to a counter
+    class ScopedTimer {
+    public:
+        ScopedTimer(uint64_t &nanoseconds) : mNanoseconds(nanoseconds), mStart(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() {
+            mNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - mStart).count();
+        }
+
+    private:
+        uint64_t &mNanoseconds;
+        std::chrono::steady_clock::time_point mStart;
+    };
+
+    ProfileIterator::ProfileIterator(std::unique_ptr<RowIterator> inputIterator)
+    : mInputIterator(std::move(inputIterator))
+    {
+        mCurrentCounted = false;
+    }
+
+    Record::Schema &ProfileIterator::schema()
+    {
+        return mInputIterator->schema();
+    }
+
+    void ProfileIterator::start()
+    {
+        ScopedTimer timer(mStats.nanoseconds);
+        mStats.starts++;
+        mInputIterator->start();
+        mCurrentCounted = mInputIterator->valid();
+        if(mCurrentCounted) {
+            mStats.rows++;
+        }
+    }
+
+    bool ProfileIterator::valid()
+    {
+        return mInputIterator->valid();
+    }
+
+    void ProfileIterator::next()
+    {
+        ScopedTimer timer(mStats.nanoseconds);
+        mStats.nextCalls++;
+        mInputIterator->next();
+        mCurrentCounted = mInputIterator->valid();
+        if(mCurrentCounted) {
+            mStats.rows++;
+        }
+    }
+
+    bool ProfileIterator::remove()
+    {
+        // Removing a row moves to the next one
+        ScopedTimer timer(mStats.nanoseconds);
+        bool result = mInputIterator->remove();
+        mCurrentCounted = result && mInputIterator->valid();
+        if(mCurrentCounted) {
+            mStats.rows++;
+        }
+        return result;
+    }
+
+    bool ProfileIterator::modify(const std::vector<ModifyEntry> &entries)
+    {
+        ScopedTimer timer(mStats.nanoseconds);
+        return mInputIterator->modify(entries);
+    }
+
+    Value ProfileIterator::getField(unsigned int index)
+    {
+        ScopedTimer timer(mStats.nanoseconds);
+        mStats.getFieldCalls++;
+        return mInputIterator->getField(index);
+    }
+
+    ValueRef ProfileIterator::getFieldRef(unsigned int index, Value &storage)
+    {
+        ScopedTimer timer(mStats.nanoseconds);
+        mStats.getFieldCalls++;
+        return mInputIterator->getFieldRef(index, storage);
+    }
+
+    bool ProfileIterator::nextBatch(RowBatch &batch)
+    {
+        ScopedTimer timer(mStats.nanoseconds);
+        bool result = mInputIterator->nextBatch(batch);
+        if(result) {
+            mStats.batches++;
+            mStats.rows += batch.size() - (mCurrentCounted ? 1 : 0);
+        }
+        mCurrentCounted = false;
+        return result;
+    }
+
+    const ProfileIterator::Stats &ProfileIterator::stats()
+    {
+        return mStats;
+    }
+
+    void ProfileIterator::resetStats()
+    {
+        mStats = Stats();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef ROWITERATORS_PROFILEITERATOR_HPP
+#define ROWITERATORS_PROFILEITERATOR_HPP
+
+#include "RowIterator.hpp"
+
+#include <memory>
+
+namespace RowIterators {
+    // Passes its input through unchanged, counting the calls made to it and
+    // the time spent in them.  Used by EXPLAIN ANALYZE, which puts one above
+    // each iterator of a query.  Times include the time spent in the
+    // iterators below.
+    class ProfileIterator : public RowIterator {
+    public:
+        struct Stats {
+            uint64_t rows = 0;
+            uint64_t starts = 0;
+            uint64_t nextCalls = 0;
+            uint64_t getFieldCalls = 0;
+            uint64_t batches = 0;
+            uint64_t nanoseconds = 0;
+        };
+
+        ProfileIterator(std::unique_ptr<RowIterator> inputIterator);
+
+        Record::Schema &schema() override;
+
+        void start() override;
+        bool valid() override;
+        void next() override;
+        bool remove() override;
+        bool modify(const std::vector<ModifyEntry> &entries) override;
+
+        Value getField(unsigned int index) override;
+        ValueRef getFieldRef(unsigned int index, Value &storage) override;
+        bool nextBatch(RowBatch &batch) override;
+
+        const Stats &stats();
+        void resetStats();
+
+    private:
+        std::unique_ptr<RowIterator> mInputIterator;
+        Stats mStats;
+
+        // Whether the current row was counted when it was moved to, in which
+        // case the next batch begins with it
+        bool mCurrentCounted;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -7,9 +7,14 @@ namespace RowIterators {
     : mInputIterator(std::move(inputIterator))
     , mFields(std::move(fields))
     {        
+        std::vector<bool> inputFields;
         for(auto &field : mFields) {
             mSchema.fields.push_back({field.expression->type(), field.name});
+            field.expression->usedFields(inputFields);
+            mCompiledFields.emplace_back(*field.expression);
         }
+        inputFields.resize(mInputIterator->schema().fields.size(), false);
+        mInputBatch.setFields(std::move(inputFields));
     }
 
     Record::Schema &ProjectIterator::schema()
@@ -19,6 +24,9 @@ namespace RowIterators {
 
     void ProjectIterator::start()
     {
+        for(auto &compiled : mCompiledFields) {
+            compiled.compile();
+        }
         mInputIterator->start();
         updateValues();
     }
@@ -53,6 +61,28 @@ namespace RowIterators {
         return mValues[index];
     }
 
+    ValueRef ProjectIterator::getFieldRef(unsigned int index, Value &)
+    {
+        return ValueRef(mValues[index]);
+    }
+
+    bool ProjectIterator::nextBatch(RowBatch &batch)
+    {
+        batch.reset(mSchema);
+        if(!mInputIterator->nextBatch(mInputBatch)) {
+            return false;
+        }
+
+        for(unsigned int i=0; i<mFields.size(); i++) {
+            if(batch.wanted(i)) {
+                mFields[i].expression->evaluateBatch(mInputBatch, batch.column(i));
+            }
+        }
+        batch.addRows(mInputBatch.size());
+
+        return true;
+    }
+
     void ProjectIterator::updateValues()
     {
         if(!mInputIterator->valid()) {
@@ -60,8 +90,8 @@ namespace RowIterators {
         }
 
         mValues.clear();
-        for(auto &field : mFields) {
-            Value value = evaluateExpression(*field.expression, *mInputIterator);
+        for(auto &compiled : mCompiledFields) {
+            Value value = evaluateExpression(compiled, *mInputIterator);
             mValues.push_back(std::move(value));
         }
     }
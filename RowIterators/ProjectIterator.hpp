@@ -23,6 +23,8 @@ namespace RowIterators {
         bool modify(const std::vector<ModifyEntry> &entries) override;
 
         Value getField(unsigned int index) override;
+        ValueRef getFieldRef(unsigned int index, Value &storage) override;
+        bool nextBatch(RowBatch &batch) override;
 
     private:
         void updateValues();
@@ -30,7 +32,9 @@ namespace RowIterators {
         Record::Schema mSchema;
         std::unique_ptr<RowIterator> mInputIterator;
         std::vector<FieldDefinition> mFields;
+        std::vector<CompiledExpression> mCompiledFields;
         std::vector<Value> mValues;
+        RowBatch mInputBatch;
     };
 }
 
@@ -4,7 +4,9 @@ namespace RowIterators {
     SelectIterator::SelectIterator(std::unique_ptr<RowIterator> inputIterator, std::unique_ptr<Expression> predicate)
     : mInputIterator(std::move(inputIterator))
     , mPredicate(std::move(predicate))
+    , mCompiledPredicate(*mPredicate)
     {
+        mPredicate->usedFields(mPredicateFields);
     }
 
     Record::Schema &SelectIterator::schema()
@@ -14,6 +16,7 @@ namespace RowIterators {
 
     void SelectIterator::start()
     {
+        mCompiledPredicate.compile();
         mInputIterator->start();
         updateIterator();        
     }
@@ -48,11 +51,31 @@ namespace RowIterators {
         return mInputIterator->getField(index);
     }
 
+    ValueRef SelectIterator::getFieldRef(unsigned int index, Value &storage)
+    {
+        return mInputIterator->getFieldRef(index, storage);
+    }
+
+    bool SelectIterator::nextBatch(RowBatch &batch)
+    {
+        // Batches left empty by the predicate are skipped
+        batch.addFields(mPredicateFields);
+        while(mInputIterator->nextBatch(batch)) {
+            mPredicate->filterBatch(batch, mSelection);
+            batch.filter(mSelection);
+
+            if(batch.size() > 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
     void SelectIterator::updateIterator()
     {
         while(mInputIterator->valid()) {
-            Value predicateValue = evaluateExpression(*mPredicate, *mInputIterator);
-            if(predicateValue.booleanValue()) {
+            if(evaluatePredicate(mCompiledPredicate, *mInputIterator)) {
                 break;
             }
             mInputIterator->next();
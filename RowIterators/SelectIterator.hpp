@@ -20,12 +20,17 @@ namespace RowIterators {
         bool modify(const std::vector<ModifyEntry> &entries) override;
 
         Value getField(unsigned int index) override;
+        ValueRef getFieldRef(unsigned int index, Value &storage) override;
+        bool nextBatch(RowBatch &batch) override;
 
     private:
         void updateIterator();
 
         std::unique_ptr<RowIterator> mInputIterator;
         std::unique_ptr<Expression> mPredicate;
+        CompiledExpression mCompiledPredicate;
+        std::vector<bool> mPredicateFields;
+        std::vector<uint64_t> mSelection;
     };
 }
 
@@ -18,10 +18,14 @@ namespace RowIterators {
 
     void SortIterator::start()
     {
+        mData.clear();
+        mOffsets.clear();
         mInputIterator->start();
 
+        // One writer is reused, so rows of short strings are copied without
+        // allocating
+        Record::Writer writer(mInputIterator->schema());
         while(mInputIterator->valid()) {
-            Record::Writer writer(mInputIterator->schema());
             for(unsigned int i=0; i<mInputIterator->schema().fields.size(); i++) {
                 writer.setField(i, mInputIterator->getField(i));
             }
@@ -37,10 +41,8 @@ namespace RowIterators {
         auto cmp = [&](unsigned int a, unsigned int b) {
             Record::Reader readerA(mInputIterator->schema(), mData.data() + a);
             Record::Reader readerB(mInputIterator->schema(), mData.data() + b);
-            Value valueA = readerA.readField(mSortField);
-            Value valueB = readerB.readField(mSortField);
 
-            return valueA < valueB;
+            return readerA.readFieldRef(mSortField) < readerB.readFieldRef(mSortField);
         };
 
         std::sort(mOffsets.begin(), mOffsets.end(), cmp);
@@ -73,4 +75,16 @@ namespace RowIterators {
 
         return reader.readField(index);
     }
+
+    ValueRef SortIterator::getFieldRef(unsigned int index, Value &)
+    {
+        Record::Reader reader(mInputIterator->schema(), mData.data() + mOffsets[mRow]);
+
+        return reader.readFieldRef(index);
+    }
+
+    size_t SortIterator::bufferedBytes()
+    {
+        return mData.size() + mOffsets.size() * sizeof(unsigned int);
+    }
 }
\ No newline at end of file
@@ -19,6 +19,10 @@ namespace RowIterators {
         bool modify(const std::vector<ModifyEntry> &entries) override;
 
         Value getField(unsigned int index) override;
+        ValueRef getFieldRef(unsigned int index, Value &storage) override;
+
+        // Size of the rows read in by the last start()
+        size_t bufferedBytes();
 
     private:
         std::unique_ptr<RowIterator> mInputIterator;
@@ -41,7 +41,7 @@ namespace RowIterators {
         }
 
         for(const auto &entry : entries) {
-            Value value = evaluateExpression(*entry.expression, *this);
+            Value value = evaluateExpression(entry, *this);
             writer.setField(entry.field, value);
         }
 
@@ -57,4 +57,34 @@ namespace RowIterators {
 
         return reader.readField(index);
     }
+
+    ValueRef TableIterator::getFieldRef(unsigned int index, Value &)
+    {
+        Record::Reader reader(mTable.schema(), mTable.data(mPointer));
+
+        return reader.readFieldRef(index);
+    }
+
+    bool TableIterator::nextBatch(RowBatch &batch)
+    {
+        batch.reset(mTable.schema());
+
+        // Rows are only counted if none of their columns are wanted
+        bool decode = false;
+        for(unsigned int i=0; i<batch.numColumns(); i++) {
+            decode = decode || batch.wanted(i);
+        }
+
+        while(mPointer.valid() && batch.size() < RowBatch::kCapacity) {
+            if(decode) {
+                Record::Reader reader(mTable.schema(), mTable.data(mPointer));
+                batch.append(reader);
+            } else {
+                batch.addRows(1);
+            }
+            mTable.moveNext(mPointer);
+        }
+
+        return batch.size() > 0;
+    }
 }
\ No newline at end of file
@@ -18,6 +18,8 @@ namespace RowIterators {
         bool modify(const std::vector<ModifyEntry> &entries) override;
 
         Value getField(unsigned int index) override;
+        ValueRef getFieldRef(unsigned int index, Value &storage) override;
+        bool nextBatch(RowBatch &batch) override;
 
     private:
         Table &mTable;
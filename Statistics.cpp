@@ -0,0 +1,362 @@
+#include "Statistics.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+Statistics::HyperLogLog::HyperLogLog()
+{
+    clear();
+}
+
+void Statistics::HyperLogLog::add(uint64_t hash)
+{
+    // The top bits of the hash pick a register, which keeps the longest run
+    // of leading zeros seen in the remaining bits
+    unsigned int index = hash >> (64 - kBits);
+    uint64_t rest = hash << kBits;
+    uint8_t rank = (rest == 0) ? (64 - kBits + 1) : (std::countl_zero(rest) + 1);
+    mRegisters[index] = std::max(mRegisters[index], rank);
+}
+
+double Statistics::HyperLogLog::estimate()
+{
+    double sum = 0;
+    unsigned int zeros = 0;
+    for(uint8_t rank : mRegisters) {
+        sum += std::ldexp(1.0, -rank);
+        if(rank == 0) {
+            zeros++;
+        }
+    }
+
+    double m = kRegisters;
+    double alpha = 0.7213 / (1.0 + 1.079 / m);
+    double estimate = alpha * m * m / sum;
+
+    // Small cardinalities are better estimated from the number of registers
+    // which are still empty
+    if(estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * std::log(m / zeros);
+    }
+
+    return estimate;
+}
+
+void Statistics::HyperLogLog::clear()
+{
+    mRegisters.fill(0);
+}
+
+Statistics::Statistics(const Record::Schema &schema)
+: mSchema(schema)
+{
+    mValid = false;
+    mRowCount = 0;
+}
+
+bool Statistics::valid()
+{
+    return mValid;
+}
+
+void Statistics::reset()
+{
+    mValid = true;
+    mRowCount = 0;
+    mColumns.clear();
+    mColumns.resize(mSchema.fields.size());
+}
+
+void Statistics::addRow(Record::Writer &writer)
+{
+    if(!mValid) {
+        return;
+    }
+
+    mRowCount++;
+    for(unsigned int i=0; i<mColumns.size(); i++) {
+        addValue(i, writer.field(i));
+    }
+}
+
+void Statistics::modifyRow(Record::Writer &writer)
+{
+    if(!mValid) {
+        return;
+    }
+
+    for(unsigned int i=0; i<mColumns.size(); i++) {
+        addValue(i, writer.field(i));
+    }
+}
+
+void Statistics::removeRow()
+{
+    if(mValid && mRowCount > 0) {
+        mRowCount--;
+    }
+}
+
+Statistics::Analyzer::Analyzer(Statistics &statistics)
+: mStatistics(statistics)
+{
+    mStatistics.reset();
+    mRowsSeen = 0;
+    mRandom = 0x9e3779b97f4a7c15ull;
+}
+
+void Statistics::Analyzer::add(Record::Reader &reader)
+{
+    std::vector<Value> row;
+    for(unsigned int i=0; i<mStatistics.mColumns.size(); i++) {
+        row.push_back(reader.readField(i));
+        mStatistics.addValue(i, row.back());
+    }
+    mStatistics.mRowCount++;
+
+    // Reservoir sampling keeps each row seen so far with equal probability
+    if(mSample.size() < kSampleSize) {
+        mSample.push_back(std::move(row));
+    } else {
+        mRandom ^= mRandom << 13;
+        mRandom ^= mRandom >> 7;
+        mRandom ^= mRandom << 17;
+        uint64_t slot = mRandom % (mRowsSeen + 1);
+        if(slot < kSampleSize) {
+            mSample[slot] = std::move(row);
+        }
+    }
+    mRowsSeen++;
+}
+
+void Statistics::Analyzer::finish()
+{
+    for(unsigned int i=0; i<mStatistics.mColumns.size(); i++) {
+        Column &column = mStatistics.mColumns[i];
+
+        std::vector<Value> values;
+        for(auto &row : mSample) {
+            if(!row[i].isNull()) {
+                values.push_back(row[i]);
+            }
+        }
+        std::sort(values.begin(), values.end(), [](Value &a, Value &b) { return a < b; });
+        if(values.empty()) {
+            continue;
+        }
+
+        // Runs of equal values, as the offset of their first value and their
+        // length
+        std::vector<std::tuple<size_t, size_t>> runs;
+        for(size_t j=0; j<values.size(); j++) {
+            if(j == 0 || values[j] != values[j - 1]) {
+                runs.push_back({j, 0});
+            }
+            std::get<1>(runs.back())++;
+        }
+
+        // A value is common if it occurs noticeably more often than the
+        // average value in the sample
+        double average = double(values.size()) / runs.size();
+        std::vector<std::tuple<size_t, size_t>> common;
+        for(auto &run : runs) {
+            size_t count = std::get<1>(run);
+            if(count > 1 && count > 1.25 * average) {
+                common.push_back(run);
+            }
+        }
+        std::sort(common.begin(), common.end(), [](auto &a, auto &b) { return std::get<1>(a) > std::get<1>(b); });
+        if(common.size() > kMostCommon) {
+            common.resize(kMostCommon);
+        }
+
+        std::vector<bool> isCommon(values.size(), false);
+        for(auto &[start, count] : common) {
+            column.mostCommon.push_back({values[start], double(count) / values.size()});
+            std::fill(isCommon.begin() + start, isCommon.begin() + start + count, true);
+        }
+
+        std::vector<Value> rest;
+        for(size_t j=0; j<values.size(); j++) {
+            if(!isCommon[j]) {
+                rest.push_back(values[j]);
+            }
+        }
+        if(rest.size() >= 2) {
+            for(size_t j=0; j<=kBuckets; j++) {
+                column.histogram.push_back(rest[j * (rest.size() - 1) / kBuckets]);
+            }
+        }
+    }
+
+    mSample.clear();
+}
+
+uint64_t Statistics::rowCount()
+{
+    return mRowCount;
+}
+
+double Statistics::distinctCount(unsigned int column)
+{
+    // Removed rows stay counted by the estimator, so it is limited by the
+    // number of rows left
+    double estimate = std::round(mColumns[column].distinct.estimate());
+    return std::clamp(estimate, 1.0, std::max(double(mRowCount), 1.0));
+}
+
+double Statistics::equalSelectivity(unsigned int column, std::optional<Value> value)
+{
+    Column &stats = mColumns[column];
+
+    double commonShare = 0;
+    for(auto &[common, share] : stats.mostCommon) {
+        if(value && common == *value) {
+            return share;
+        }
+        commonShare += share;
+    }
+
+    if(value && stats.min && stats.max && (*value < *stats.min || *value > *stats.max)) {
+        return 0.0;
+    }
+
+    double others = std::max(distinctCount(column) - stats.mostCommon.size(), 1.0);
+    return std::max(1.0 - commonShare, 0.0) / others;
+}
+
+std::optional<double> Statistics::rangeSelectivity(unsigned int column, std::optional<Value> lower, std::optional<Value> upper)
+{
+    Column &stats = mColumns[column];
+
+    std::optional<double> rest = fraction(stats, lower, upper);
+    if(!rest) {
+        return std::nullopt;
+    }
+
+    double commonShare = 0;
+    double selectivity = 0;
+    for(auto &[common, share] : stats.mostCommon) {
+        commonShare += share;
+        if((!lower || common >= *lower) && (!upper || common <= *upper)) {
+            selectivity += share;
+        }
+    }
+
+    return selectivity + std::max(1.0 - commonShare, 0.0) * *rest;
+}
+
+uint64_t Statistics::hash(const ValueRef &value)
+{
+    // FNV-1a over the value's bytes, then mixed so that every bit of the
+    // result depends on every bit of the input
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&](const void *bytes, size_t size) {
+        for(size_t i=0; i<size; i++) {
+            hash ^= reinterpret_cast<const uint8_t*>(bytes)[i];
+            hash *= 1099511628211ull;
+        }
+    };
+
+    switch(value.type()) {
+        case Value::Type::Int: { int v = value.intValue(); add(&v, sizeof(v)); break; }
+        case Value::Type::Float: { float v = value.floatValue(); add(&v, sizeof(v)); break; }
+        case Value::Type::String: add(value.stringValue().data(), value.stringValue().size()); break;
+        case Value::Type::Boolean: { bool v = value.booleanValue(); add(&v, sizeof(v)); break; }
+        case Value::Type::BigInt:
+        case Value::Type::Timestamp:
+        case Value::Type::Decimal: { int64_t v = value.bigIntValue(); add(&v, sizeof(v)); break; }
+        case Value::Type::Double: { double v = value.doubleValue(); add(&v, sizeof(v)); break; }
+        case Value::Type::Null: break;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+std::optional<double> Statistics::position(Value &value)
+{
+    switch(value.type()) {
+        case Value::Type::Int: return value.intValue();
+        case Value::Type::Float: return value.floatValue();
+        case Value::Type::Boolean: return value.booleanValue() ? 1.0 : 0.0;
+        case Value::Type::BigInt:
+        case Value::Type::Timestamp:
+        case Value::Type::Decimal: return double(value.integerValue(value.type()));
+        case Value::Type::Double: return value.doubleValue();
+        default: return std::nullopt;
+    }
+}
+
+// NULLs are left out of every statistic but the row count
+void Statistics::addValue(unsigned int column, Value &value)
+{
+    if(value.isNull()) {
+        return;
+    }
+
+    Column &stats = mColumns[column];
+    stats.distinct.add(hash(value));
+    if(!stats.min || value < *stats.min) {
+        stats.min = value;
+    }
+    if(!stats.max || value > *stats.max) {
+        stats.max = value;
+    }
+}
+
+std::optional<double> Statistics::fraction(Column &column, std::optional<Value> &lower, std::optional<Value> &upper)
+{
+    // Fraction of the values not in the most common list which lie between
+    // the bounds, interpolating linearly within a histogram bucket or, if
+    // there is no histogram, between the column's minimum and maximum
+    if(column.histogram.size() >= 2) {
+        std::vector<Value> &bounds = column.histogram;
+        size_t buckets = bounds.size() - 1;
+        auto below = [&](Value &value) {
+            if(value <= bounds.front()) return 0.0;
+            if(value >= bounds.back()) return 1.0;
+
+            size_t i = 0;
+            while(!(value < bounds[i + 1])) {
+                i++;
+            }
+
+            double within = 0.5;
+            std::optional<double> low = position(bounds[i]);
+            std::optional<double> high = position(bounds[i + 1]);
+            std::optional<double> point = position(value);
+            if(low && high && point && *high > *low) {
+                within = (*point - *low) / (*high - *low);
+            }
+            return (i + within) / buckets;
+        };
+
+        double start = lower ? below(*lower) : 0.0;
+        double end = upper ? below(*upper) : 1.0;
+        return std::max(end - start, 0.0);
+    }
+
+    if(!column.min || !column.max) {
+        return std::nullopt;
+    }
+
+    std::optional<double> min = position(*column.min);
+    std::optional<double> max = position(*column.max);
+    std::optional<double> start = lower ? position(*lower) : min;
+    std::optional<double> end = upper ? position(*upper) : max;
+    if(!min || !max || !start || !end) {
+        return std::nullopt;
+    }
+
+    if(*max == *min) {
+        return (*start <= *min && *end >= *max) ? 1.0 : 0.0;
+    }
+    return std::clamp((std::min(*end, *max) - std::max(*start, *min)) / (*max - *min), 0.0, 1.0);
+}
\ No newline at end of file
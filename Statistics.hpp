@@ -0,0 +1,104 @@
+#ifndef STATISTICS_HPP
+#define STATISTICS_HPP
+
+#include "Record.hpp"
+#include "Value.hpp"
+
+#include <array>
+#include <optional>
+#include <vector>
+
+// Summary of the contents of a table, used to estimate how many rows a
+// predicate selects.  The row count is kept exact as rows are added and
+// removed.  Distinct counts and the range of each column are only widened
+// as rows change, so they are upper bounds until the next analyze().
+// Lists of most common values and equi-depth histograms are only built by
+// analyze(), from a sample of the rows, and are scaled to the current row
+// count when used.
+//
+// Statistics are not stored in the database; a table which was loaded
+// rather than created has none until it is analyzed.
+class Statistics {
+public:
+    // Estimates the number of distinct values added to it in a fixed amount
+    // of space
+    class HyperLogLog {
+    public:
+        HyperLogLog();
+
+        void add(uint64_t hash);
+        double estimate();
+        void clear();
+
+    private:
+        static const unsigned int kBits = 10;
+        static const unsigned int kRegisters = 1 << kBits;
+
+        std::array<uint8_t, kRegisters> mRegisters;
+    };
+
+    struct Column {
+        HyperLogLog distinct;
+        std::optional<Value> min;
+        std::optional<Value> max;
+
+        // Values making up a large share of the sampled rows, with that share
+        std::vector<std::tuple<Value, double>> mostCommon;
+
+        // Boundaries of buckets which each hold the same number of the
+        // sampled rows not covered by mostCommon
+        std::vector<Value> histogram;
+    };
+
+    Statistics(const Record::Schema &schema);
+
+    bool valid();
+    void reset();
+
+    void addRow(Record::Writer &writer);
+    void modifyRow(Record::Writer &writer);
+    void removeRow();
+
+    // Rebuilds the statistics from every row of a table, given one at a time
+    class Analyzer {
+    public:
+        Analyzer(Statistics &statistics);
+
+        void add(Record::Reader &reader);
+        void finish();
+
+    private:
+        static const size_t kSampleSize = 30000;
+        static const size_t kMostCommon = 10;
+        static const size_t kBuckets = 32;
+
+        Statistics &mStatistics;
+        std::vector<std::vector<Value>> mSample;
+        uint64_t mRowsSeen;
+        uint64_t mRandom;
+    };
+
+    uint64_t rowCount();
+    double distinctCount(unsigned int column);
+
+    // Fraction of rows whose column equals value, or any single value if it
+    // is not known
+    double equalSelectivity(unsigned int column, std::optional<Value> value);
+
+    // Fraction of rows whose column lies between the bounds given.  Nothing
+    // is returned unless something is known about the column's distribution.
+    std::optional<double> rangeSelectivity(unsigned int column, std::optional<Value> lower, std::optional<Value> upper);
+
+private:
+    static uint64_t hash(const ValueRef &value);
+    static std::optional<double> position(Value &value);
+    void addValue(unsigned int column, Value &value);
+    std::optional<double> fraction(Column &column, std::optional<Value> &lower, std::optional<Value> &upper);
+
+    const Record::Schema &mSchema;
+    bool mValid;
+    uint64_t mRowCount;
+    std::vector<Column> mColumns;
+};
+
+#endif
\ No newline at end of file
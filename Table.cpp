@@ -1,7 +1,10 @@
 #include "Table.hpp"
 
+#include "ColumnStore.hpp"
 #include "Index.hpp"
 
+#include <algorithm>
+
 class RowIdKeyDefinition : public BTree::KeyDefinition {
 public:
     virtual BTreePage::Size fixedSize() override { return sizeof(Table::RowId); }
@@ -12,6 +15,7 @@ public:
         if(ar == br) return 0;
         return 1;
     }
+    virtual ComparatorKind comparatorKind() override { return ComparatorKind::UInt32; }
     virtual void print(BTree::Key key) override {
         std::cout << *reinterpret_cast<Table::RowId*>(key.data);
     }
@@ -32,17 +36,84 @@ private:
     Record::Schema &mSchema;
 };
 
+struct Table::Loader::IndexLoaders {
+    std::vector<std::unique_ptr<Index::Loader>> loaders;
+};
+
+Table::Loader::Loader(Table &table, double fillFactor)
+: mTable(table)
+{
+    if(mTable.mTree.empty()) {
+        mBuilder = std::make_unique<BTree::Builder>(mTable.mTree, fillFactor);
+    }
+
+    mIndexLoaders = std::make_unique<IndexLoaders>();
+    for(Index *index : mTable.mIndices) {
+        mIndexLoaders->loaders.push_back(std::make_unique<Index::Loader>(*index, fillFactor));
+    }
+}
+
+Table::Loader::~Loader()
+{
+}
+
+Table::RowId Table::Loader::add(Record::Writer &writer)
+{
+    RowId rowId = mTable.mNextRowId;
+    BTree::Key key(&rowId, sizeof(rowId));
+    void *data;
+    if(mBuilder) {
+        data = mBuilder->add(key, writer.dataSize());
+    } else {
+        data = mTable.mTree.data(mTable.mTree.append(key, writer.dataSize()));
+    }
+    writer.write(data);
+    mTable.mStatistics.addRow(writer);
+
+    for(auto &loader : mIndexLoaders->loaders) {
+        loader->add(rowId, writer);
+    }
+
+    if(mTable.mColumnStore) {
+        mTable.mColumnStore->add(rowId, writer);
+    }
+
+    mTable.mNextRowId++;
+
+    return rowId;
+}
+
+void Table::Loader::finish()
+{
+    if(mBuilder) {
+        mBuilder->finish();
+    }
+
+    for(auto &loader : mIndexLoaders->loaders) {
+        loader->finish();
+    }
+}
+
 Table::Table(Page &rootPage, Record::Schema schema)
 : mPageSet(rootPage.pageSet())
 , mSchema(std::move(schema))
+, mStatistics(mSchema)
 , mTree(mPageSet, rootPage.index(), std::make_unique<RowIdKeyDefinition>(), std::make_unique<RowDataDefinition>(mSchema))
 {
+    mColumnStore = nullptr;
 }
 
 void Table::initialize()
 {
     mTree.initialize();
     mNextRowId = 1;
+    mStatistics.reset();
+}
+
+void Table::load()
+{
+    Pointer pointer = mTree.last();
+    mNextRowId = pointer.valid() ? getRowId(pointer) + 1 : 1;
 }
 
 Record::Schema &Table::schema()
@@ -50,6 +121,23 @@ Record::Schema &Table::schema()
     return mSchema;
 }
 
+Statistics &Table::statistics()
+{
+    return mStatistics;
+}
+
+uint64_t Table::analyze()
+{
+    Statistics::Analyzer analyzer(mStatistics);
+    for(Pointer pointer = mTree.first(); pointer.valid(); mTree.moveNext(pointer)) {
+        Record::Reader reader(mSchema, mTree.data(pointer));
+        analyzer.add(reader);
+    }
+    analyzer.finish();
+
+    return mStatistics.rowCount();
+}
+
 std::vector<Index*> &Table::indices()
 {
     return mIndices;
@@ -57,15 +145,21 @@ std::vector<Index*> &Table::indices()
 
 Table::RowId Table::addRow(Record::Writer &writer)
 {
+    // Row ids only increase, so new rows always go at the end of the tree
     RowId rowId = mNextRowId;
-    Pointer pointer = mTree.add(BTree::Key(&rowId, sizeof(rowId)), writer.dataSize());
+    Pointer pointer = mTree.append(BTree::Key(&rowId, sizeof(rowId)), writer.dataSize());
     void *data = mTree.data(pointer);
     writer.write(data);
+    mStatistics.addRow(writer);
 
     for(auto &index : mIndices) {
         index->add(rowId, writer);
     }
 
+    if(mColumnStore) {
+        mColumnStore->add(rowId, writer);
+    }
+
     mNextRowId++;
 
     return rowId;
@@ -77,22 +171,32 @@ void Table::modifyRow(RowId rowId, Record::Writer &writer)
         index->modify(rowId, writer);
     }
 
+    if(mColumnStore) {
+        mColumnStore->modify(rowId, writer);
+    }
+
     Pointer pointer = mTree.lookup(BTree::Key(&rowId, sizeof(rowId)), BTree::SearchComparison::Equal, BTree::SearchPosition::First);
     mTree.resize(pointer, writer.dataSize());
     void *data = mTree.data(pointer);
     writer.write(data);
+    mStatistics.modifyRow(writer);
 }
 
-void Table::modifyRow(Pointer pointer, Record::Writer &writer)
+void Table::modifyRow(Pointer &pointer, Record::Writer &writer)
 {
     RowId rowId = getRowId(pointer);
     for(auto &index : mIndices) {
         index->modify(rowId, writer);
     }
 
+    if(mColumnStore) {
+        mColumnStore->modify(rowId, writer);
+    }
+
     mTree.resize(pointer, writer.dataSize());
     void *data = mTree.data(pointer);
     writer.write(data);
+    mStatistics.modifyRow(writer);
 }
 
 void Table::removeRow(RowId rowId, std::span<Pointer*> trackPointers)
@@ -101,13 +205,28 @@ void Table::removeRow(RowId rowId, std::span<Pointer*> trackPointers)
         index->remove(rowId, trackPointers);
     }
 
+    if(mColumnStore) {
+        mColumnStore->remove(rowId);
+    }
+
     Pointer pointer = mTree.lookup(BTree::Key(&rowId, sizeof(rowId)), BTree::SearchComparison::Equal, BTree::SearchPosition::First);
     mTree.remove(pointer, trackPointers);
+    mStatistics.removeRow();
 }
 
 void Table::removeRow(Pointer pointer, std::span<Pointer*> trackPointers)
 {
+    RowId rowId = getRowId(pointer);
+    for(auto &index : mIndices) {
+        index->remove(rowId, trackPointers);
+    }
+
+    if(mColumnStore) {
+        mColumnStore->remove(rowId);
+    }
+
     mTree.remove(pointer, trackPointers);
+    mStatistics.removeRow();
 }
 
 Table::Pointer Table::first()
@@ -149,11 +268,44 @@ void *Table::data(Pointer pointer)
     }
 }
 
+BTreePage::Size Table::dataSize(Pointer pointer)
+{
+    return mTree.dataSize(pointer);
+}
+
 void Table::addIndex(Index &index)
 {
     mIndices.push_back(&index);
 }
 
+void Table::setColumnStore(ColumnStore &columnStore)
+{
+    // Removed rows keep their place in the column store, so row ids past the
+    // last row in the tree may already be taken there
+    mColumnStore = &columnStore;
+    mNextRowId = std::max(mNextRowId, mColumnStore->nextRowId());
+}
+
+ColumnStore *Table::columnStore()
+{
+    return mColumnStore;
+}
+
+Page::Index Table::rootIndex()
+{
+    return mTree.rootIndex();
+}
+
+void Table::relocatePages(Page::Index limit, std::vector<Page::Index> &oldPages)
+{
+    mTree.relocatePages(limit, oldPages);
+}
+
+BTree::SpaceStats Table::spaceStats()
+{
+    return mTree.spaceStats();
+}
+
 void Table::print()
 {
     mTree.print();
@@ -4,27 +4,52 @@
 #include "BTree.hpp"
 #include "PageSet.hpp"
 #include "Record.hpp"
+#include "Statistics.hpp"
 
 #include <memory>
 #include <span>
 
+class ColumnStore;
 class Index;
 class Table {
 public:
     typedef uint32_t RowId;
     typedef BTree::Pointer Pointer;
 
+    // Appends rows in bulk.  Into an empty table, the table tree and the tree
+    // of each index are built bottom-up once all rows have been added.
+    // Otherwise rows are appended to the table as they arrive, and the index
+    // entries for them are sorted and added in one ordered pass by finish().
+    class Loader {
+    public:
+        Loader(Table &table, double fillFactor = BTree::kDefaultFillFactor);
+        ~Loader();
+
+        RowId add(Record::Writer &writer);
+        void finish();
+
+    private:
+        struct IndexLoaders;
+
+        Table &mTable;
+        std::unique_ptr<BTree::Builder> mBuilder;
+        std::unique_ptr<IndexLoaders> mIndexLoaders;
+    };
+
     Table(Page &rootPage, Record::Schema schema);
 
     void initialize();
+    void load();
 
     std::vector<Index*> &indices();
 
     Record::Schema &schema();
+    Statistics &statistics();
+    uint64_t analyze();
 
     RowId addRow(Record::Writer &writer);
     void modifyRow(RowId rowId, Record::Writer &writer);
-    void modifyRow(Pointer pointer, Record::Writer &writer);    
+    void modifyRow(Pointer &pointer, Record::Writer &writer);    
     void removeRow(RowId rowId, std::span<Pointer*> trackPointers);
     void removeRow(Pointer pointer, std::span<Pointer*> trackPointers);
 
@@ -38,16 +63,28 @@ public:
 
     RowId getRowId(Pointer pointer);
     void *data(Pointer pointer);
+    BTreePage::Size dataSize(Pointer pointer);
 
     void addIndex(Index &index);
 
+    // Rows are also kept in columnStore, if the table has one
+    void setColumnStore(ColumnStore &columnStore);
+    ColumnStore *columnStore();
+
+    Page::Index rootIndex();
+    void relocatePages(Page::Index limit, std::vector<Page::Index> &oldPages);
+
+    BTree::SpaceStats spaceStats();
+
     void print();
 
 private:
     PageSet &mPageSet;
     Record::Schema mSchema;
+    Statistics mStatistics;
     BTree mTree;
     RowId mNextRowId;
     std::vector<Index*> mIndices;
+    ColumnStore *mColumnStore;
 };
 #endif
\ No newline at end of file
@@ -1,237 +1,717 @@
 #include "Value.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <new>
 #include <sstream>
 
-Value::Value(int value)
+static_assert(sizeof(Value) == 16);
+
+Value::Value(const std::string &value)
 {
-    mType = Type::Int;
-    mValue = value;
+    setValue(std::string_view(value));
 }
 
-Value::Value(float value)
+Value::Value(std::string_view value)
 {
-    mType = Type::Float;
-    mValue = value;
+    setValue(value);
 }
 
-Value::Value(const std::string &value)
+void Value::setValue(std::string_view value)
 {
+    // The string may be this value's own
+    LongString *previous = (mType == Type::String && mShortSize == kLong) ? longString() : nullptr;
+
+    if(value.size() <= kShortCapacity) {
+        std::memmove(mData, value.data(), value.size());
+        mShortSize = value.size();
+    } else {
+        void *block = std::malloc(sizeof(LongString) + value.size());
+        if(!block) {
+            throw std::bad_alloc();
+        }
+        LongString *string = new(block) LongString{1, uint32_t(value.size())};
+        std::memcpy(string->data(), value.data(), value.size());
+        store(string);
+        mShortSize = kLong;
+    }
     mType = Type::String;
-    mValue = value;
-}
 
-Value::Value(bool value)
-{
-    mType = Type::Boolean;
-    mValue = value;
+    if(previous && --previous->references == 0) {
+        std::free(previous);
+    }
 }
 
-Value::Type Value::type()
+void Value::print(int width) const
 {
-    return mType;
+    ValueRef(*this).print(width);
 }
 
-void Value::setValue(int value)
+int Value::minPrintWidth(Type type)
 {
-    mType = Type::Int;
-    mValue = value;
+    switch(type) {
+        case Value::Type::Int:
+        case Value::Type::Float:
+        case Value::Type::Boolean:
+        case Value::Type::Null:
+            return 6;
+
+        case Value::Type::BigInt:
+        case Value::Type::Double:
+        case Value::Type::Decimal:
+            return 12;
+
+        case Value::Type::String:
+        case Value::Type::Timestamp:
+            return 20;
+    }
 }
 
-void Value::setValue(float value)
+static uint64_t magnitude(int64_t value)
 {
-    mType = Type::Float;
-    mValue = value;
+    return value < 0 ? 0 - uint64_t(value) : uint64_t(value);
 }
 
-void Value::setValue(const std::string &value)
+// Computes a * b / divisor, rounded to the nearest integer with halves away
+// from zero.  Products which fit in 64 bits are divided directly, and the
+// rest are divided bit by bit from a 128-bit product, since not every
+// compiler has a 128-bit integer type.
+static int64_t roundedMultiplyDivide(int64_t a, int64_t b, int64_t divisor)
 {
-    mType = Type::String;
-    mValue = value;
+    bool negative = ((a < 0) != (b < 0)) != (divisor < 0);
+    uint64_t x = magnitude(a);
+    uint64_t y = magnitude(b);
+    uint64_t d = magnitude(divisor);
+
+    uint64_t quotient;
+    uint64_t remainder;
+    if(y == 0 || x <= UINT64_MAX / y) {
+        quotient = x * y / d;
+        remainder = x * y % d;
+    } else {
+        uint64_t lowLow = (x & 0xffffffff) * (y & 0xffffffff);
+        uint64_t lowHigh = (x & 0xffffffff) * (y >> 32);
+        uint64_t highLow = (x >> 32) * (y & 0xffffffff);
+        uint64_t middle = (lowLow >> 32) + (lowHigh & 0xffffffff) + (highLow & 0xffffffff);
+        uint64_t high = (x >> 32) * (y >> 32) + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32);
+        uint64_t low = (middle << 32) | (lowLow & 0xffffffff);
+
+        // The remainder stays below 2 * d, so a bit shifted out of it means
+        // it is at least d
+        quotient = 0;
+        remainder = 0;
+        for(int bit=127; bit>=0; bit--) {
+            bool carry = remainder >> 63;
+            uint64_t next = (bit >= 64) ? (high >> (bit - 64)) : (low >> bit);
+            remainder = (remainder << 1) | (next & 1);
+            quotient <<= 1;
+            if(carry || remainder >= d) {
+                remainder -= d;
+                quotient |= 1;
+            }
+        }
+    }
+
+    if(remainder != 0 && remainder >= d - remainder) {
+        quotient++;
+    }
+    return negative ? int64_t(0 - quotient) : int64_t(quotient);
 }
 
-void Value::setValue(bool value)
+Value Value::operator+(const Value &other) const
 {
-    mType = Type::Boolean;
-    mValue = value;
+    if(mType == Type::Null || other.mType == Type::Null) {
+        return null();
+    }
+
+    switch(mType) {
+        case Type::Int:
+            return Value(load<int>() + other.intValue());
+        case Type::Float:
+            return Value(load<float>() + other.floatValue());
+        case Type::BigInt:
+        case Type::Decimal:
+            return Value(mType, load<int64_t>() + other.integerValue(mType));
+        case Type::Double:
+            return Value(load<double>() + other.doubleValue());
+        default:
+            return Value();
+    }
 }
 
-int Value::intValue()
+Value Value::operator-(const Value &other) const
 {
-    return std::get<int>(mValue);
+    if(mType == Type::Null || other.mType == Type::Null) {
+        return null();
+    }
+
+    switch(mType) {
+        case Type::Int:
+            return Value(load<int>() - other.intValue());
+        case Type::Float:
+            return Value(load<float>() - other.floatValue());
+        case Type::BigInt:
+        case Type::Decimal:
+            return Value(mType, load<int64_t>() - other.integerValue(mType));
+        case Type::Double:
+            return Value(load<double>() - other.doubleValue());
+        default:
+            return Value();
+    }
 }
 
-float Value::floatValue()
+Value Value::operator-() const
 {
-    return std::get<float>(mValue);
+    switch(mType) {
+        case Type::Null:
+            return null();
+        case Type::Int:
+            return Value(-load<int>());
+        case Type::Float:
+            return Value(-load<float>());
+        case Type::BigInt:
+        case Type::Decimal:
+            return Value(mType, -load<int64_t>());
+        case Type::Double:
+            return Value(-load<double>());
+        default:
+            return Value();
+    }
 }
 
-const std::string &Value::stringValue()
+Value Value::operator*(const Value &other) const
 {
-    return std::get<std::string>(mValue);
+    if(mType == Type::Null || other.mType == Type::Null) {
+        return null();
+    }
+
+    switch(mType) {
+        case Type::Int:
+            return Value(load<int>() * other.intValue());
+        case Type::Float:
+            return Value(load<float>() * other.floatValue());
+        case Type::BigInt:
+            return Value(load<int64_t>() * other.bigIntValue());
+        case Type::Double:
+            return Value(load<double>() * other.doubleValue());
+        case Type::Decimal:
+            return Value(Type::Decimal, roundedMultiplyDivide(load<int64_t>(), other.decimalValue(), kDecimalScale));
+        default:
+            return Value();
+    }
 }
 
-bool Value::booleanValue()
+Value Value::operator/(const Value &other) const
 {
-    return std::get<bool>(mValue);
+    if(mType == Type::Null || other.mType == Type::Null) {
+        return null();
+    }
+
+    switch(mType) {
+        case Type::Int:
+            return Value(load<int>() / other.intValue());
+        case Type::Float:
+            return Value(load<float>() / other.floatValue());
+        case Type::BigInt:
+            return Value(load<int64_t>() / other.bigIntValue());
+        case Type::Double:
+            return Value(load<double>() / other.doubleValue());
+        case Type::Decimal:
+            return Value(Type::Decimal, roundedMultiplyDivide(load<int64_t>(), kDecimalScale, other.decimalValue()));
+        default:
+            return Value();
+    }
 }
 
-void Value::print(int width)
+bool Value::convert(Type type)
 {
-    if(width != -1) {
-        std::cout.width(width);
+    if(mType == type || mType == Type::Null) {
+        return true;
     }
 
-    switch(type()) {
-        case Value::Type::Int:
-            std::cout << intValue();
-            break;
+    if(mType == Type::String) {
+        if(type != Type::Timestamp) {
+            return false;
+        }
+        std::optional<int64_t> timestamp = parseTimestamp(stringValue());
+        if(!timestamp) {
+            return false;
+        }
+        setValue(Type::Timestamp, *timestamp);
+        return true;
+    }
 
-        case Value::Type::Float:
-            std::cout << floatValue();
-            break;
+    // Numbers are read either exactly, as a count of units of size scale, or
+    // as a double
+    int64_t units = 0;
+    int64_t scale = 1;
+    double number = 0;
+    bool exact = true;
+    switch(mType) {
+        case Type::Int: units = load<int>(); break;
+        case Type::BigInt: units = load<int64_t>(); break;
+        case Type::Decimal: units = load<int64_t>(); scale = kDecimalScale; break;
+        case Type::Float: number = load<float>(); exact = false; break;
+        case Type::Double: number = load<double>(); exact = false; break;
+        default: return false;
+    }
 
-        case Value::Type::String:
+    // Doubles at or beyond 2^63 are out of the range of an int64_t
+    const double kLimit = 9223372036854775808.0;
+    switch(type) {
+        case Type::Int:
+        case Type::BigInt:
         {
-            std::stringstream ss;
+            int64_t integer;
+            if(exact) {
+                if(units % scale != 0) {
+                    return false;
+                }
+                integer = units / scale;
+            } else {
+                if(number != std::trunc(number) || number >= kLimit || number < -kLimit) {
+                    return false;
+                }
+                integer = int64_t(number);
+            }
 
-            if(width == -1 || stringValue().size() < width) {
-                ss << "\"" << stringValue() << "\"";
+            if(type == Type::Int) {
+                if(integer < INT32_MIN || integer > INT32_MAX) {
+                    return false;
+                }
+                setValue(int(integer));
             } else {
-                ss << "\"" << stringValue().substr(0, width - 3) << "...\"";
+                setValue(integer);
             }
+            return true;
+        }
 
-            std::cout << ss.str();
-            break;
+        case Type::Float:
+        case Type::Double:
+            if(exact) {
+                number = double(units) / double(scale);
+            }
+            if(type == Type::Float) {
+                setValue(float(number));
+            } else {
+                setValue(number);
+            }
+            return true;
+
+        case Type::Decimal:
+            if(exact) {
+                if(units > INT64_MAX / kDecimalScale || units < INT64_MIN / kDecimalScale) {
+                    return false;
+                }
+                setValue(Type::Decimal, units * kDecimalScale);
+            } else {
+                double scaled = std::round(number * kDecimalScale);
+                if(!(scaled < kLimit && scaled >= -kLimit)) {
+                    return false;
+                }
+                setValue(Type::Decimal, int64_t(scaled));
+            }
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+// Days since 1970-01-01 of a date in the proleptic Gregorian calendar, and
+// back again
+static int64_t daysFromCivil(int64_t year, unsigned int month, unsigned int day)
+{
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    unsigned int yearOfEra = unsigned(year - era * 400);
+    unsigned int dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + int64_t(dayOfEra) - 719468;
+}
+
+static void civilFromDays(int64_t days, int64_t &year, unsigned int &month, unsigned int &day)
+{
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned int dayOfEra = unsigned(days - era * 146097);
+    unsigned int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    unsigned int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    unsigned int monthIndex = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    year = int64_t(yearOfEra) + era * 400 + (month <= 2);
+}
+
+std::optional<int64_t> Value::parseTimestamp(std::string_view string)
+{
+    size_t pos = 0;
+    auto number = [&](unsigned int digits, int64_t &result) {
+        result = 0;
+        for(unsigned int i=0; i<digits; i++, pos++) {
+            if(pos >= string.size() || !std::isdigit(string[pos])) {
+                return false;
+            }
+            result = result * 10 + (string[pos] - '0');
         }
+        return true;
+    };
+    auto separator = [&](char c) {
+        return pos < string.size() && string[pos++] == c;
+    };
+
+    int64_t year, month, day;
+    int64_t hour = 0, minute = 0, second = 0, micros = 0;
+    if(!number(4, year) || !separator('-') || !number(2, month) || !separator('-') || !number(2, day)) {
+        return std::nullopt;
+    }
+    if(pos < string.size()) {
+        if((string[pos] != ' ' && string[pos] != 'T') || (pos++, !number(2, hour)) || !separator(':') || !number(2, minute) || !separator(':') || !number(2, second)) {
+            return std::nullopt;
+        }
+        if(pos < string.size()) {
+            if(!separator('.') || pos == string.size()) {
+                return std::nullopt;
+            }
+            int64_t unit = 100000;
+            for(; pos < string.size(); pos++, unit /= 10) {
+                if(!std::isdigit(string[pos]) || unit == 0) {
+                    return std::nullopt;
+                }
+                micros += (string[pos] - '0') * unit;
+            }
+        }
+    }
 
-        case Value::Type::Boolean:
-            std::cout << (booleanValue() ? "true" : "false");
-            break;
+    static const unsigned int kMonthDays[] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    if(month < 1 || month > 12 || day < 1 || day > kMonthDays[month - 1] || (month == 2 && day == 29 && !leap) || hour > 23 || minute > 59 || second > 59) {
+        return std::nullopt;
     }
+
+    int64_t seconds = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    return seconds * 1000000 + micros;
 }
 
-int Value::minPrintWidth(Type type)
+std::string Value::formatTimestamp(int64_t timestamp)
 {
-    switch(type) {
-        case Value::Type::Int:
-        case Value::Type::Float:
-        case Value::Type::Boolean:
-            return 6;
+    int64_t seconds = timestamp / 1000000;
+    int64_t micros = timestamp % 1000000;
+    if(micros < 0) {
+        micros += 1000000;
+        seconds--;
+    }
+    int64_t days = seconds / 86400;
+    int64_t time = seconds % 86400;
+    if(time < 0) {
+        time += 86400;
+        days--;
+    }
 
-        case Value::Type::String:
-            return 20;
+    int64_t year;
+    unsigned int month;
+    unsigned int day;
+    civilFromDays(days, year, month, day);
+
+    char buffer[40];
+    int size = std::snprintf(buffer, sizeof(buffer), "%04lld-%02u-%02u %02lld:%02lld:%02lld", (long long)year, month, day, (long long)(time / 3600), (long long)(time / 60 % 60), (long long)(time % 60));
+    if(micros != 0) {
+        std::snprintf(buffer + size, sizeof(buffer) - size, ".%06lld", (long long)micros);
     }
+    return buffer;
 }
 
-bool Value::operator<(Value &other)
+std::optional<int64_t> Value::parseDecimal(std::string_view string)
 {
-    switch(type()) {
-        case Type::Int:
-            return intValue() < other.intValue();
-        case Type::Float:
-            return floatValue() < other.floatValue();
-        case Type::String:
-            return stringValue() < other.stringValue();
-        default:
-            return false;
+    size_t pos = 0;
+    bool negative = false;
+    if(pos < string.size() && (string[pos] == '-' || string[pos] == '+')) {
+        negative = string[pos++] == '-';
+    }
+
+    // Digits past the last place round the value to nearest
+    int64_t units = 0;
+    int places = -1;
+    bool digits = false;
+    bool roundUp = false;
+    for(; pos < string.size(); pos++) {
+        char c = string[pos];
+        if(c == '.' && places == -1) {
+            places = 0;
+        } else if(std::isdigit(c)) {
+            digits = true;
+            if(places == kDecimalPlaces) {
+                roundUp = c >= '5';
+                places++;
+                continue;
+            }
+            if(places > kDecimalPlaces) {
+                continue;
+            }
+            if(units > (INT64_MAX - (c - '0')) / 10) {
+                return std::nullopt;
+            }
+            units = units * 10 + (c - '0');
+            if(places >= 0) {
+                places++;
+            }
+        } else {
+            return std::nullopt;
+        }
+    }
+    if(!digits) {
+        return std::nullopt;
+    }
+
+    for(int i=std::max(places, 0); i<kDecimalPlaces; i++) {
+        if(units > INT64_MAX / 10) {
+            return std::nullopt;
+        }
+        units *= 10;
+    }
+    if(roundUp) {
+        if(units == INT64_MAX) {
+            return std::nullopt;
+        }
+        units++;
     }
+    return negative ? -units : units;
 }
 
-bool Value::operator<=(Value &other)
+std::string Value::formatDecimal(int64_t decimal)
 {
-    return (*this < other) || (*this == other);
+    uint64_t magnitude = decimal < 0 ? -uint64_t(decimal) : uint64_t(decimal);
+    std::string fraction = std::to_string(magnitude % kDecimalScale);
+    fraction.insert(0, kDecimalPlaces - fraction.size(), '0');
+    return (decimal < 0 ? "-" : "") + std::to_string(magnitude / kDecimalScale) + "." + fraction;
 }
 
-bool Value::operator==(Value &other)
+ValueRef::ValueRef(int value)
 {
-    switch(type()) {
-        case Type::Int:
-            return intValue() == other.intValue();
-        case Type::Float:
-            return floatValue() == other.floatValue();
-        case Type::String:
-            return stringValue() == other.stringValue();
-        case Type::Boolean:
-            return booleanValue() == other.booleanValue();
-    }
+    mType = Value::Type::Int;
+    mInt = value;
 }
 
-bool Value::operator!=(Value &other)
+ValueRef::ValueRef(float value)
 {
-    return !(*this == other);
+    mType = Value::Type::Float;
+    mFloat = value;
 }
 
-bool Value::operator>=(Value &other)
+ValueRef::ValueRef(int64_t value)
 {
-    return (*this > other) || (*this == other);
+    mType = Value::Type::BigInt;
+    mInteger = value;
 }
 
-bool Value::operator>(Value &other)
+ValueRef::ValueRef(double value)
 {
-    switch(type()) {
-        case Type::Int:
-            return intValue() > other.intValue();
-        case Type::Float:
-            return floatValue() > other.floatValue();
-        case Type::String:
-            return stringValue() > other.stringValue();
-        default:
-            return false;
-    }
+    mType = Value::Type::Double;
+    mDouble = value;
 }
 
-Value Value::operator+(Value &other)
+ValueRef::ValueRef(Value::Type type, int64_t value)
 {
-    switch(type()) {
-        case Type::Int:
-            return Value(intValue() + other.intValue());
-        case Type::Float:
-            return Value(floatValue() + other.floatValue());
+    mType = type;
+    mInteger = value;
+}
+
+ValueRef::ValueRef(std::string_view value)
+{
+    mType = Value::Type::String;
+    mString = value;
+}
+
+ValueRef::ValueRef(bool value)
+{
+    mType = Value::Type::Boolean;
+    mBoolean = value;
+}
+
+ValueRef::ValueRef(const Value &value)
+{
+    mType = value.type();
+    switch(mType) {
+        case Value::Type::Int: mInt = value.intValue(); break;
+        case Value::Type::Float: mFloat = value.floatValue(); break;
+        case Value::Type::String: mString = value.stringValue(); break;
+        case Value::Type::Boolean: mBoolean = value.booleanValue(); break;
+        case Value::Type::BigInt: mInteger = value.bigIntValue(); break;
+        case Value::Type::Double: mDouble = value.doubleValue(); break;
+        case Value::Type::Timestamp: mInteger = value.timestampValue(); break;
+        case Value::Type::Decimal: mInteger = value.decimalValue(); break;
+        case Value::Type::Null: break;
     }
-    return Value();
 }
 
-Value Value::operator-(Value &other)
+ValueRef ValueRef::null()
 {
-    switch(type()) {
-        case Type::Int:
-            return Value(intValue() - other.intValue());
-        case Type::Float:
-            return Value(floatValue() - other.floatValue());
+    ValueRef value;
+    value.mType = Value::Type::Null;
+    return value;
+}
+
+Value::Type ValueRef::type() const
+{
+    return mType;
+}
+
+bool ValueRef::isNull() const
+{
+    return mType == Value::Type::Null;
+}
+
+int ValueRef::intValue() const
+{
+    return mInt;
+}
+
+float ValueRef::floatValue() const
+{
+    return mFloat;
+}
+
+std::string_view ValueRef::stringValue() const
+{
+    return mString;
+}
+
+bool ValueRef::booleanValue() const
+{
+    return mBoolean;
+}
+
+int64_t ValueRef::bigIntValue() const
+{
+    return mInteger;
+}
+
+double ValueRef::doubleValue() const
+{
+    return mDouble;
+}
+
+int64_t ValueRef::timestampValue() const
+{
+    return mInteger;
+}
+
+int64_t ValueRef::decimalValue() const
+{
+    return mInteger;
+}
+
+Value ValueRef::value() const
+{
+    switch(mType) {
+        case Value::Type::Int: return Value(mInt);
+        case Value::Type::Float: return Value(mFloat);
+        case Value::Type::String: return Value(mString);
+        case Value::Type::Boolean: return Value(mBoolean);
+        case Value::Type::BigInt: return Value(mInteger);
+        case Value::Type::Double: return Value(mDouble);
+        case Value::Type::Timestamp:
+        case Value::Type::Decimal: return Value(mType, mInteger);
+        case Value::Type::Null: return Value::null();
     }
     return Value();
 }
 
-Value Value::operator-()
+void ValueRef::print(int width) const
 {
-    switch(type()) {
-        case Type::Int:
-            return Value(-intValue());
-        case Type::Float:
-            return Value(-floatValue());
+    if(width != -1) {
+        std::cout.width(width);
+    }
+
+    switch(mType) {
+        case Value::Type::Int:
+            std::cout << mInt;
+            break;
+
+        case Value::Type::Float:
+            std::cout << mFloat;
+            break;
+
+        case Value::Type::String:
+        {
+            std::stringstream ss;
+
+            if(width == -1 || mString.size() < width) {
+                ss << "\"" << mString << "\"";
+            } else {
+                ss << "\"" << mString.substr(0, width - 3) << "...\"";
+            }
+
+            std::cout << ss.str();
+            break;
+        }
+
+        case Value::Type::Boolean:
+            std::cout << (mBoolean ? "true" : "false");
+            break;
+
+        case Value::Type::BigInt:
+            std::cout << mInteger;
+            break;
+
+        case Value::Type::Double:
+            std::cout << mDouble;
+            break;
+
+        case Value::Type::Timestamp:
+            std::cout << Value::formatTimestamp(mInteger);
+            break;
+
+        case Value::Type::Decimal:
+            std::cout << Value::formatDecimal(mInteger);
+            break;
+
+        case Value::Type::Null:
+            std::cout << "NULL";
+            break;
     }
-    return Value();
 }
 
-Value Value::operator*(Value &other)
+bool ValueRef::operator<(const ValueRef &other) const
 {
-    switch(type()) {
-        case Type::Int:
-            return Value(intValue() * other.intValue());
-        case Type::Float:
-            return Value(floatValue() * other.floatValue());
+    if(other.mType == Value::Type::Null) {
+        return false;
+    }
+
+    switch(mType) {
+        case Value::Type::Int: return mInt < other.mInt;
+        case Value::Type::Float: return mFloat < other.mFloat;
+        case Value::Type::String: return mString < other.mString;
+        case Value::Type::BigInt:
+        case Value::Type::Timestamp:
+        case Value::Type::Decimal: return mInteger < other.mInteger;
+        case Value::Type::Double: return mDouble < other.mDouble;
+        case Value::Type::Null: return true;
+        default: return false;
     }
-    return Value();
 }
 
-Value Value::operator/(Value &other)
+bool ValueRef::operator==(const ValueRef &other) const
 {
-    switch(type()) {
-        case Type::Int:
-            return Value(intValue() / other.intValue());
-        case Type::Float:
-            return Value(floatValue() / other.floatValue());
+    if(mType == Value::Type::Null || other.mType == Value::Type::Null) {
+        return mType == other.mType;
     }
-    return Value();
+
+    switch(mType) {
+        case Value::Type::Int: return mInt == other.mInt;
+        case Value::Type::Float: return mFloat == other.mFloat;
+        case Value::Type::String: return mString == other.mString;
+        case Value::Type::Boolean: return mBoolean == other.mBoolean;
+        case Value::Type::BigInt:
+        case Value::Type::Timestamp:
+        case Value::Type::Decimal: return mInteger == other.mInteger;
+        case Value::Type::Double: return mDouble == other.mDouble;
+        case Value::Type::Null: break;
+    }
+    return false;
 }
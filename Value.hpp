@@ -1,54 +1,540 @@
 #ifndef VALUE_HPP
 #define VALUE_HPP
 
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
 #include <string>
-#include <variant>
+#include <string_view>
 
+// A tagged value of 16 bytes.  Strings of up to kShortCapacity bytes are
+// held inline; longer ones are kept in a block shared by every copy of the
+// value, so copying a value never allocates.  The count of copies is not
+// atomic, so a long string must not be shared between threads.
+//
+// A SQL NULL is a value of its own type, Null, which may stand in for a
+// value of any type.  Arithmetic on it gives NULL, and it orders before
+// every other value.
 class Value {
 public:
-    enum Type {
+    enum Type : uint8_t {
         Int,
         Float,
         String,
-        Boolean
+        Boolean,
+        BigInt,
+        Double,
+        Timestamp,
+        Decimal,
+        Null
     };
 
-    Value() = default;
+    // Raised when a value is read as a type it does not hold
+    struct TypeError {};
+
+    static const unsigned int kShortCapacity = 14;
+
+    // A Decimal is a fixed-point number with kDecimalPlaces digits after the
+    // point, held as a count of its smallest unit
+    static const int kDecimalPlaces = 4;
+    static const int64_t kDecimalScale = 10000;
+
+    Value();
     Value(int value);
     Value(float value);
     Value(const std::string &value);
+    Value(std::string_view value);
     Value(bool value);
+    Value(int64_t value);
+    Value(double value);
+
+    // For the types held as 64-bit integers: BigInt, Decimal, and Timestamp,
+    // which counts microseconds since 1970-01-01 00:00:00 UTC
+    Value(Type type, int64_t value);
+
+    static Value null();
 
-    Type type();
+    Value(const Value &other);
+    Value(Value &&other) noexcept;
+    ~Value();
+    Value &operator=(const Value &other);
+    Value &operator=(Value &&other) noexcept;
 
+    Type type() const;
+    bool isNull() const;
+
+    void setNull();
     void setValue(int value);
     void setValue(float value);
-    void setValue(const std::string &value);
+    void setValue(std::string_view value);
     void setValue(bool value);
+    void setValue(int64_t value);
+    void setValue(double value);
+    void setValue(Type type, int64_t value);
+
+    int intValue() const;
+    float floatValue() const;
+    std::string_view stringValue() const;
+    bool booleanValue() const;
+    int64_t bigIntValue() const;
+    double doubleValue() const;
+    int64_t timestampValue() const;
+    int64_t decimalValue() const;
+
+    // Reads any of the types held as 64-bit integers, which must be type
+    int64_t integerValue(Type type) const;
 
-    int intValue();
-    float floatValue();
-    const std::string &stringValue();
-    bool booleanValue();
+    // Converts the value to type if nothing but precision is lost: between
+    // numeric types while the value is in range, rounding to the nearest
+    // where needed but never dropping a fraction to make an integer, and
+    // from a String to a Timestamp.  NULL stays NULL.  Returns false,
+    // leaving the value as it was, otherwise.
+    bool convert(Type type);
 
-    void print(int width = -1);
+    void print(int width = -1) const;
     static int minPrintWidth(Type type);
 
-    bool operator<(Value &other);
-    bool operator<=(Value &other);
-    bool operator==(Value &other);
-    bool operator!=(Value &other);
-    bool operator>=(Value &other);
-    bool operator>(Value &other);
+    // Timestamps are written as YYYY-MM-DD HH:MM:SS, with a fraction of a
+    // second if they have one, and may be read without the time
+    static std::optional<int64_t> parseTimestamp(std::string_view string);
+    static std::string formatTimestamp(int64_t timestamp);
+    static std::optional<int64_t> parseDecimal(std::string_view string);
+    static std::string formatDecimal(int64_t decimal);
 
-    Value operator+(Value &other);
-    Value operator-(Value &other);
-    Value operator-();
-    Value operator*(Value &other);
-    Value operator/(Value &other);
+    bool operator<(const Value &other) const;
+    bool operator<=(const Value &other) const;
+    bool operator==(const Value &other) const;
+    bool operator!=(const Value &other) const;
+    bool operator>=(const Value &other) const;
+    bool operator>(const Value &other) const;
+
+    Value operator+(const Value &other) const;
+    Value operator-(const Value &other) const;
+    Value operator-() const;
+    Value operator*(const Value &other) const;
+    Value operator/(const Value &other) const;
 
 private:
-    Type mType;
-    std::variant<int, float, std::string, bool> mValue;
+    struct LongString {
+        uint32_t references;
+        uint32_t size;
+
+        char *data();
+    };
+
+    static const uint8_t kLong = 0xff;
+
+    void copy(const Value &other);
+    void take(Value &other);
+    void release();
+
+    template<typename T> T load() const;
+    template<typename T> void store(T value);
+    LongString *longString() const;
+
+    // Numbers, booleans, short strings and the pointer to a long string all
+    // start at the beginning of mData
+    alignas(8) char mData[kShortCapacity];
+    uint8_t mShortSize = 0;
+    Type mType = Type::Int;
+};
+
+// Copies and reads are defined here so that they are inlined
+
+inline char *Value::LongString::data()
+{
+    return reinterpret_cast<char*>(this + 1);
+}
+
+template<typename T> inline T Value::load() const
+{
+    T value;
+    std::memcpy(&value, mData, sizeof(T));
+    return value;
+}
+
+template<typename T> inline void Value::store(T value)
+{
+    std::memcpy(mData, &value, sizeof(T));
+}
+
+inline Value::LongString *Value::longString() const
+{
+    return load<LongString*>();
+}
+
+inline Value::Value()
+{
+    setValue(0);
+}
+
+inline Value::Value(int value)
+{
+    setValue(value);
+}
+
+inline Value::Value(float value)
+{
+    setValue(value);
+}
+
+inline Value::Value(bool value)
+{
+    setValue(value);
+}
+
+inline Value::Value(int64_t value)
+{
+    setValue(value);
+}
+
+inline Value::Value(double value)
+{
+    setValue(value);
+}
+
+inline Value::Value(Type type, int64_t value)
+{
+    setValue(type, value);
+}
+
+inline Value Value::null()
+{
+    Value value;
+    value.mType = Type::Null;
+    return value;
+}
+
+inline Value::Value(const Value &other)
+{
+    copy(other);
+}
+
+inline Value::Value(Value &&other) noexcept
+{
+    take(other);
+}
+
+inline Value::~Value()
+{
+    release();
+}
+
+inline Value &Value::operator=(const Value &other)
+{
+    if(this != &other) {
+        release();
+        copy(other);
+    }
+    return *this;
+}
+
+inline Value &Value::operator=(Value &&other) noexcept
+{
+    if(this != &other) {
+        release();
+        take(other);
+    }
+    return *this;
+}
+
+inline Value::Type Value::type() const
+{
+    return mType;
+}
+
+inline bool Value::isNull() const
+{
+    return mType == Type::Null;
+}
+
+inline void Value::setNull()
+{
+    release();
+    mType = Type::Null;
+    store(int64_t(0));
+}
+
+inline void Value::setValue(int value)
+{
+    release();
+    mType = Type::Int;
+    store(value);
+}
+
+inline void Value::setValue(float value)
+{
+    release();
+    mType = Type::Float;
+    store(value);
+}
+
+inline void Value::setValue(bool value)
+{
+    release();
+    mType = Type::Boolean;
+    store(value);
+}
+
+inline void Value::setValue(int64_t value)
+{
+    setValue(Type::BigInt, value);
+}
+
+inline void Value::setValue(double value)
+{
+    release();
+    mType = Type::Double;
+    store(value);
+}
+
+inline void Value::setValue(Type type, int64_t value)
+{
+    release();
+    mType = type;
+    store(value);
+}
+
+inline int Value::intValue() const
+{
+    if(mType != Type::Int) {
+        throw TypeError();
+    }
+    return load<int>();
+}
+
+inline float Value::floatValue() const
+{
+    if(mType != Type::Float) {
+        throw TypeError();
+    }
+    return load<float>();
+}
+
+inline std::string_view Value::stringValue() const
+{
+    if(mType != Type::String) {
+        throw TypeError();
+    }
+    if(mShortSize == kLong) {
+        LongString *string = longString();
+        return std::string_view(string->data(), string->size);
+    }
+    return std::string_view(mData, mShortSize);
+}
+
+inline bool Value::booleanValue() const
+{
+    if(mType != Type::Boolean) {
+        throw TypeError();
+    }
+    return load<bool>();
+}
+
+inline int64_t Value::bigIntValue() const
+{
+    return integerValue(Type::BigInt);
+}
+
+inline double Value::doubleValue() const
+{
+    if(mType != Type::Double) {
+        throw TypeError();
+    }
+    return load<double>();
+}
+
+inline int64_t Value::timestampValue() const
+{
+    return integerValue(Type::Timestamp);
+}
+
+inline int64_t Value::decimalValue() const
+{
+    return integerValue(Type::Decimal);
+}
+
+inline int64_t Value::integerValue(Type type) const
+{
+    if(mType != type) {
+        throw TypeError();
+    }
+    return load<int64_t>();
+}
+
+// Long strings are shared with the copy
+inline void Value::copy(const Value &other)
+{
+    std::memcpy(mData, other.mData, sizeof(mData));
+    mShortSize = other.mShortSize;
+    mType = other.mType;
+    if(mType == Type::String && mShortSize == kLong) {
+        longString()->references++;
+    }
+}
+
+// A long string is moved rather than shared
+inline void Value::take(Value &other)
+{
+    std::memcpy(mData, other.mData, sizeof(mData));
+    mShortSize = other.mShortSize;
+    mType = other.mType;
+    other.mType = Type::Int;
+}
+
+inline void Value::release()
+{
+    if(mType == Type::String && mShortSize == kLong) {
+        LongString *string = longString();
+        if(--string->references == 0) {
+            std::free(string);
+        }
+    }
+    mType = Type::Int;
+}
+
+// The left operand's type decides how values are compared; reading the right
+// operand as that type fails if it has another.  NULL equals only NULL.
+inline bool Value::operator<(const Value &other) const
+{
+    if(other.mType == Type::Null) {
+        return false;
+    }
+
+    switch(mType) {
+        case Type::Int:
+            return load<int>() < other.intValue();
+        case Type::Float:
+            return load<float>() < other.floatValue();
+        case Type::String:
+            return stringValue() < other.stringValue();
+        case Type::BigInt:
+        case Type::Timestamp:
+        case Type::Decimal:
+            return load<int64_t>() < other.integerValue(mType);
+        case Type::Double:
+            return load<double>() < other.doubleValue();
+        case Type::Null:
+            return true;
+        default:
+            return false;
+    }
+}
+
+inline bool Value::operator<=(const Value &other) const
+{
+    return (*this < other) || (*this == other);
+}
+
+inline bool Value::operator==(const Value &other) const
+{
+    if(other.mType == Type::Null) {
+        return mType == Type::Null;
+    }
+
+    switch(mType) {
+        case Type::Int:
+            return load<int>() == other.intValue();
+        case Type::Float:
+            return load<float>() == other.floatValue();
+        case Type::String:
+            return stringValue() == other.stringValue();
+        case Type::Boolean:
+            return load<bool>() == other.booleanValue();
+        case Type::BigInt:
+        case Type::Timestamp:
+        case Type::Decimal:
+            return load<int64_t>() == other.integerValue(mType);
+        case Type::Double:
+            return load<double>() == other.doubleValue();
+        case Type::Null:
+            return false;
+    }
+    return false;
+}
+
+inline bool Value::operator!=(const Value &other) const
+{
+    return !(*this == other);
+}
+
+inline bool Value::operator>=(const Value &other) const
+{
+    return (*this > other) || (*this == other);
+}
+
+inline bool Value::operator>(const Value &other) const
+{
+    if(other.mType == Type::Null) {
+        return mType != Type::Null;
+    }
+
+    switch(mType) {
+        case Type::Int:
+            return load<int>() > other.intValue();
+        case Type::Float:
+            return load<float>() > other.floatValue();
+        case Type::String:
+            return stringValue() > other.stringValue();
+        case Type::BigInt:
+        case Type::Timestamp:
+        case Type::Decimal:
+            return load<int64_t>() > other.integerValue(mType);
+        case Type::Double:
+            return load<double>() > other.doubleValue();
+        default:
+            return false;
+    }
+}
+
+// A value read in place.  A string refers to bytes held elsewhere, such as
+// the record it was read from, and is only valid for as long as they are, so
+// reading, comparing and printing one copies nothing.  value() makes a Value
+// holding its own copy.
+class ValueRef {
+public:
+    ValueRef() = default;
+    ValueRef(int value);
+    ValueRef(float value);
+    ValueRef(std::string_view value);
+    ValueRef(bool value);
+    ValueRef(int64_t value);
+    ValueRef(double value);
+    ValueRef(Value::Type type, int64_t value);
+    ValueRef(const Value &value);
+
+    static ValueRef null();
+
+    Value::Type type() const;
+    bool isNull() const;
+
+    int intValue() const;
+    float floatValue() const;
+    std::string_view stringValue() const;
+    bool booleanValue() const;
+    int64_t bigIntValue() const;
+    double doubleValue() const;
+    int64_t timestampValue() const;
+    int64_t decimalValue() const;
+
+    Value value() const;
+
+    void print(int width = -1) const;
+
+    // Both operands must be of the same type, or either NULL
+    bool operator<(const ValueRef &other) const;
+    bool operator==(const ValueRef &other) const;
+
+private:
+    Value::Type mType = Value::Type::Int;
+    union {
+        int64_t mInteger = 0;
+        int mInt;
+        float mFloat;
+        bool mBoolean;
+        double mDouble;
+    };
+    std::string_view mString;
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,36 @@
+#include "Database.hpp"
+#include "PageSets/MemoryPageSet.hpp"
+
+#include <iostream>
+#include <string>
+
+// Rows are added at the rightmost leaf, and when the rightmost indirect page
+// is full a new one is started.  Delete the newest row after every insert, so
+// that the new pages are rebalanced right after they are created.
+int main(int argc, char *argv[])
+{
+    Database database(std::make_unique<PageSets::MemoryPageSet>(PageSet::kMinPageSize));
+    database.executeQuery("CREATE TABLE Table (INTEGER id, STRING name)");
+
+    std::string name(40, 'x');
+    int numRows = 0;
+    for(int i=0; i<2000; i++) {
+        database.executeQuery("INSERT INTO Table VALUES (" + std::to_string(2 * i) + ", \"" + name + "\")");
+        database.executeQuery("INSERT INTO Table VALUES (" + std::to_string(2 * i + 1) + ", \"" + name + "\")");
+        database.executeQuery("DELETE FROM Table WHERE id == " + std::to_string(2 * i + 1));
+        numRows++;
+    }
+
+    Database::QueryResult result = database.executeQuery("SELECT * FROM Table");
+    int count = 0;
+    for(result.iterator->start(); result.iterator->valid(); result.iterator->next()) {
+        count++;
+    }
+
+    if(count != numRows) {
+        std::cout << "Expected " << numRows << " rows, found " << count << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
\ No newline at end of file